@@ -420,7 +420,8 @@ static BROTLI_BOOL DecodeSharedDictionary(
   uint32_t num_prefix = 0;
   BROTLI_BOOL is_custom_static_dict = BROTLI_FALSE;
   BROTLI_BOOL has_custom_static_dict =
-      dict->num_word_lists > 0 || dict->num_transform_lists > 0;
+      dict->num_word_lists > 0 || dict->num_transform_lists > 0 ||
+      BrotliSharedDictionaryIsCustomStatic(dict);
 
   /* Check magic header bytes. */
   if (size < 2) return BROTLI_FALSE;
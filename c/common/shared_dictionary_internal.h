@@ -68,6 +68,15 @@ struct BrotliSharedDictionaryStruct {
 typedef struct BrotliSharedDictionaryStruct BrotliSharedDictionaryInternal;
 #define BrotliSharedDictionary BrotliSharedDictionaryInternal
 
+/* Returns BROTLI_TRUE if built-in words or transforms are replaced; such
+   instances could not be combined. */
+static BROTLI_INLINE BROTLI_BOOL BrotliSharedDictionaryIsCustomStatic(
+    const BrotliSharedDictionary* dict) {
+  return TO_BROTLI_BOOL(dict->context_based || dict->num_dictionaries != 1 ||
+      dict->words[0] != BrotliGetDictionary() ||
+      dict->transforms[0] != BrotliGetTransforms());
+}
+
 #if defined(__cplusplus) || defined(c_plusplus)
 }  /* extern "C" */
 #endif
@@ -1581,6 +1581,16 @@ static void EnsureCompoundDictionaryInitialized(BrotliDecoderState* state) {
    * block_map[X >> block_bits] is in [0..num_chunks). */
 }
 
+/* Returns the index of the chunk that contains |address|.
+   REQUIRES: EnsureCompoundDictionaryInitialized is called. */
+static BROTLI_INLINE size_t FindCompoundDictionaryChunk(
+    const BrotliDecoderCompoundDictionary* addon, uint32_t address) {
+  size_t index = addon->block_map[address >> addon->block_bits];
+  /* Several chunks might be mapped to the same block index. */
+  while (address >= addon->chunk_offsets[index + 1]) index++;
+  return index;
+}
+
 static BROTLI_BOOL InitializeCompoundDictionaryCopy(BrotliDecoderState* s,
     uint32_t address, uint32_t length) {
   BrotliDecoderCompoundDictionary* addon = s->compound_dictionary;
@@ -1589,9 +1599,7 @@ static BROTLI_BOOL InitializeCompoundDictionaryCopy(BrotliDecoderState* s,
   BROTLI_DCHECK(address < addon->total_size);
   BROTLI_DCHECK(length > 0u);
   EnsureCompoundDictionaryInitialized(s);
-  index = addon->block_map[address >> addon->block_bits];
-  /* Several chunks might be mapped to the same block index. */
-  while (address >= addon->chunk_offsets[index + 1]) index++;
+  index = FindCompoundDictionaryChunk(addon, address);
   /* Check that the whole chunk is within dictionary bounds. */
   if (length > addon->total_size - address) return BROTLI_FALSE;
   /* Update the recent distances cache. */
@@ -1655,6 +1663,44 @@ BROTLI_BOOL BrotliDecoderAttachDictionary(
   return BROTLI_TRUE;
 }
 
+BROTLI_BOOL BrotliDecoderAttachSharedDictionary(
+    BrotliDecoderState* state, const BrotliSharedDictionary* dictionary) {
+  BrotliSharedDictionary* current = state->dictionary;
+  brotli_reg_t num_prefix_before = current->num_prefix;
+  brotli_reg_t i;
+  if (state->state != BROTLI_STATE_UNINITED) return BROTLI_FALSE;
+  if (!dictionary) return BROTLI_FALSE;
+  if (current->num_prefix + dictionary->num_prefix >
+      SHARED_BROTLI_MAX_COMPOUND_DICTS) {
+    return BROTLI_FALSE;
+  }
+  if (BrotliSharedDictionaryIsCustomStatic(dictionary)) {
+    /* Cannot combine different static dictionaries. */
+    if (BrotliSharedDictionaryIsCustomStatic(current)) return BROTLI_FALSE;
+    /* Word lists and transforms stay owned by |dictionary|. */
+    current->context_based = dictionary->context_based;
+    memcpy(current->context_map, dictionary->context_map,
+        sizeof(current->context_map));
+    current->num_dictionaries = dictionary->num_dictionaries;
+    for (i = 0; i < dictionary->num_dictionaries; i++) {
+      current->words[i] = dictionary->words[i];
+      current->transforms[i] = dictionary->transforms[i];
+    }
+  }
+  for (i = 0; i < dictionary->num_prefix; i++) {
+    current->prefix[current->num_prefix] = dictionary->prefix[i];
+    current->prefix_size[current->num_prefix] = dictionary->prefix_size[i];
+    current->num_prefix++;
+  }
+  for (i = num_prefix_before; i < current->num_prefix; i++) {
+    if (!AttachCompoundDictionary(
+        state, current->prefix[i], current->prefix_size[i])) {
+      return BROTLI_FALSE;
+    }
+  }
+  return BROTLI_TRUE;
+}
+
 /* Calculates the smallest feasible ring buffer.
 
    If we know the data size is small, do not allocate more ring buffer
@@ -2216,13 +2262,40 @@ CommandPostDecodeLiterals:
        * is strictly less than `compound_dictionary_size`. */
       uint32_t address = compound_dictionary_size -
                          (uint32_t)(s->distance_code - s->max_distance);
-      if (!InitializeCompoundDictionaryCopy(s, address, (uint32_t)i)) {
-        return BROTLI_FAILURE(BROTLI_DECODER_ERROR_COMPOUND_DICTIONARY);
-      }
-      pos += CopyFromCompoundDictionary(s, pos);
-      if (pos >= s->ringbuffer_size) {
-        s->state = BROTLI_STATE_COMMAND_POST_WRITE_1;
-        goto saveStateAndReturn;
+      const BrotliDecoderCompoundDictionary* addon = s->compound_dictionary;
+      size_t index;
+      uint32_t chunk_remaining;
+      EnsureCompoundDictionaryInitialized(s);
+      index = FindCompoundDictionaryChunk(addon, address);
+      chunk_remaining = addon->chunk_offsets[index + 1] - address;
+      if ((uint32_t)i <= chunk_remaining && pos + i < s->ringbuffer_size) {
+        /* Fast path: copy lies within one chunk and does not wrap. */
+        const uint8_t* copy_src =
+            addon->chunks[index] + (address - addon->chunk_offsets[index]);
+        uint8_t* copy_dst = &s->ringbuffer[pos];
+        /* Update the recent distances cache. */
+        s->dist_rb[s->dist_rb_idx & 3] = s->distance_code;
+        ++s->dist_rb_idx;
+        s->meta_block_remaining_len -= i;
+        /* As with LZ77 copies, it is safe to write up to 16 bytes ahead.
+           Fixed size short copies allow more compiler optimizations. */
+        if (i <= 16 && chunk_remaining >= 16) {
+          memcpy(copy_dst, copy_src, 16);
+        } else if (i <= 32 && chunk_remaining >= 32) {
+          memcpy(copy_dst, copy_src, 32);
+        } else {
+          memcpy(copy_dst, copy_src, (size_t)i);
+        }
+        pos += i;
+      } else {
+        if (!InitializeCompoundDictionaryCopy(s, address, (uint32_t)i)) {
+          return BROTLI_FAILURE(BROTLI_DECODER_ERROR_COMPOUND_DICTIONARY);
+        }
+        pos += CopyFromCompoundDictionary(s, pos);
+        if (pos >= s->ringbuffer_size) {
+          s->state = BROTLI_STATE_COMMAND_POST_WRITE_1;
+          goto saveStateAndReturn;
+        }
       }
       /* In else branch we have:
        * `s->distance_code - s->max_distance - 1 >= compound_dictionary_size`;
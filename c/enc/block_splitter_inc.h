@@ -318,6 +318,8 @@ static void FN(ClusterBlocks)(MemoryManager* m,
   for (i = 0; i < num_clusters; ++i) {
     clusters[i] = (uint32_t)i;
   }
+  FN(BrotliHistogramSortClusters)(m, all_histograms, clusters, num_clusters);
+  if (BROTLI_IS_OOM(m)) return;
   num_final_clusters = FN(BrotliHistogramCombine)(
       all_histograms, tmp, cluster_size, histogram_symbols, clusters, pairs,
       num_clusters, num_blocks, BROTLI_MAX_NUMBER_OF_BLOCK_TYPES,
@@ -346,7 +348,9 @@ static void FN(ClusterBlocks)(MemoryManager* m,
       best_bits = FN(BrotliHistogramBitCostDistance)(
           tmp, &all_histograms[best_out], tmp + 1);
       for (j = 0; j < num_final_clusters; ++j) {
-        const double cur_bits = FN(BrotliHistogramBitCostDistance)(
+        double cur_bits;
+        if (clusters[j] == best_out) continue;
+        cur_bits = FN(BrotliHistogramBitCostDistance)(
             tmp, &all_histograms[clusters[j]], tmp + 1);
         if (cur_bits < best_bits) {
           best_bits = cur_bits;
@@ -24,6 +24,11 @@ typedef struct HistogramPair {
   double cost_diff;
 } HistogramPair;
 
+/* Once there are more than 2 * BROTLI_CLUSTER_PAIR_WINDOW clusters, each one
+   is only paired with this many neighbours on each side, in the order set by
+   BrotliHistogramSortClusters*; otherwise all pairs are considered. */
+#define BROTLI_CLUSTER_PAIR_WINDOW 32
+
 #define CODE(X) /* Declaration */;
 
 #define FN(X) X ## Literal
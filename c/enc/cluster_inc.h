@@ -43,8 +43,7 @@ BROTLI_INTERNAL void FN(BrotliCompareAndPushToQueue)(
     double threshold = *num_pairs == 0 ? 1e99 :
         BROTLI_MAX(double, 0.0, pairs[0].cost_diff);
     double cost_combo;
-    *tmp = out[idx1];
-    FN(HistogramAddHistogram)(tmp, &out[idx2]);
+    FN(HistogramSetSum)(tmp, &out[idx1], &out[idx2]);
     cost_combo = FN(BrotliPopulationCost)(tmp);
     if (cost_combo < threshold - p.cost_diff) {
       p.cost_combo = cost_combo;
@@ -84,10 +83,13 @@ BROTLI_INTERNAL size_t FN(BrotliHistogramCombine)(HistogramType* out,
   {
     /* We maintain a vector of histogram pairs, with the property that the pair
        with the maximum bit cost reduction is the first. */
+    const size_t window = (num_clusters > 2 * BROTLI_CLUSTER_PAIR_WINDOW) ?
+        BROTLI_CLUSTER_PAIR_WINDOW : num_clusters;
     size_t idx1;
     for (idx1 = 0; idx1 < num_clusters; ++idx1) {
+      const size_t end = BROTLI_MIN(size_t, num_clusters, idx1 + 1 + window);
       size_t idx2;
-      for (idx2 = idx1 + 1; idx2 < num_clusters; ++idx2) {
+      for (idx2 = idx1 + 1; idx2 < end; ++idx2) {
         FN(BrotliCompareAndPushToQueue)(out, tmp, cluster_size, clusters[idx1],
             clusters[idx2], max_num_pairs, &pairs[0], &num_pairs);
       }
@@ -97,6 +99,9 @@ BROTLI_INTERNAL size_t FN(BrotliHistogramCombine)(HistogramType* out,
   while (num_clusters > min_cluster_size) {
     uint32_t best_idx1;
     uint32_t best_idx2;
+    size_t best_pos = 0;
+    size_t begin;
+    size_t end;
     size_t i;
     if (pairs[0].cost_diff >= cost_diff_threshold) {
       cost_diff_threshold = 1e99;
@@ -146,7 +151,17 @@ BROTLI_INTERNAL size_t FN(BrotliHistogramCombine)(HistogramType* out,
     }
 
     /* Push new pairs formed with the combined histogram to the heap. */
-    for (i = 0; i < num_clusters; ++i) {
+    if (num_clusters > 2 * BROTLI_CLUSTER_PAIR_WINDOW) {
+      while (clusters[best_pos] != best_idx1) ++best_pos;
+      begin = best_pos - BROTLI_MIN(size_t, best_pos,
+                                    BROTLI_CLUSTER_PAIR_WINDOW);
+      end = BROTLI_MIN(size_t, num_clusters,
+                       best_pos + 1 + BROTLI_CLUSTER_PAIR_WINDOW);
+    } else {
+      begin = 0;
+      end = num_clusters;
+    }
+    for (i = begin; i < end; ++i) {
       FN(BrotliCompareAndPushToQueue)(out, tmp, cluster_size, best_idx1,
           clusters[i], max_num_pairs, &pairs[0], &num_pairs);
     }
@@ -161,8 +176,7 @@ BROTLI_INTERNAL double FN(BrotliHistogramBitCostDistance)(
   if (histogram->total_count_ == 0) {
     return 0.0;
   } else {
-    *tmp = *histogram;
-    FN(HistogramAddHistogram)(tmp, candidate);
+    FN(HistogramSetSum)(tmp, histogram, candidate);
     return FN(BrotliPopulationCost)(tmp) - candidate->bit_cost_;
   }
 })
@@ -177,11 +191,19 @@ BROTLI_INTERNAL void FN(BrotliHistogramRemap)(const HistogramType* in,
   size_t i;
   for (i = 0; i < in_size; ++i) {
     uint32_t best_out = i == 0 ? symbols[0] : symbols[i - 1];
-    double best_bits =
-        FN(BrotliHistogramBitCostDistance)(&in[i], &out[best_out], tmp);
+    double best_bits;
     size_t j;
+    /* Empty histogram is equally cheap anywhere; keep the previous choice. */
+    if (in[i].total_count_ == 0) {
+      symbols[i] = best_out;
+      continue;
+    }
+    best_bits =
+        FN(BrotliHistogramBitCostDistance)(&in[i], &out[best_out], tmp);
     for (j = 0; j < num_clusters; ++j) {
-      const double cur_bits =
+      double cur_bits;
+      if (clusters[j] == best_out) continue;
+      cur_bits =
           FN(BrotliHistogramBitCostDistance)(&in[i], &out[clusters[j]], tmp);
       if (cur_bits < best_bits) {
         best_bits = cur_bits;
@@ -248,6 +270,53 @@ BROTLI_INTERNAL size_t FN(BrotliHistogramReindex)(MemoryManager* m,
   return next_index;
 })
 
+/* Reorders clusters[0..num_clusters) so that histograms with similar
+   signatures (dominant symbol, then bits per symbol) become neighbours; this
+   is what makes the windowed pair search in BrotliHistogramCombine find the
+   good candidates. Does nothing when all pairs are going to be searched. */
+BROTLI_INTERNAL void FN(BrotliHistogramSortClusters)(MemoryManager* m,
+    const HistogramType* out, uint32_t* clusters, size_t num_clusters) CODE({
+  uint64_t* keys;
+  size_t i;
+  if (num_clusters <= 2 * BROTLI_CLUSTER_PAIR_WINDOW) return;
+  keys = BROTLI_ALLOC(m, uint64_t, num_clusters);
+  if (BROTLI_IS_OOM(m) || BROTLI_IS_NULL(keys)) return;
+  for (i = 0; i < num_clusters; ++i) {
+    const HistogramType* h = &out[clusters[i]];
+    uint32_t dominant = 0;
+    uint32_t bits = 0;
+    size_t j;
+    for (j = 1; j < FN(HistogramDataSize)(); ++j) {
+      if (h->data_[j] > h->data_[dominant]) dominant = (uint32_t)j;
+    }
+    if (h->total_count_ != 0) {
+      double bits_per_symbol = h->bit_cost_ / (double)h->total_count_;
+      bits = (uint32_t)BROTLI_MIN(double, 65535.0, bits_per_symbol * 4096.0);
+    }
+    keys[i] = ((uint64_t)dominant << 48) | ((uint64_t)bits << 32) |
+        clusters[i];
+  }
+  /* Shell sort; keys are unique, so the result does not depend on stability. */
+  {
+    size_t gap = 1;
+    while (gap < num_clusters / 3) gap = 3 * gap + 1;
+    for (; gap > 0; gap /= 3) {
+      for (i = gap; i < num_clusters; ++i) {
+        uint64_t key = keys[i];
+        size_t j = i;
+        for (; j >= gap && key < keys[j - gap]; j -= gap) {
+          keys[j] = keys[j - gap];
+        }
+        keys[j] = key;
+      }
+    }
+  }
+  for (i = 0; i < num_clusters; ++i) {
+    clusters[i] = (uint32_t)(keys[i] & 0xFFFFFFFFu);
+  }
+  BROTLI_FREE(m, keys);
+})
+
 BROTLI_INTERNAL void FN(BrotliClusterHistograms)(
     MemoryManager* m, const HistogramType* in, const size_t in_size,
     size_t max_histograms, HistogramType* out, size_t* out_size,
@@ -303,6 +372,8 @@ BROTLI_INTERNAL void FN(BrotliClusterHistograms)(
     BROTLI_ENSURE_CAPACITY(
         m, HistogramPair, pairs, pairs_capacity, max_num_pairs + 1);
     if (BROTLI_IS_OOM(m)) return;
+    FN(BrotliHistogramSortClusters)(m, out, clusters, num_clusters);
+    if (BROTLI_IS_OOM(m)) return;
 
     /* Collapse similar histograms. */
     num_clusters = FN(BrotliHistogramCombine)(out, tmp, cluster_size,
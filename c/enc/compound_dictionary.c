@@ -10,162 +10,75 @@
 #include <brotli/shared_dictionary.h>
 #include "memory.h"
 
-static PreparedDictionary* CreatePreparedDictionaryWithParams(MemoryManager* m,
+static PreparedDictionary* CreateBucketedPreparedDictionary(MemoryManager* m,
     const uint8_t* source, size_t source_size, uint32_t bucket_bits,
-    uint32_t slot_bits, uint32_t hash_bits, uint16_t bucket_limit) {
-  /* Step 1: create "bloated" hasher. */
-  uint32_t num_slots = 1u << slot_bits;
-  uint32_t num_buckets = 1u << bucket_bits;
+    uint32_t hash_bits) {
+  size_t num_buckets = (size_t)1 << bucket_bits;
+  size_t num_items = num_buckets << PREPARED_DICTIONARY_BUCKET_BITS;
   uint32_t hash_shift = 64u - bucket_bits;
   uint64_t hash_mask = (~((uint64_t)0U)) >> (64 - hash_bits);
-  uint32_t slot_mask = num_slots - 1;
-  size_t alloc_size = (sizeof(uint32_t) << slot_bits) +
-      (sizeof(uint32_t) << slot_bits) +
-      (sizeof(uint16_t) << bucket_bits) +
-      (sizeof(uint32_t) << bucket_bits) +
-      (sizeof(uint32_t) * source_size);
-  uint8_t* flat = NULL;
+  uint32_t tag_bits = PreparedDictionaryTagBits((uint32_t)source_size);
+  size_t alloc_size = sizeof(PreparedDictionary) +
+      (sizeof(uint32_t) * num_items) + sizeof(uint8_t*);
   PreparedDictionary* result = NULL;
-  uint16_t* num = NULL;
-  uint32_t* bucket_heads = NULL;
-  uint32_t* next_bucket = NULL;
-  uint32_t* slot_offsets = NULL;
-  uint16_t* heads = NULL;
+  uint8_t* num = NULL;
   uint32_t* items = NULL;
   uint8_t** source_ref = NULL;
-  uint32_t i;
-  uint32_t* slot_size = NULL;
-  uint32_t* slot_limit = NULL;
-  uint32_t total_items = 0;
-  if (slot_bits > 16) return NULL;
-  if (slot_bits > bucket_bits) return NULL;
-  if (bucket_bits - slot_bits >= 16) return NULL;
-
-  flat = BROTLI_ALLOC(m, uint8_t, alloc_size);
-  if (BROTLI_IS_OOM(m) || BROTLI_IS_NULL(flat)) return NULL;
-
-  slot_size = (uint32_t*)flat;
-  slot_limit = (uint32_t*)(&slot_size[num_slots]);
-  num = (uint16_t*)(&slot_limit[num_slots]);
-  bucket_heads = (uint32_t*)(&num[num_buckets]);
-  next_bucket = (uint32_t*)(&bucket_heads[num_buckets]);
-  memset(num, 0, num_buckets * sizeof(num[0]));
-
-  /* TODO(eustas): apply custom "store" order. */
-  for (i = 0; i + 7 < source_size; ++i) {
-    const uint64_t h = (BROTLI_UNALIGNED_LOAD64LE(&source[i]) & hash_mask) *
-        kPreparedDictionaryHashMul64Long;
-    const uint32_t key = (uint32_t)(h >> hash_shift);
-    uint16_t count = num[key];
-    next_bucket[i] = (count == 0) ? ((uint32_t)(-1)) : bucket_heads[key];
-    bucket_heads[key] = i;
-    count++;
-    if (count > bucket_limit) count = bucket_limit;
-    num[key] = count;
-  }
-
-  /* Step 2: find slot limits. */
-  for (i = 0; i < num_slots; ++i) {
-    BROTLI_BOOL overflow = BROTLI_FALSE;
-    slot_limit[i] = bucket_limit;
-    while (BROTLI_TRUE) {
-      uint32_t limit = slot_limit[i];
-      size_t j;
-      uint32_t count = 0;
-      overflow = BROTLI_FALSE;
-      for (j = i; j < num_buckets; j += num_slots) {
-        uint32_t size = num[j];
-        /* Last chain may span behind 64K limit; overflow happens only if
-           we are about to use 0xFFFF+ as item offset. */
-        if (count >= 0xFFFF) {
-          overflow = BROTLI_TRUE;
-          break;
-        }
-        if (size > limit) size = limit;
-        count += size;
-      }
-      if (!overflow) {
-        slot_size[i] = count;
-        total_items += count;
-        break;
-      }
-      slot_limit[i]--;
-    }
-  }
-
-  /* Step 3: transfer data to "slim" hasher. */
-  alloc_size = sizeof(PreparedDictionary) + (sizeof(uint32_t) << slot_bits) +
-      (sizeof(uint16_t) << bucket_bits) + (sizeof(uint32_t) * total_items) +
-      sizeof(uint8_t*);
+  size_t i;
 
+  num = BROTLI_ALLOC(m, uint8_t, num_buckets);
+  if (BROTLI_IS_OOM(m) || BROTLI_IS_NULL(num)) return NULL;
   result = (PreparedDictionary*)BROTLI_ALLOC(m, uint8_t, alloc_size);
   if (BROTLI_IS_OOM(m) || BROTLI_IS_NULL(result)) {
-    BROTLI_FREE(m, flat);
+    BROTLI_FREE(m, num);
     return NULL;
   }
-  slot_offsets = (uint32_t*)(&result[1]);
-  heads = (uint16_t*)(&slot_offsets[num_slots]);
-  items = (uint32_t*)(&heads[num_buckets]);
-  source_ref = (uint8_t**)(&items[total_items]);
+  items = (uint32_t*)(&result[1]);
+  source_ref = (uint8_t**)(&items[num_items]);
 
-  result->magic = kLeanPreparedDictionaryMagic;
-  result->num_items = total_items;
+  result->magic = kLeanBucketedPreparedDictionaryMagic;
+  result->num_items = (uint32_t)num_items;
   result->source_size = (uint32_t)source_size;
   result->hash_bits = hash_bits;
   result->bucket_bits = bucket_bits;
-  result->slot_bits = slot_bits;
+  result->slot_bits = PREPARED_DICTIONARY_BUCKET_BITS;
   BROTLI_UNALIGNED_STORE_PTR(source_ref, source);
 
-  total_items = 0;
-  for (i = 0; i < num_slots; ++i) {
-    slot_offsets[i] = total_items;
-    total_items += slot_size[i];
-    slot_size[i] = 0;
-  }
-  for (i = 0; i < num_buckets; ++i) {
-    uint32_t slot = i & slot_mask;
-    uint32_t count = num[i];
-    uint32_t pos;
-    size_t j;
-    size_t cursor = slot_size[slot];
-    if (count > slot_limit[slot]) count = slot_limit[slot];
-    if (count == 0) {
-      heads[i] = 0xFFFF;
-      continue;
-    }
-    heads[i] = (uint16_t)cursor;
-    cursor += slot_offsets[slot];
-    slot_size[slot] += count;
-    pos = bucket_heads[i];
-    for (j = 0; j < count; j++) {
-      items[cursor++] = pos;
-      pos = next_bucket[pos];
-    }
-    items[cursor - 1] |= 0x80000000;
+  memset(num, 0, num_buckets * sizeof(num[0]));
+  memset(items, 0xFF, num_items * sizeof(items[0]));
+  /* Buckets keep the most recent positions, so source is scanned backwards;
+     older positions are dropped when bucket is full. */
+  for (i = (source_size >= 8) ? source_size - 7 : 0; i > 0; --i) {
+    const size_t pos = i - 1;
+    const uint64_t h = (BROTLI_UNALIGNED_LOAD64LE(&source[pos]) & hash_mask) *
+        kPreparedDictionaryHashMul64Long;
+    const size_t key = (size_t)(h >> hash_shift);
+    if (num[key] == PREPARED_DICTIONARY_BUCKET_SIZE) continue;
+    items[(key << PREPARED_DICTIONARY_BUCKET_BITS) + num[key]] =
+        (uint32_t)pos | PreparedDictionaryTag(&source[pos], tag_bits);
+    num[key]++;
   }
 
-  BROTLI_FREE(m, flat);
+  BROTLI_FREE(m, num);
   return result;
 }
 
 PreparedDictionary* CreatePreparedDictionary(MemoryManager* m,
     const uint8_t* source, size_t source_size) {
-  uint32_t bucket_bits = 17;
-  uint32_t slot_bits = 7;
-  uint32_t hash_bits = 40;
-  uint16_t bucket_limit = 32;
-  size_t volume = 16u << bucket_bits;
+  uint32_t bucket_bits = 8;
+  /* Hash 5 bytes; in larger dictionaries 5-byte prefixes are too common,
+     so 6 bytes are hashed to keep buckets less crowded. */
+  uint32_t hash_bits = (source_size < ((size_t)1 << 21)) ? 40 : 48;
   if (source_size > SHARED_BROTLI_MAX_RAW_DICT_SIZE) {
     return NULL;
   }
-  /* Tune parameters to fit dictionary size. */
-  while (volume < source_size && bucket_bits < 22) {
+  /* Tune parameters to fit dictionary size: on average a bucket covers
+     16 positions, i.e. index is about 4 bytes per dictionary byte. */
+  while (((size_t)16 << bucket_bits) < source_size && bucket_bits < 22) {
     bucket_bits++;
-    slot_bits++;
-    volume <<= 1;
   }
-  return CreatePreparedDictionaryWithParams(m,
-      source, source_size, bucket_bits, slot_bits, hash_bits, bucket_limit);
+  return CreateBucketedPreparedDictionary(
+      m, source, source_size, bucket_bits, hash_bits);
 }
 
 void DestroyPreparedDictionary(MemoryManager* m,
@@ -174,6 +87,168 @@ void DestroyPreparedDictionary(MemoryManager* m,
   BROTLI_FREE(m, dictionary);
 }
 
+/* Size of the part that is the same in "fat" and "lean" dictionaries. */
+static size_t PreparedDictionaryIndexSize(
+    const PreparedDictionary* dictionary) {
+  if (IsBucketedPreparedDictionary(dictionary)) {
+    return sizeof(PreparedDictionary) +
+        (sizeof(uint32_t) * dictionary->num_items);
+  }
+  return sizeof(PreparedDictionary) +
+      (sizeof(uint32_t) << dictionary->slot_bits) +
+      (sizeof(uint16_t) << dictionary->bucket_bits) +
+      (sizeof(uint32_t) * dictionary->num_items);
+}
+
+size_t GetPreparedDictionaryMemoryUsage(
+    const PreparedDictionary* dictionary) {
+  size_t index_size = PreparedDictionaryIndexSize(dictionary);
+  if (dictionary->magic == kPreparedDictionaryMagic ||
+      dictionary->magic == kBucketedPreparedDictionaryMagic) {
+    return index_size + dictionary->source_size;
+  }
+  return index_size + sizeof(uint8_t*);
+}
+
+static const uint8_t* PreparedDictionarySource(
+    const PreparedDictionary* dictionary) {
+  const uint8_t* tail =
+      (const uint8_t*)dictionary + PreparedDictionaryIndexSize(dictionary);
+  if (dictionary->magic == kPreparedDictionaryMagic ||
+      dictionary->magic == kBucketedPreparedDictionaryMagic) {
+    return tail;
+  } else {
+    /* Lean dictionaries. */
+    return (const uint8_t*)BROTLI_UNALIGNED_LOAD_PTR((const uint8_t**)tail);
+  }
+}
+
+size_t GetPreparedDictionarySerializedSize(
+    const PreparedDictionary* dictionary) {
+  return PreparedDictionaryIndexSize(dictionary) + dictionary->source_size;
+}
+
+void SerializePreparedDictionary(
+    const PreparedDictionary* dictionary, uint8_t* out) {
+  const size_t index_size = PreparedDictionaryIndexSize(dictionary);
+  const uint32_t magic = IsBucketedPreparedDictionary(dictionary) ?
+      kBucketedPreparedDictionaryMagic : kPreparedDictionaryMagic;
+  memcpy(out, dictionary, index_size);
+  memcpy(out, &magic, sizeof(magic));
+  memcpy(out + index_size, PreparedDictionarySource(dictionary),
+         dictionary->source_size);
+}
+
+static BROTLI_BOOL IsValidChainedIndex(
+    const PreparedDictionary* dictionary, size_t size) {
+  const uint32_t* slot_offsets;
+  const uint16_t* heads;
+  const uint32_t* items;
+  size_t num_slots;
+  size_t num_buckets;
+  size_t lookup_size;
+  size_t available;
+  size_t i;
+  /* Same limits as in Java PreparedDictionaryGenerator. Zero slot (and so
+     bucket) bits would make the lookup shift by the full word width. */
+  if (dictionary->slot_bits == 0 || dictionary->slot_bits > 16) {
+    return BROTLI_FALSE;
+  }
+  if (dictionary->slot_bits > dictionary->bucket_bits) return BROTLI_FALSE;
+  if (dictionary->bucket_bits - dictionary->slot_bits >= 16) {
+    return BROTLI_FALSE;
+  }
+  num_slots = (size_t)1 << dictionary->slot_bits;
+  num_buckets = (size_t)1 << dictionary->bucket_bits;
+  lookup_size = sizeof(uint32_t) * num_slots + sizeof(uint16_t) * num_buckets;
+  available = size - sizeof(PreparedDictionary);
+  if (available < lookup_size) return BROTLI_FALSE;
+  available -= lookup_size;
+  if (available / sizeof(uint32_t) < dictionary->num_items) {
+    return BROTLI_FALSE;
+  }
+  available -= sizeof(uint32_t) * dictionary->num_items;
+  if (available != dictionary->source_size) return BROTLI_FALSE;
+
+  slot_offsets = (const uint32_t*)(&dictionary[1]);
+  heads = (const uint16_t*)(&slot_offsets[num_slots]);
+  items = (const uint32_t*)(&heads[num_buckets]);
+  /* Chains are walked until the item with the highest bit set; the last
+     item has to have it to keep walks inside of the items array. */
+  if (dictionary->num_items != 0 &&
+      (items[dictionary->num_items - 1] & 0x80000000) == 0) {
+    return BROTLI_FALSE;
+  }
+  for (i = 0; i < num_slots; ++i) {
+    if (slot_offsets[i] > dictionary->num_items) return BROTLI_FALSE;
+  }
+  for (i = 0; i < num_buckets; ++i) {
+    if (heads[i] == 0xFFFF) continue;
+    if ((size_t)slot_offsets[i & (num_slots - 1)] + heads[i] >=
+        dictionary->num_items) {
+      return BROTLI_FALSE;
+    }
+  }
+  for (i = 0; i < dictionary->num_items; ++i) {
+    if ((items[i] & 0x7FFFFFFF) >= dictionary->source_size) {
+      return BROTLI_FALSE;
+    }
+  }
+  return BROTLI_TRUE;
+}
+
+static BROTLI_BOOL IsValidBucketedIndex(
+    const PreparedDictionary* dictionary, size_t size) {
+  const uint32_t* items = (const uint32_t*)(&dictionary[1]);
+  const uint32_t tag_bits =
+      PreparedDictionaryTagBits(dictionary->source_size);
+  const uint32_t offset_mask = 0x7FFFFFFFu >> tag_bits;
+  size_t num_items;
+  size_t available;
+  size_t i;
+  /* Same limits as in CreatePreparedDictionary. */
+  if (dictionary->slot_bits != PREPARED_DICTIONARY_BUCKET_BITS) {
+    return BROTLI_FALSE;
+  }
+  /* Zero bits would make the lookup shift by the full word width. */
+  if (dictionary->bucket_bits == 0 || dictionary->bucket_bits > 22) {
+    return BROTLI_FALSE;
+  }
+  num_items = (size_t)1 << (dictionary->bucket_bits + dictionary->slot_bits);
+  if (dictionary->num_items != num_items) return BROTLI_FALSE;
+  available = size - sizeof(PreparedDictionary);
+  if (available / sizeof(uint32_t) < num_items) return BROTLI_FALSE;
+  available -= sizeof(uint32_t) * num_items;
+  if (available != dictionary->source_size) return BROTLI_FALSE;
+  for (i = 0; i < num_items; ++i) {
+    if (items[i] & 0x80000000) continue;  /* Unused. */
+    if ((items[i] & offset_mask) >= dictionary->source_size) {
+      return BROTLI_FALSE;
+    }
+  }
+  return BROTLI_TRUE;
+}
+
+BROTLI_BOOL IsValidSerializedPreparedDictionary(
+    const uint8_t* data, size_t size) {
+  const PreparedDictionary* dictionary = (const PreparedDictionary*)data;
+  if ((((size_t)data) & 3) != 0) return BROTLI_FALSE;
+  if (size < sizeof(PreparedDictionary)) return BROTLI_FALSE;
+  /* Hash covers (at most) 8 bytes, i.e. 64 bits. */
+  if (dictionary->hash_bits == 0 || dictionary->hash_bits > 64) {
+    return BROTLI_FALSE;
+  }
+  if (dictionary->source_size > SHARED_BROTLI_MAX_RAW_DICT_SIZE) {
+    return BROTLI_FALSE;
+  }
+  if (dictionary->magic == kPreparedDictionaryMagic) {
+    return IsValidChainedIndex(dictionary, size);
+  } else if (dictionary->magic == kBucketedPreparedDictionaryMagic) {
+    return IsValidBucketedIndex(dictionary, size);
+  }
+  return BROTLI_FALSE;
+}
+
 BROTLI_BOOL AttachPreparedDictionary(
     CompoundDictionary* compound, const PreparedDictionary* dictionary) {
   size_t length = 0;
@@ -193,19 +268,7 @@ BROTLI_BOOL AttachPreparedDictionary(
   compound->total_size += length;
   compound->chunks[index] = dictionary;
   compound->chunk_offsets[index + 1] = compound->total_size;
-  {
-    uint32_t* slot_offsets = (uint32_t*)(&dictionary[1]);
-    uint16_t* heads = (uint16_t*)(&slot_offsets[(size_t)1u << dictionary->slot_bits]);
-    uint32_t* items = (uint32_t*)(&heads[(size_t)1u << dictionary->bucket_bits]);
-    const void* tail = (void*)&items[dictionary->num_items];
-    if (dictionary->magic == kPreparedDictionaryMagic) {
-      compound->chunk_source[index] = (const uint8_t*)tail;
-    } else {
-      /* dictionary->magic == kLeanPreparedDictionaryMagic */
-      compound->chunk_source[index] =
-          (const uint8_t*)BROTLI_UNALIGNED_LOAD_PTR((const uint8_t**)tail);
-    }
-  }
+  compound->chunk_source[index] = PreparedDictionarySource(dictionary);
   compound->num_chunks++;
   return BROTLI_TRUE;
 }
@@ -9,6 +9,7 @@
 
 #include "../common/platform.h"
 #include <brotli/shared_dictionary.h>
+#include "fast_log.h"
 #include "memory.h"
 
 /* "Fat" prepared dictionary, could be cooked outside of C implementation,
@@ -24,9 +25,21 @@ static const uint32_t kManagedDictionaryMagic = 0xDEBCEDE2;
  * dictionary is in use. */
 static const uint32_t kLeanPreparedDictionaryMagic = 0xDEBCEDE3;
 
+/* "Fat" and "lean" prepared dictionaries with bucketed index (see below). */
+static const uint32_t kBucketedPreparedDictionaryMagic = 0xDEBCEDE5;
+static const uint32_t kLeanBucketedPreparedDictionaryMagic = 0xDEBCEDE6;
+
 static const uint64_t kPreparedDictionaryHashMul64Long =
     BROTLI_MAKE_UINT64_T(0x1FE35A7Bu, 0xD3579BD3u);
 
+/* Multiplier for tags of bucketed index items. */
+static const uint64_t kPreparedDictionaryTagMul64 =
+    BROTLI_MAKE_UINT64_T(0x9E3779B9u, 0x7F4A7C15u);
+
+/* Bucketed index has 16 items (i.e. 64 bytes) per bucket. */
+#define PREPARED_DICTIONARY_BUCKET_BITS 4
+#define PREPARED_DICTIONARY_BUCKET_SIZE (1u << PREPARED_DICTIONARY_BUCKET_BITS)
+
 typedef struct PreparedDictionary {
   uint32_t magic;
   uint32_t num_items;
@@ -37,20 +50,76 @@ typedef struct PreparedDictionary {
 
   /* --- Dynamic size members --- */
 
+  /* Chained index: */
   /* uint32_t slot_offsets[1 << slot_bits]; */
   /* uint16_t heads[1 << bucket_bits]; */
   /* uint32_t items[variable]; */
 
+  /* Bucketed index (slot_bits == PREPARED_DICTIONARY_BUCKET_BITS):
+     uint32_t items[1 << (bucket_bits + slot_bits)];
+     Each bucket is a run of (1 << slot_bits) items, most recent positions
+     first. Unused items have the highest bit set. Lower bits of item contain
+     offset, the rest is a tag of 8 bytes at that offset; tags allow to skip
+     items that could not have 8+ byte match without touching LZ77 data. */
+
   /* [maybe] uint8_t* source_ref, depending on magic. */
   /* [maybe] uint8_t source[source_size], depending on magic. */
 } PreparedDictionary;
 
+static BROTLI_INLINE BROTLI_BOOL IsPreparedDictionaryMagic(uint32_t magic) {
+  return TO_BROTLI_BOOL(magic == kPreparedDictionaryMagic ||
+      magic == kLeanPreparedDictionaryMagic ||
+      magic == kBucketedPreparedDictionaryMagic ||
+      magic == kLeanBucketedPreparedDictionaryMagic);
+}
+
+static BROTLI_INLINE BROTLI_BOOL IsBucketedPreparedDictionary(
+    const PreparedDictionary* dictionary) {
+  return TO_BROTLI_BOOL(
+      dictionary->magic == kBucketedPreparedDictionaryMagic ||
+      dictionary->magic == kLeanBucketedPreparedDictionaryMagic);
+}
+
+/* Number of tag bits in items of bucketed index. */
+static BROTLI_INLINE uint32_t PreparedDictionaryTagBits(uint32_t source_size) {
+  if (source_size <= 1) return 30;
+  return 30 - Log2FloorNonZero(source_size - 1);
+}
+
+/* Tag of the item that refers to |data|, already shifted into place. */
+static BROTLI_INLINE uint32_t PreparedDictionaryTag(
+    const uint8_t* data, uint32_t tag_bits) {
+  uint64_t h;
+  if (tag_bits == 0) return 0;
+  h = BROTLI_UNALIGNED_LOAD64LE(data) * kPreparedDictionaryTagMul64;
+  return (uint32_t)(h >> (64 - tag_bits)) << (31 - tag_bits);
+}
+
 BROTLI_INTERNAL PreparedDictionary* CreatePreparedDictionary(MemoryManager* m,
     const uint8_t* source, size_t source_size);
 
 BROTLI_INTERNAL void DestroyPreparedDictionary(MemoryManager* m,
     PreparedDictionary* dictionary);
 
+/* Returns the number of bytes occupied by |dictionary| (including LZ77 data
+   only if it is stored inside). */
+BROTLI_INTERNAL size_t GetPreparedDictionaryMemoryUsage(
+    const PreparedDictionary* dictionary);
+
+/* Returns the size of "fat" representation of (either kind of) dictionary. */
+BROTLI_INTERNAL size_t GetPreparedDictionarySerializedSize(
+    const PreparedDictionary* dictionary);
+
+/* Writes "fat" representation of (either kind of) dictionary to |out|.
+   REQUIRES: |out| has GetPreparedDictionarySerializedSize() bytes. */
+BROTLI_INTERNAL void SerializePreparedDictionary(
+    const PreparedDictionary* dictionary, uint8_t* out);
+
+/* Checks that |data| is a well-formed "fat" dictionary that is safe to use
+   in place. |data| has to be 4-byte aligned. */
+BROTLI_INTERNAL BROTLI_BOOL IsValidSerializedPreparedDictionary(
+    const uint8_t* data, size_t size);
+
 typedef struct CompoundDictionary {
   /* LZ77 prefix, compound dictionary */
   size_t num_chunks;
@@ -59,6 +128,9 @@ typedef struct CompoundDictionary {
   const PreparedDictionary* chunks[SHARED_BROTLI_MAX_COMPOUND_DICTS + 1];
   const uint8_t* chunk_source[SHARED_BROTLI_MAX_COMPOUND_DICTS + 1];
   size_t chunk_offsets[SHARED_BROTLI_MAX_COMPOUND_DICTS + 1];
+  /* Bit i is set if chunk i is searched for matches. Other chunks still
+     take their place in the distance space. */
+  uint32_t search_mask;
 
   size_t num_prepared_instances_;
   /* Owned instances. */
@@ -118,6 +118,11 @@ BROTLI_BOOL BrotliEncoderSetParameter(
       state->params.simd_hasher = (BrotliEncoderSimdHasher)value;
       return BROTLI_TRUE;
 
+    case BROTLI_PARAM_DICTIONARY_SELECTION:
+      if ((value != 0) && (value != 1)) return BROTLI_FALSE;
+      state->params.dictionary_selection = TO_BROTLI_BOOL(!!value);
+      return BROTLI_TRUE;
+
     default: return BROTLI_FALSE;
   }
 }
@@ -495,6 +500,11 @@ static ContextType ChooseContextMode(const BrotliEncoderParams* params,
   return CONTEXT_UTF8;
 }
 
+static BROTLI_INLINE void ReportStage(brotli_encoder_stage_func stage_func,
+    void* stage_opaque, BrotliEncoderStage stage) {
+  if (stage_func) stage_func(stage_opaque, stage);
+}
+
 static void WriteMetaBlockInternal(MemoryManager* m,
                                    const uint8_t* data,
                                    const size_t mask,
@@ -513,7 +523,9 @@ static void WriteMetaBlockInternal(MemoryManager* m,
                                    const int* saved_dist_cache,
                                    int* dist_cache,
                                    size_t* storage_ix,
-                                   uint8_t* storage) {
+                                   uint8_t* storage,
+                                   brotli_encoder_stage_func stage_func,
+                                   void* stage_opaque) {
   uint16_t last_bytes;
   uint8_t last_bytes_bits;
   ContextLut literal_context_lut = BROTLI_CONTEXT_LUT(literal_context_mode);
@@ -528,6 +540,7 @@ static void WriteMetaBlockInternal(MemoryManager* m,
 
   if (!ShouldCompress(data, mask, last_flush_pos, bytes,
                       num_literals, num_commands)) {
+    ReportStage(stage_func, stage_opaque, BROTLI_ENCODER_STAGE_ENTROPY_CODING);
     /* Restore the distance cache, as its last update by
        CreateBackwardReferences is now unused. */
     memcpy(dist_cache, saved_dist_cache, 4 * sizeof(dist_cache[0]));
@@ -541,12 +554,14 @@ static void WriteMetaBlockInternal(MemoryManager* m,
   last_bytes = (uint16_t)((storage[1] << 8) | storage[0]);
   last_bytes_bits = (uint8_t)(*storage_ix);
   if (params->quality <= MAX_QUALITY_FOR_STATIC_ENTROPY_CODES) {
+    ReportStage(stage_func, stage_opaque, BROTLI_ENCODER_STAGE_ENTROPY_CODING);
     BrotliStoreMetaBlockFast(m, data, (size_t)last_flush_pos,
                              bytes, mask, is_last, params,
                              commands, num_commands,
                              storage_ix, storage);
     if (BROTLI_IS_OOM(m)) return;
   } else if (params->quality < MIN_QUALITY_FOR_BLOCK_SPLIT) {
+    ReportStage(stage_func, stage_opaque, BROTLI_ENCODER_STAGE_ENTROPY_CODING);
     BrotliStoreMetaBlockTrivial(m, data, (size_t)last_flush_pos,
                                 bytes, mask, is_last, params,
                                 commands, num_commands,
@@ -555,6 +570,7 @@ static void WriteMetaBlockInternal(MemoryManager* m,
   } else {
     MetaBlockSplit mb;
     InitMetaBlockSplit(&mb);
+    ReportStage(stage_func, stage_opaque, BROTLI_ENCODER_STAGE_BLOCK_SPLITTING);
     if (params->quality < MIN_QUALITY_FOR_HQ_BLOCK_SPLITTING) {
       size_t num_literal_contexts = 1;
       const uint32_t* literal_context_map = NULL;
@@ -590,6 +606,7 @@ static void WriteMetaBlockInternal(MemoryManager* m,
          for "Large Window Brotli" (32-bit). */
       BrotliOptimizeHistograms(block_params.dist.alphabet_size_limit, &mb);
     }
+    ReportStage(stage_func, stage_opaque, BROTLI_ENCODER_STAGE_ENTROPY_CODING);
     BrotliStoreMetaBlock(m, data, (size_t)last_flush_pos, bytes, mask,
                          prev_byte, prev_byte2,
                          is_last,
@@ -682,13 +699,18 @@ static BROTLI_BOOL EnsureInitialized(BrotliEncoderState* s) {
     }
   }
 
+  /* Arenas could be left from the previous stream (see BrotliEncoderReset). */
   if (s->params.quality == FAST_ONE_PASS_COMPRESSION_QUALITY) {
-    s->one_pass_arena_ = BROTLI_ALLOC(m, BrotliOnePassArena, 1);
-    if (BROTLI_IS_OOM(m)) return BROTLI_FALSE;
+    if (!s->one_pass_arena_) {
+      s->one_pass_arena_ = BROTLI_ALLOC(m, BrotliOnePassArena, 1);
+      if (BROTLI_IS_OOM(m)) return BROTLI_FALSE;
+    }
     InitCommandPrefixCodes(s->one_pass_arena_);
   } else if (s->params.quality == FAST_TWO_PASS_COMPRESSION_QUALITY) {
-    s->two_pass_arena_ = BROTLI_ALLOC(m, BrotliTwoPassArena, 1);
-    if (BROTLI_IS_OOM(m)) return BROTLI_FALSE;
+    if (!s->two_pass_arena_) {
+      s->two_pass_arena_ = BROTLI_ALLOC(m, BrotliTwoPassArena, 1);
+      if (BROTLI_IS_OOM(m)) return BROTLI_FALSE;
+    }
   }
 
   s->is_initialized_ = BROTLI_TRUE;
@@ -708,6 +730,7 @@ static void BrotliEncoderInitParams(BrotliEncoderParams* params) {
   params->base64_mode = (int)BROTLI_DEFAULT_BASE64_MODE;
   params->max_base64_regions = BROTLI_DEFAULT_MAX_BASE64_REGIONS;
   params->simd_hasher = BROTLI_DEFAULT_SIMD_HASHER;
+  params->dictionary_selection = BROTLI_FALSE;
   params->dist.distance_postfix_bits = 0;
   params->dist.num_direct_distance_codes = 0;
   params->dist.alphabet_size_max =
@@ -736,8 +759,8 @@ void BrotliEncoderOnFinish(const BrotliEncoderState* s);
 #endif
 #endif
 
-static void BrotliEncoderInitState(BrotliEncoderState* s) {
-  BROTLI_ENCODER_ON_START(s);
+/* Initializes everything, except allocated buffers. */
+static void BrotliEncoderInitStreamState(BrotliEncoderState* s) {
   BrotliEncoderInitParams(&s->params);
   s->input_pos_ = 0;
   s->num_commands_ = 0;
@@ -747,15 +770,10 @@ static void BrotliEncoderInitState(BrotliEncoderState* s) {
   s->last_processed_pos_ = 0;
   s->prev_byte_ = 0;
   s->prev_byte2_ = 0;
-  s->storage_size_ = 0;
-  s->storage_ = 0;
-  HasherInit(&s->hasher_);
-  s->large_table_ = NULL;
-  s->large_table_size_ = 0;
-  s->one_pass_arena_ = NULL;
-  s->two_pass_arena_ = NULL;
-  s->command_buf_ = NULL;
-  s->literal_buf_ = NULL;
+  s->dictionary_reference_func_ = NULL;
+  s->dictionary_reference_opaque_ = NULL;
+  s->stage_func_ = NULL;
+  s->stage_opaque_ = NULL;
   s->total_in_ = 0;
   s->next_out_ = NULL;
   s->available_out_ = 0;
@@ -764,11 +782,6 @@ static void BrotliEncoderInitState(BrotliEncoderState* s) {
   s->is_last_block_emitted_ = BROTLI_FALSE;
   s->is_initialized_ = BROTLI_FALSE;
 
-  RingBufferInit(&s->ringbuffer_);
-
-  s->commands_ = 0;
-  s->cmd_alloc_size_ = 0;
-
   /* Initialize distance cache. */
   s->dist_cache_[0] = 4;
   s->dist_cache_[1] = 11;
@@ -780,6 +793,23 @@ static void BrotliEncoderInitState(BrotliEncoderState* s) {
   s->hasher_.common.num_base64_regions = 0;
 }
 
+static void BrotliEncoderInitState(BrotliEncoderState* s) {
+  BROTLI_ENCODER_ON_START(s);
+  s->storage_size_ = 0;
+  s->storage_ = 0;
+  HasherInit(&s->hasher_);
+  s->large_table_ = NULL;
+  s->large_table_size_ = 0;
+  s->one_pass_arena_ = NULL;
+  s->two_pass_arena_ = NULL;
+  s->command_buf_ = NULL;
+  s->literal_buf_ = NULL;
+  RingBufferInit(&s->ringbuffer_);
+  s->commands_ = 0;
+  s->cmd_alloc_size_ = 0;
+  BrotliEncoderInitStreamState(s);
+}
+
 BrotliEncoderState* BrotliEncoderCreateInstance(
     brotli_alloc_func alloc_func, brotli_free_func free_func, void* opaque) {
   BrotliEncoderState* state;
@@ -821,6 +851,20 @@ static void BrotliEncoderCleanupState(BrotliEncoderState* s) {
   BrotliEncoderCleanupParams(m, &s->params);
 }
 
+BROTLI_BOOL BrotliEncoderReset(BrotliEncoderState* state) {
+  MemoryManager* m = &state->memory_manager_;
+  if (BROTLI_IS_OOM(m)) return BROTLI_FALSE;
+  BROTLI_ENCODER_ON_FINISH(state);
+  BROTLI_ENCODER_ON_START(state);
+  BrotliEncoderCleanupParams(m, &state->params);
+  /* Hasher memory, ring buffer, storage, command buffers and hash tables are
+     kept; they are reused or reallocated, if next stream requires more. */
+  state->hasher_.common.is_setup_ = BROTLI_FALSE;
+  RingBufferReset(&state->ringbuffer_);
+  BrotliEncoderInitStreamState(state);
+  return BROTLI_TRUE;
+}
+
 /* Deinitializes and frees BrotliEncoderState instance. */
 void BrotliEncoderDestroyInstance(BrotliEncoderState* state) {
   if (!state) {
@@ -970,6 +1014,73 @@ static void ExtendLastCommand(BrotliEncoderState* s, uint32_t* bytes,
   }
 }
 
+/* Short distance codes: index in distance cache and offset to add. */
+static const uint32_t kDistanceShortCodeIndex[] = {
+  0, 1, 2, 3, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1
+};
+static const int kDistanceShortCodeOffset[] = {
+  0, 0, 0, 0, -1, 1, -2, 2, -3, 3, -1, 1, -2, 2, -3, 3
+};
+
+/* Reports references to compound dictionary made by meta-block commands;
+   |position| is the (unwrapped) position of meta-block start. Distance cache
+   is replayed from its state at meta-block start, the same way as decoder
+   does it: static dictionary references do not update it. */
+static void ReportDictionaryReferences(const BrotliEncoderState* s,
+    uint64_t position, size_t num_commands, const Command* commands) {
+  const size_t compound_dictionary_size =
+      s->params.dictionary.compound.total_size;
+  const uint64_t max_backward_distance =
+      (((uint64_t)1) << s->params.lgwin) - BROTLI_WINDOW_GAP;
+  int dist_cache[4];
+  size_t i;
+  if (!s->dictionary_reference_func_ || compound_dictionary_size == 0) return;
+  memcpy(dist_cache, s->saved_dist_cache_, sizeof(dist_cache));
+  /* Preceding chunks of the stream are a part of the window. */
+  position += s->params.stream_offset;
+  for (i = 0; i < num_commands; ++i) {
+    const Command* cmd = &commands[i];
+    const uint32_t copy_len = CommandCopyLen(cmd);
+    position += cmd->insert_len_;
+    if (copy_len == 0) continue;
+    {
+      uint32_t distance_code =
+          CommandRestoreDistanceCode(cmd, &s->params.dist);
+      int64_t distance;
+      uint64_t max_distance = position < max_backward_distance ?
+          position : max_backward_distance;
+      BROTLI_BOOL is_static_dictionary_word = BROTLI_FALSE;
+      if (distance_code < BROTLI_NUM_DISTANCE_SHORT_CODES) {
+        distance = dist_cache[kDistanceShortCodeIndex[distance_code]];
+        distance += kDistanceShortCodeOffset[distance_code];
+      } else {
+        distance = (int64_t)distance_code -
+            (BROTLI_NUM_DISTANCE_SHORT_CODES - 1);
+      }
+      if (distance > 0 && (uint64_t)distance > max_distance) {
+        uint64_t dictionary_distance = (uint64_t)distance - max_distance;
+        if (dictionary_distance - 1 < compound_dictionary_size) {
+          size_t offset =
+              compound_dictionary_size - (size_t)dictionary_distance;
+          size_t length = BROTLI_MIN(size_t, copy_len,
+              compound_dictionary_size - offset);
+          s->dictionary_reference_func_(
+              s->dictionary_reference_opaque_, offset, length);
+        } else {
+          is_static_dictionary_word = BROTLI_TRUE;
+        }
+      }
+      if (distance_code != 0 && !is_static_dictionary_word) {
+        dist_cache[3] = dist_cache[2];
+        dist_cache[2] = dist_cache[1];
+        dist_cache[1] = dist_cache[0];
+        dist_cache[0] = (int)distance;
+      }
+    }
+    position += copy_len;
+  }
+}
+
 /*
    Processes the accumulated input data and sets |*out_size| to the length of
    the new output meta-block, or to zero if no new output meta-block has been
@@ -997,6 +1108,8 @@ static BROTLI_BOOL EncodeData(
       s->params.quality == FAST_ONE_PASS_COMPRESSION_QUALITY ||
       s->params.quality == FAST_TWO_PASS_COMPRESSION_QUALITY;
 
+  /* Allocation of command buffers and hash tables is a part of matching. */
+  ReportStage(s->stage_func_, s->stage_opaque_, BROTLI_ENCODER_STAGE_MATCHING);
   data = s->ringbuffer_.buffer_;
   mask = s->ringbuffer_.mask_;
 
@@ -1100,6 +1213,12 @@ static BROTLI_BOOL EncodeData(
     }
   }
 
+  if (s->params.dictionary_selection && s->last_processed_pos_ == 0 &&
+      s->params.dictionary.compound.num_chunks != 0) {
+    SelectCompoundDictionaryChunk(&s->params.dictionary.compound, data, mask,
+        wrapped_last_processed_pos, bytes);
+  }
+
   InitOrStitchToPreviousBlock(m, &s->hasher_, data, mask, &s->params,
       wrapped_last_processed_pos, bytes, is_last);
 
@@ -1189,12 +1308,14 @@ static BROTLI_BOOL EncodeData(
     if (BROTLI_IS_OOM(m)) return BROTLI_FALSE;
     storage[0] = (uint8_t)s->last_bytes_;
     storage[1] = (uint8_t)(s->last_bytes_ >> 8);
+    ReportDictionaryReferences(
+        s, s->last_flush_pos_, s->num_commands_, s->commands_);
     WriteMetaBlockInternal(
         m, data, mask, s->last_flush_pos_, metablock_size, is_last,
         s->hasher_.common.base64_regions, s->hasher_.common.num_base64_regions,
         literal_context_mode, &s->params, s->prev_byte_, s->prev_byte2_,
         s->num_literals_, s->num_commands_, s->commands_, s->saved_dist_cache_,
-        s->dist_cache_, &storage_ix, storage);
+        s->dist_cache_, &storage_ix, storage, s->stage_func_, s->stage_opaque_);
     if (BROTLI_IS_OOM(m)) return BROTLI_FALSE;
     s->hasher_.common.num_base64_regions = 0;
     s->last_bytes_ = (uint16_t)(storage[storage_ix >> 3]);
@@ -1491,6 +1612,8 @@ static BROTLI_BOOL BrotliEncoderCompressStreamFast(
         s->stream_state_ = BROTLI_STREAM_FLUSH_REQUESTED;
         continue;
       }
+      ReportStage(s->stage_func_, s->stage_opaque_,
+                  BROTLI_ENCODER_STAGE_MATCHING);
       if (max_out_size <= *available_out) {
         storage = *next_out;
       } else {
@@ -1513,6 +1636,7 @@ static BROTLI_BOOL BrotliEncoderCompressStreamFast(
             &storage_ix, storage);
         if (BROTLI_IS_OOM(m)) return BROTLI_FALSE;
       }
+      ReportStage(s->stage_func_, s->stage_opaque_, BROTLI_ENCODER_STAGE_IDLE);
       if (block_size != 0) {
         *next_in += block_size;
         *available_in -= block_size;
@@ -1569,6 +1693,7 @@ static BROTLI_BOOL ProcessMetadata(
     if (s->input_pos_ != s->last_flush_pos_) {
       BROTLI_BOOL result = EncodeData(s, BROTLI_FALSE, BROTLI_TRUE,
           &s->available_out_, &s->next_out_);
+      ReportStage(s->stage_func_, s->stage_opaque_, BROTLI_ENCODER_STAGE_IDLE);
       if (!result) return BROTLI_FALSE;
       continue;
     }
@@ -1616,13 +1741,18 @@ static BROTLI_BOOL ProcessMetadata(
   return BROTLI_TRUE;
 }
 
-static void UpdateSizeHint(BrotliEncoderState* s, size_t available_in) {
+/* Large window is requested for large inputs; if the stream does not end
+   with the first block, its size is unknown, and it is assumed to be large,
+   so that the long-distance hasher is used (see ChooseHasher). */
+static void UpdateSizeHint(BrotliEncoderState* s, size_t available_in,
+                           BROTLI_BOOL is_last) {
   if (s->params.size_hint == 0) {
     uint64_t delta = UnprocessedInputSize(s);
     uint64_t tail = available_in;
     uint32_t limit = 1u << 30;
     uint32_t total;
-    if ((delta >= limit) || (tail >= limit) || ((delta + tail) >= limit)) {
+    if ((delta >= limit) || (tail >= limit) || ((delta + tail) >= limit) ||
+        (!is_last && s->params.lgwin > BROTLI_MAX_WINDOW_BITS)) {
       total = limit;
     } else {
       total = (uint32_t)(delta + tail);
@@ -1644,7 +1774,8 @@ BROTLI_BOOL BrotliEncoderCompressStream(
   }
 
   if (op == BROTLI_OPERATION_EMIT_METADATA) {
-    UpdateSizeHint(s, 0);  /* First data metablock might be emitted here. */
+    /* First data metablock might be emitted here. */
+    UpdateSizeHint(s, 0, BROTLI_FALSE);
     return ProcessMetadata(
         s, available_in, next_in, available_out, next_out, total_out);
   }
@@ -1706,9 +1837,11 @@ BROTLI_BOOL BrotliEncoderCompressStream(
           s->flint_ = BROTLI_FLINT_WAITING_FOR_FLUSHING;
           force_flush = BROTLI_TRUE;
         }
-        UpdateSizeHint(s, *available_in);
+        UpdateSizeHint(s, *available_in, is_last);
         result = EncodeData(s, is_last, force_flush,
             &s->available_out_, &s->next_out_);
+        ReportStage(s->stage_func_, s->stage_opaque_,
+                    BROTLI_ENCODER_STAGE_IDLE);
         if (!result) return BROTLI_FALSE;
         if (force_flush) s->stream_state_ = BROTLI_STREAM_FLUSH_REQUESTED;
         if (is_last) s->stream_state_ = BROTLI_STREAM_FINISHED;
@@ -1753,9 +1886,9 @@ uint32_t BrotliEncoderVersion(void) {
   return BROTLI_VERSION;
 }
 
-BrotliEncoderPreparedDictionary* BrotliEncoderPrepareDictionary(
-    BrotliSharedDictionaryType type, size_t size,
-    const uint8_t data[BROTLI_ARRAY_PARAM(size)], int quality,
+static BrotliEncoderPreparedDictionary* PrepareDictionary(
+    BrotliSharedDictionaryType type, size_t size, const uint8_t* data,
+    size_t cache_size, const uint8_t* cache, int quality,
     brotli_alloc_func alloc_func, brotli_free_func free_func, void* opaque) {
   ManagedDictionary* managed_dictionary = NULL;
   BROTLI_BOOL type_is_known = BROTLI_FALSE;
@@ -1781,15 +1914,23 @@ BrotliEncoderPreparedDictionary* BrotliEncoderPrepareDictionary(
         &managed_dictionary->memory_manager_, sizeof(SharedEncoderDictionary));
     managed_dictionary->dictionary = (uint32_t*)dict;
     if (dict != NULL) {
-      BROTLI_BOOL ok = BrotliInitCustomSharedEncoderDictionary(
-          &managed_dictionary->memory_manager_, data, size, quality, dict);
+      BROTLI_BOOL ok = (cache != NULL) ?
+          BrotliInitCustomSharedEncoderDictionaryFromCache(
+              &managed_dictionary->memory_manager_, data, size,
+              cache, cache_size, quality, dict) :
+          BrotliInitCustomSharedEncoderDictionary(
+              &managed_dictionary->memory_manager_, data, size, quality, dict);
       if (!ok) {
+        BrotliCleanupSharedEncoderDictionary(
+            &managed_dictionary->memory_manager_, dict);
         BrotliFree(&managed_dictionary->memory_manager_, dict);
         managed_dictionary->dictionary = NULL;
       }
     }
   }
 #else  /* BROTLI_EXPERIMENTAL */
+  (void)cache_size;
+  (void)cache;
   (void)quality;
 #endif  /* BROTLI_EXPERIMENTAL */
   if (managed_dictionary->dictionary == NULL) {
@@ -1799,6 +1940,28 @@ BrotliEncoderPreparedDictionary* BrotliEncoderPrepareDictionary(
   return (BrotliEncoderPreparedDictionary*)managed_dictionary;
 }
 
+BrotliEncoderPreparedDictionary* BrotliEncoderPrepareDictionary(
+    BrotliSharedDictionaryType type, size_t size,
+    const uint8_t data[BROTLI_ARRAY_PARAM(size)], int quality,
+    brotli_alloc_func alloc_func, brotli_free_func free_func, void* opaque) {
+  return PrepareDictionary(type, size, data, 0, NULL, quality,
+      alloc_func, free_func, opaque);
+}
+
+BrotliEncoderPreparedDictionary* BrotliEncoderPrepareDictionaryWithCache(
+    BrotliSharedDictionaryType type, size_t size,
+    const uint8_t data[BROTLI_ARRAY_PARAM(size)], size_t cache_size,
+    const uint8_t cache[BROTLI_ARRAY_PARAM(cache_size)], int quality,
+    brotli_alloc_func alloc_func, brotli_free_func free_func, void* opaque) {
+  /* Raw dictionaries are loaded in place with
+     BrotliEncoderLoadPreparedDictionaryFromMemory instead. */
+  if (type != BROTLI_SHARED_DICTIONARY_SERIALIZED || cache == NULL) {
+    return NULL;
+  }
+  return PrepareDictionary(type, size, data, cache_size, cache, quality,
+      alloc_func, free_func, opaque);
+}
+
 void BROTLI_COLD BrotliEncoderDestroyPreparedDictionary(
     BrotliEncoderPreparedDictionary* dictionary) {
   ManagedDictionary* dict = (ManagedDictionary*)dictionary;
@@ -1810,7 +1973,8 @@ void BROTLI_COLD BrotliEncoderDestroyPreparedDictionary(
   }
   if (dict->dictionary == NULL) {
     /* This should never ever happen. */
-  } else if (*dict->dictionary == kLeanPreparedDictionaryMagic) {
+  } else if (*dict->dictionary == kLeanPreparedDictionaryMagic ||
+      *dict->dictionary == kLeanBucketedPreparedDictionaryMagic) {
     DestroyPreparedDictionary(
         &dict->memory_manager_, (PreparedDictionary*)dict->dictionary);
   } else if (*dict->dictionary == kSharedDictionaryMagic) {
@@ -1818,8 +1982,8 @@ void BROTLI_COLD BrotliEncoderDestroyPreparedDictionary(
         (SharedEncoderDictionary*)dict->dictionary);
     BrotliFree(&dict->memory_manager_, dict->dictionary);
   } else {
-    /* There is also kPreparedDictionaryMagic, but such instances should be
-     * constructed and destroyed by different means. */
+    /* There are also "fat" prepared dictionaries, but such instances should
+     * be constructed and destroyed by different means. */
   }
   dict->dictionary = NULL;
   BrotliDestroyManagedDictionary(dict);
@@ -1839,8 +2003,7 @@ BROTLI_BOOL BROTLI_COLD BrotliEncoderAttachPreparedDictionary(
     dict = (BrotliEncoderPreparedDictionary*)managed_dictionary->dictionary;
   }
   current = &state->params.dictionary;
-  if (magic == kPreparedDictionaryMagic ||
-      magic == kLeanPreparedDictionaryMagic) {
+  if (IsPreparedDictionaryMagic(magic)) {
     const PreparedDictionary* prepared = (const PreparedDictionary*)dict;
     if (!AttachPreparedDictionary(&current->compound, prepared)) {
       return BROTLI_FALSE;
@@ -1883,6 +2046,70 @@ BROTLI_BOOL BROTLI_COLD BrotliEncoderAttachPreparedDictionary(
   return BROTLI_TRUE;
 }
 
+BROTLI_BOOL BROTLI_COLD BrotliEncoderSerializePreparedDictionary(
+    const BrotliEncoderPreparedDictionary* dictionary, size_t* buffer_size,
+    uint8_t* buffer) {
+  /* First field of dictionary structs */
+  const BrotliEncoderPreparedDictionary* dict = dictionary;
+  uint32_t magic = *((const uint32_t*)dict);
+  const PreparedDictionary* prepared;
+  size_t size;
+  if (magic == kManagedDictionaryMagic) {
+    /* Unwrap managed dictionary. */
+    const ManagedDictionary* managed_dictionary =
+        (const ManagedDictionary*)dict;
+    magic = *managed_dictionary->dictionary;
+    dict = (BrotliEncoderPreparedDictionary*)managed_dictionary->dictionary;
+  }
+#if defined(BROTLI_EXPERIMENTAL)
+  if (magic == kSharedDictionaryMagic) {
+    const SharedEncoderDictionary* shared =
+        (const SharedEncoderDictionary*)dict;
+    size = BrotliGetSharedEncoderDictionaryCacheSize(shared);
+    if (*buffer_size < size) {
+      *buffer_size = size;
+      return BROTLI_FALSE;
+    }
+    BrotliSerializeSharedEncoderDictionaryCache(shared, buffer);
+    *buffer_size = size;
+    return BROTLI_TRUE;
+  }
+#endif  /* BROTLI_EXPERIMENTAL */
+  if (!IsPreparedDictionaryMagic(magic)) {
+    *buffer_size = 0;
+    return BROTLI_FALSE;
+  }
+  prepared = (const PreparedDictionary*)dict;
+  size = GetPreparedDictionarySerializedSize(prepared);
+  if (*buffer_size < size) {
+    *buffer_size = size;
+    return BROTLI_FALSE;
+  }
+  SerializePreparedDictionary(prepared, buffer);
+  *buffer_size = size;
+  return BROTLI_TRUE;
+}
+
+const BrotliEncoderPreparedDictionary* BROTLI_COLD
+BrotliEncoderLoadPreparedDictionaryFromMemory(size_t data_size,
+    const uint8_t data[BROTLI_ARRAY_PARAM(data_size)]) {
+  if (!IsValidSerializedPreparedDictionary(data, data_size)) return NULL;
+  return (const BrotliEncoderPreparedDictionary*)data;
+}
+
+void BROTLI_COLD BrotliEncoderSetDictionaryReferenceCallback(
+    BrotliEncoderState* state, brotli_encoder_dictionary_reference_func func,
+    void* opaque) {
+  state->dictionary_reference_func_ = func;
+  state->dictionary_reference_opaque_ = opaque;
+}
+
+void BROTLI_COLD BrotliEncoderSetStageCallback(
+    BrotliEncoderState* state, brotli_encoder_stage_func func, void* opaque) {
+  state->stage_func_ = func;
+  state->stage_opaque_ = opaque;
+}
+
 size_t BROTLI_COLD BrotliEncoderEstimatePeakMemoryUsage(int quality, int lgwin,
                                                         size_t input_size) {
   BrotliEncoderParams params;
@@ -1964,22 +2191,9 @@ size_t BROTLI_COLD BrotliEncoderGetPreparedDictionarySize(
     prepared = (const BrotliEncoderPreparedDictionary*)managed->dictionary;
   }
 
-  if (magic == kPreparedDictionaryMagic) {
-    const PreparedDictionary* dictionary =
-        (const PreparedDictionary*)prepared;
-    /* Keep in sync with step 3 of CreatePreparedDictionary */
-    return sizeof(PreparedDictionary) + dictionary->source_size +
-        (sizeof(uint32_t) << dictionary->slot_bits) +
-        (sizeof(uint16_t) << dictionary->bucket_bits) +
-        (sizeof(uint32_t) * dictionary->num_items) + overhead;
-  } else if (magic == kLeanPreparedDictionaryMagic) {
-    const PreparedDictionary* dictionary =
-        (const PreparedDictionary*)prepared;
-    /* Keep in sync with step 3 of CreatePreparedDictionary */
-    return sizeof(PreparedDictionary) + sizeof(uint8_t*) +
-        (sizeof(uint32_t) << dictionary->slot_bits) +
-        (sizeof(uint16_t) << dictionary->bucket_bits) +
-        (sizeof(uint32_t) * dictionary->num_items) + overhead;
+  if (IsPreparedDictionaryMagic(magic)) {
+    return GetPreparedDictionaryMemoryUsage(
+        (const PreparedDictionary*)prepared) + overhead;
   } else if (magic == kSharedDictionaryMagic) {
     const SharedEncoderDictionary* dictionary =
         (const SharedEncoderDictionary*)prepared;
@@ -40,6 +40,8 @@ static void BrotliTrieInit(BrotliTrie* trie) {
 }
 
 static void BrotliTrieFree(MemoryManager* m, BrotliTrie* trie) {
+  /* Pool loaded from cache is borrowed; it has no capacity of its own. */
+  if (trie->pool_capacity == 0) return;
   BrotliFree(m, trie->pool);
 }
 
@@ -52,6 +54,7 @@ static void InitEncoderDictionary(BrotliEncoderDictionary* dict) {
   dict->hash_table_lengths = kStaticDictionaryHashLengths;
   dict->buckets = kStaticDictionaryBuckets;
   dict->dict_words = kStaticDictionaryWords;
+  dict->prefix_filter = kStaticDictionaryFilter;
 
   dict->cutoffTransformsCount = kCutoffTransformsCount;
   dict->cutoffTransforms = kCutoffTransforms;
@@ -336,6 +339,7 @@ static BROTLI_BOOL BuildDictionaryLut(MemoryManager* m,
   dict->dict_words = dict->dict_words_data_ = dict_words;
   dict->buckets_alloc_size_ = NUM_HASH_BUCKETS;
   dict->buckets = dict->buckets_data_ = buckets;
+  dict->prefix_filter = NULL;
 
   /* Unused; makes offsets start from 1. */
   dict_words[0] = MakeDictWord(0, 0, 0);
@@ -484,6 +488,386 @@ static BROTLI_BOOL ComputeDictionary(MemoryManager* m, int quality,
 
   return BROTLI_TRUE;
 }
+
+/* Cache of lookup structures derived from serialized shared dictionary.
+   Layout (all fields are native uint32_t unless noted otherwise):
+     header: magic, source hash (low, high), source size, quality,
+             number of prefixes, number of word dictionaries, reserved;
+     for each prefix: size, "fat" PreparedDictionary padded to 4 bytes;
+     for each word dictionary: flags, number of DictWord-s, trie pool size,
+             reserved, then (if present) hash table words, hash table
+             lengths, LUT buckets, LUT words, trie root and trie pool. */
+static const uint32_t kSharedDictionaryCacheMagic = 0xDEBCEDE4;
+#define CACHE_HEADER_SIZE 8
+#define CACHE_INSTANCE_HEADER_SIZE 4
+#define CACHE_HAS_HASH_TABLE 1u
+#define CACHE_HAS_LUT 2u
+#define CACHE_HAS_WORDS_HEAVY 4u
+
+static size_t CachePad(size_t size) {
+  return (size + 3) & ~(size_t)3;
+}
+
+/* FNV-1a; serves only to tell one serialized dictionary from another. */
+static uint64_t HashEncodedDictionary(const uint8_t* data, size_t size) {
+  uint64_t h = BROTLI_MAKE_UINT64_T(0xCBF29CE4u, 0x84222325u);
+  const uint64_t mul = BROTLI_MAKE_UINT64_T(0x00000100u, 0x000001B3u);
+  size_t i;
+  for (i = 0; i < size; ++i) {
+    h = (h ^ data[i]) * mul;
+  }
+  return h;
+}
+
+static size_t GetNumCacheInstances(const ContextualEncoderDictionary* dict) {
+  return dict->num_instances_;
+}
+
+static const BrotliEncoderDictionary* GetCacheInstance(
+    const ContextualEncoderDictionary* dict, size_t i) {
+  return (dict->num_instances_ == 1) ? &dict->instance_ : &dict->instances_[i];
+}
+
+/* Looks at the lookup structures in use rather than at the owned buffers:
+   dictionary loaded from cache borrows them. */
+static uint32_t CacheInstanceFlags(const BrotliEncoderDictionary* dict) {
+  uint32_t flags = 0;
+  if (dict->hash_table_words != kStaticDictionaryHashWords) {
+    flags |= CACHE_HAS_HASH_TABLE;
+  }
+  if (dict->dict_words != kStaticDictionaryWords) flags |= CACHE_HAS_LUT;
+  if (dict->has_words_heavy) flags |= CACHE_HAS_WORDS_HEAVY;
+  return flags;
+}
+
+static size_t CacheInstanceSize(uint32_t flags, size_t num_dict_words,
+                                size_t pool_size) {
+  size_t result = CACHE_INSTANCE_HEADER_SIZE * sizeof(uint32_t);
+  if (flags & CACHE_HAS_HASH_TABLE) {
+    result += sizeof(kStaticDictionaryHashWords) +
+        sizeof(kStaticDictionaryHashLengths);
+  }
+  if (flags & CACHE_HAS_LUT) {
+    result += sizeof(uint16_t) * NUM_HASH_BUCKETS +
+        CachePad(sizeof(DictWord) * num_dict_words);
+  }
+  if (flags & CACHE_HAS_WORDS_HEAVY) {
+    result += sizeof(BrotliTrieNode) * (pool_size + 1);
+  }
+  return result;
+}
+
+size_t BrotliGetSharedEncoderDictionaryCacheSize(
+    const SharedEncoderDictionary* dict) {
+  size_t result = CACHE_HEADER_SIZE * sizeof(uint32_t);
+  size_t i;
+  for (i = 0; i < dict->compound.num_chunks; ++i) {
+    result += sizeof(uint32_t) + CachePad(
+        GetPreparedDictionarySerializedSize(dict->compound.chunks[i]));
+  }
+  for (i = 0; i < GetNumCacheInstances(&dict->contextual); ++i) {
+    const BrotliEncoderDictionary* current =
+        GetCacheInstance(&dict->contextual, i);
+    result += CacheInstanceSize(CacheInstanceFlags(current),
+        current->dict_words_alloc_size_, current->trie.pool_size);
+  }
+  return result;
+}
+
+void BrotliSerializeSharedEncoderDictionaryCache(
+    const SharedEncoderDictionary* dict, uint8_t* out) {
+  uint32_t* header = (uint32_t*)out;
+  size_t i;
+  header[0] = kSharedDictionaryCacheMagic;
+  header[1] = (uint32_t)dict->source_hash_;
+  header[2] = (uint32_t)(dict->source_hash_ >> 32);
+  header[3] = (uint32_t)dict->source_size_;
+  header[4] = (uint32_t)dict->max_quality;
+  header[5] = (uint32_t)dict->compound.num_chunks;
+  header[6] = (uint32_t)GetNumCacheInstances(&dict->contextual);
+  header[7] = 0;
+  out += CACHE_HEADER_SIZE * sizeof(uint32_t);
+  for (i = 0; i < dict->compound.num_chunks; ++i) {
+    const PreparedDictionary* chunk = dict->compound.chunks[i];
+    size_t chunk_size = GetPreparedDictionarySerializedSize(chunk);
+    *(uint32_t*)out = (uint32_t)chunk_size;
+    out += sizeof(uint32_t);
+    SerializePreparedDictionary(chunk, out);
+    memset(out + chunk_size, 0, CachePad(chunk_size) - chunk_size);
+    out += CachePad(chunk_size);
+  }
+  for (i = 0; i < GetNumCacheInstances(&dict->contextual); ++i) {
+    const BrotliEncoderDictionary* current =
+        GetCacheInstance(&dict->contextual, i);
+    uint32_t flags = CacheInstanceFlags(current);
+    header = (uint32_t*)out;
+    header[0] = flags;
+    header[1] = (uint32_t)current->dict_words_alloc_size_;
+    header[2] = (uint32_t)current->trie.pool_size;
+    header[3] = 0;
+    out += CACHE_INSTANCE_HEADER_SIZE * sizeof(uint32_t);
+    if (flags & CACHE_HAS_HASH_TABLE) {
+      memcpy(out, current->hash_table_words,
+          sizeof(kStaticDictionaryHashWords));
+      out += sizeof(kStaticDictionaryHashWords);
+      memcpy(out, current->hash_table_lengths,
+          sizeof(kStaticDictionaryHashLengths));
+      out += sizeof(kStaticDictionaryHashLengths);
+    }
+    if (flags & CACHE_HAS_LUT) {
+      size_t words_size = sizeof(DictWord) * current->dict_words_alloc_size_;
+      memcpy(out, current->buckets, sizeof(uint16_t) * NUM_HASH_BUCKETS);
+      out += sizeof(uint16_t) * NUM_HASH_BUCKETS;
+      memcpy(out, current->dict_words, words_size);
+      memset(out + words_size, 0, CachePad(words_size) - words_size);
+      out += CachePad(words_size);
+    }
+    if (flags & CACHE_HAS_WORDS_HEAVY) {
+      /* The pool is not touched until the first node is added. */
+      memcpy(out, &current->trie.root, sizeof(BrotliTrieNode));
+      out += sizeof(BrotliTrieNode);
+      if (current->trie.pool_size != 0) {
+        /* Node 0 is a never initialized placeholder. */
+        memset(out, 0, sizeof(BrotliTrieNode));
+        memcpy(out + sizeof(BrotliTrieNode), current->trie.pool + 1,
+            sizeof(BrotliTrieNode) * (current->trie.pool_size - 1));
+      }
+      out += sizeof(BrotliTrieNode) * current->trie.pool_size;
+    }
+  }
+}
+
+/* Reads the cache in order; all getters return NULL once it is exhausted. */
+typedef struct CacheReader {
+  const uint8_t* next;
+  size_t available;
+} CacheReader;
+
+static const uint8_t* CacheRead(CacheReader* reader, size_t size) {
+  const uint8_t* result = reader->next;
+  if (!result || reader->available < size) {
+    reader->next = NULL;
+    return NULL;
+  }
+  reader->next += size;
+  reader->available -= size;
+  return result;
+}
+
+static BROTLI_BOOL IsValidCachedWord(const BrotliDictionary* words,
+                                     size_t len, size_t idx) {
+  if (len < SHARED_BROTLI_MIN_DICTIONARY_WORD_LENGTH ||
+      len > SHARED_BROTLI_MAX_DICTIONARY_WORD_LENGTH) {
+    return BROTLI_FALSE;
+  }
+  if (!words->size_bits_by_length[len]) return BROTLI_FALSE;
+  return TO_BROTLI_BOOL(idx < ((size_t)1 << words->size_bits_by_length[len]));
+}
+
+static BROTLI_BOOL IsValidCachedHashTable(const uint16_t* hash_table_words,
+    const uint8_t* hash_table_lengths, const BrotliDictionary* words) {
+  size_t i;
+  for (i = 0; i < NUM_HASH_BUCKETS; ++i) {
+    if (hash_table_lengths[i] == 0) continue;
+    if (!IsValidCachedWord(words, hash_table_lengths[i],
+        hash_table_words[i])) {
+      return BROTLI_FALSE;
+    }
+  }
+  return BROTLI_TRUE;
+}
+
+static BROTLI_BOOL IsValidCachedLut(const uint16_t* buckets,
+    const DictWord* dict_words, size_t num_dict_words,
+    const BrotliDictionary* words) {
+  size_t i;
+  if (num_dict_words == 0) return BROTLI_FALSE;
+  for (i = 0; i < NUM_HASH_BUCKETS; ++i) {
+    if (buckets[i] >= num_dict_words) return BROTLI_FALSE;
+  }
+  /* Bucket scan stops only at the end-of-bucket marker. */
+  if (num_dict_words > 1 && !(dict_words[num_dict_words - 1].len & 0x80)) {
+    return BROTLI_FALSE;
+  }
+  for (i = 1; i < num_dict_words; ++i) {
+    DictWord w = dict_words[i];
+    if (w.transform != 0 && w.transform != BROTLI_TRANSFORM_UPPERCASE_FIRST &&
+        w.transform != BROTLI_TRANSFORM_UPPERCASE_ALL) {
+      return BROTLI_FALSE;
+    }
+    if (!IsValidCachedWord(words, w.len & 0x1F, w.idx)) return BROTLI_FALSE;
+  }
+  return BROTLI_TRUE;
+}
+
+static BROTLI_BOOL IsValidCachedTrieNode(const BrotliTrieNode* node,
+                                         size_t pool_size) {
+  size_t span = node->single ? 1 : 16;
+  if (node->len_ > SHARED_BROTLI_MAX_DICTIONARY_WORD_LENGTH) {
+    return BROTLI_FALSE;
+  }
+  if (node->sub == 0) return BROTLI_TRUE;
+  return TO_BROTLI_BOOL(node->sub <= pool_size &&
+                        span <= pool_size - node->sub);
+}
+
+/* State of cached trie walk. */
+typedef struct CachedTrieCheck {
+  const BrotliTrieNode* pool;
+  size_t pool_size;
+  /* Nodes left to visit; shared nodes and cycles exhaust it. */
+  size_t budget;
+  const BrotliTransforms* transforms;
+  const BrotliEncoderDictionary* dict;
+  uint8_t path[kTransformedBufferSize];
+} CachedTrieCheck;
+
+/* Node payload is emitted as a reference to the transformed word with the
+   length of the path; that word should be spelled by the path. */
+static BROTLI_BOOL IsValidCachedTrieWord(const CachedTrieCheck* check,
+    const BrotliTrieNode* node, size_t depth) {
+  uint8_t word[kTransformedBufferSize];
+  size_t size;
+  uint32_t size_bits;
+  if (node->len_ == 0) return BROTLI_TRUE;
+  if (node->len_ < SHARED_BROTLI_MIN_DICTIONARY_WORD_LENGTH) {
+    return BROTLI_FALSE;
+  }
+  size_bits = check->dict->words->size_bits_by_length[node->len_];
+  if (size_bits == 0) return BROTLI_FALSE;
+  if ((node->idx_ >> size_bits) >= check->transforms->num_transforms) {
+    return BROTLI_FALSE;
+  }
+  TransformedDictionaryWord(node->idx_ & ((1u << size_bits) - 1),
+      node->len_, (int)(node->idx_ >> size_bits), check->transforms,
+      check->dict, word, &size);
+  return TO_BROTLI_BOOL(size == depth &&
+                        memcmp(word, check->path, depth) == 0);
+}
+
+static BROTLI_BOOL IsValidCachedTrie(CachedTrieCheck* check,
+    const BrotliTrieNode* node, size_t depth) {
+  size_t i;
+  size_t j;
+  if (!IsValidCachedTrieWord(check, node, depth)) return BROTLI_FALSE;
+  if (node->sub == 0) return BROTLI_TRUE;
+  if (depth == kTransformedBufferSize) return BROTLI_FALSE;
+  if (node->single) {
+    if (check->budget == 0) return BROTLI_FALSE;
+    check->budget--;
+    check->path[depth] = node->c;
+    return IsValidCachedTrie(check, &check->pool[node->sub], depth + 1);
+  }
+  /* Sub nodes are 16 groups of 16 nodes; group is chosen by high nibble. */
+  for (i = 0; i < 16; ++i) {
+    const BrotliTrieNode* group = &check->pool[node->sub + i];
+    if (group->sub == 0) continue;
+    if (16 > check->pool_size - group->sub || check->budget < 16) {
+      return BROTLI_FALSE;
+    }
+    check->budget -= 16;
+    for (j = 0; j < 16; ++j) {
+      check->path[depth] = (uint8_t)((i << 4) | j);
+      if (!IsValidCachedTrie(check, &check->pool[group->sub + j],
+          depth + 1)) {
+        return BROTLI_FALSE;
+      }
+    }
+  }
+  return BROTLI_TRUE;
+}
+
+static BROTLI_BOOL LoadDictionaryFromCache(CacheReader* reader, int quality,
+    const BrotliTransforms* transforms, BrotliEncoderDictionary* current) {
+  const uint32_t* header = (const uint32_t*)CacheRead(
+      reader, CACHE_INSTANCE_HEADER_SIZE * sizeof(uint32_t));
+  int default_words = current->words == BrotliGetDictionary();
+  int default_transforms = transforms == BrotliGetTransforms();
+  uint32_t expected_flags = 0;
+  uint32_t flags;
+  size_t num_dict_words;
+  size_t pool_size;
+  if (!header) return BROTLI_FALSE;
+  flags = header[0];
+  num_dict_words = header[1];
+  pool_size = header[2];
+  /* Keeps the size computations below from overflowing. */
+  if (num_dict_words > (1u << 24) || pool_size > (1u << 26)) {
+    return BROTLI_FALSE;
+  }
+  if (!default_words || !default_transforms) {
+    expected_flags |= CACHE_HAS_HASH_TABLE;
+    if (quality >= ZOPFLIFICATION_QUALITY) {
+      expected_flags |= CACHE_HAS_LUT;
+      if (!default_transforms) expected_flags |= CACHE_HAS_WORDS_HEAVY;
+    }
+  }
+  /* Cache could be computed for higher quality than required. */
+  if ((flags & expected_flags) != expected_flags) return BROTLI_FALSE;
+  if (flags & ~(expected_flags | CACHE_HAS_LUT | CACHE_HAS_WORDS_HEAVY)) {
+    return BROTLI_FALSE;
+  }
+  if (flags & CACHE_HAS_HASH_TABLE) {
+    const uint16_t* hash_table_words = (const uint16_t*)CacheRead(
+        reader, sizeof(kStaticDictionaryHashWords));
+    const uint8_t* hash_table_lengths = CacheRead(
+        reader, sizeof(kStaticDictionaryHashLengths));
+    if (!hash_table_lengths) return BROTLI_FALSE;
+    if (!IsValidCachedHashTable(
+        hash_table_words, hash_table_lengths, current->words)) {
+      return BROTLI_FALSE;
+    }
+    current->hash_table_words = hash_table_words;
+    current->hash_table_lengths = hash_table_lengths;
+    ComputeCutoffTransforms(transforms,
+        &current->cutoffTransformsCount, &current->cutoffTransforms);
+  }
+  if (flags & CACHE_HAS_LUT) {
+    const uint16_t* buckets = (const uint16_t*)CacheRead(
+        reader, sizeof(uint16_t) * NUM_HASH_BUCKETS);
+    const DictWord* dict_words = (const DictWord*)CacheRead(
+        reader, CachePad(sizeof(DictWord) * num_dict_words));
+    if (!dict_words) return BROTLI_FALSE;
+    if (expected_flags & CACHE_HAS_LUT) {
+      if (!IsValidCachedLut(buckets, dict_words, num_dict_words,
+          current->words)) {
+        return BROTLI_FALSE;
+      }
+      current->buckets = buckets;
+      current->dict_words = dict_words;
+      current->dict_words_alloc_size_ = num_dict_words;
+      current->prefix_filter = NULL;
+    }
+  }
+  if (flags & CACHE_HAS_WORDS_HEAVY) {
+    const BrotliTrieNode* nodes;
+    size_t i;
+    nodes = (const BrotliTrieNode*)CacheRead(
+        reader, sizeof(BrotliTrieNode) * (pool_size + 1));
+    if (!nodes) return BROTLI_FALSE;
+    if (expected_flags & CACHE_HAS_WORDS_HEAVY) {
+      CachedTrieCheck check;
+      for (i = 0; i <= pool_size; ++i) {
+        if (!IsValidCachedTrieNode(&nodes[i], pool_size)) return BROTLI_FALSE;
+      }
+      /* Words are checked as well; encoder emits them without a check. */
+      check.pool = &nodes[1];
+      check.pool_size = pool_size;
+      check.budget = pool_size;
+      check.transforms = transforms;
+      check.dict = current;
+      if (!IsValidCachedTrie(&check, &nodes[0], 0)) return BROTLI_FALSE;
+      current->trie.root = nodes[0];
+      /* Trie is never modified after construction; pool_capacity == 0 marks
+         the pool as borrowed. */
+      current->trie.pool = (BrotliTrieNode*)&nodes[1];
+      current->trie.pool_size = pool_size;
+      current->trie.pool_capacity = 0;
+      current->has_words_heavy = BROTLI_TRUE;
+    }
+  }
+  return BROTLI_TRUE;
+}
 #endif  /* BROTLI_EXPERIMENTAL */
 
 void BrotliInitSharedEncoderDictionary(SharedEncoderDictionary* dict) {
@@ -492,6 +876,7 @@ void BrotliInitSharedEncoderDictionary(SharedEncoderDictionary* dict) {
   dict->compound.num_chunks = 0;
   dict->compound.total_size = 0;
   dict->compound.chunk_offsets[0] = 0;
+  dict->compound.search_mask = ~0u;
   dict->compound.num_prepared_instances_ = 0;
 
   dict->contextual.context_based = 0;
@@ -503,6 +888,8 @@ void BrotliInitSharedEncoderDictionary(SharedEncoderDictionary* dict) {
   dict->contextual.instance_.parent = &dict->contextual;
 
   dict->max_quality = BROTLI_MAX_QUALITY;
+  dict->source_hash_ = 0;
+  dict->source_size_ = 0;
 }
 
 #if defined(BROTLI_EXPERIMENTAL)
@@ -510,23 +897,38 @@ void BrotliInitSharedEncoderDictionary(SharedEncoderDictionary* dict) {
    transforms are available (for low-quality encoder). */
 static BROTLI_BOOL InitCustomSharedEncoderDictionary(
     MemoryManager* m, const BrotliSharedDictionary* decoded_dict,
-    int quality, SharedEncoderDictionary* dict) {
+    CacheReader* cache, int quality, SharedEncoderDictionary* dict) {
   ContextualEncoderDictionary* contextual;
   CompoundDictionary* compound;
   BrotliEncoderDictionary* instances;
   int i;
-  BrotliInitSharedEncoderDictionary(dict);
 
   contextual = &dict->contextual;
   compound = &dict->compound;
 
   for (i = 0; i < (int)decoded_dict->num_prefix; i++) {
-    PreparedDictionary* prepared = CreatePreparedDictionary(m,
-        decoded_dict->prefix[i], decoded_dict->prefix_size[i]);
-    AttachPreparedDictionary(compound, prepared);
-    /* remember for cleanup */
-    compound->prepared_instances_[
-        compound->num_prepared_instances_++] = prepared;
+    if (cache) {
+      const uint32_t* chunk_size =
+          (const uint32_t*)CacheRead(cache, sizeof(uint32_t));
+      const uint8_t* chunk;
+      if (!chunk_size || *chunk_size > cache->available) return BROTLI_FALSE;
+      chunk = CacheRead(cache, CachePad(*chunk_size));
+      if (!chunk) return BROTLI_FALSE;
+      if (!IsValidSerializedPreparedDictionary(chunk, *chunk_size) ||
+          ((const PreparedDictionary*)chunk)->source_size !=
+          decoded_dict->prefix_size[i]) {
+        return BROTLI_FALSE;
+      }
+      /* Borrowed, so not remembered for cleanup. */
+      AttachPreparedDictionary(compound, (const PreparedDictionary*)chunk);
+    } else {
+      PreparedDictionary* prepared = CreatePreparedDictionary(m,
+          decoded_dict->prefix[i], decoded_dict->prefix_size[i]);
+      AttachPreparedDictionary(compound, prepared);
+      /* remember for cleanup */
+      compound->prepared_instances_[
+          compound->num_prepared_instances_++] = prepared;
+    }
   }
 
   dict->max_quality = quality;
@@ -544,7 +946,13 @@ static BROTLI_BOOL InitCustomSharedEncoderDictionary(
     contextual->instances_ = (BrotliEncoderDictionary*)
         BrotliAllocate(m, sizeof(*contextual->instances_) *
         contextual->num_instances_);
-    if (BROTLI_IS_OOM(m)) return BROTLI_FALSE;
+    if (BROTLI_IS_OOM(m)) {
+      contextual->num_instances_ = 0;
+      return BROTLI_FALSE;
+    }
+    /* Make instances safe to clean up if initialization fails midway. */
+    memset(contextual->instances_, 0,
+        sizeof(*contextual->instances_) * contextual->num_instances_);
     instances = contextual->instances_;
   }
   for (i = 0; i < (int)contextual->num_instances_; i++) {
@@ -562,7 +970,12 @@ static BROTLI_BOOL InitCustomSharedEncoderDictionary(
     }
     current->num_transforms =
         (uint32_t)decoded_dict->transforms[i]->num_transforms;
-    if (!ComputeDictionary(
+    if (cache) {
+      if (!LoadDictionaryFromCache(
+          cache, quality, decoded_dict->transforms[i], current)) {
+        return BROTLI_FALSE;
+      }
+    } else if (!ComputeDictionary(
         m, quality, decoded_dict->transforms[i], current)) {
       return BROTLI_FALSE;
     }
@@ -573,11 +986,25 @@ static BROTLI_BOOL InitCustomSharedEncoderDictionary(
   return BROTLI_TRUE;  /* success */
 }
 
-BROTLI_BOOL BrotliInitCustomSharedEncoderDictionary(
+static BROTLI_BOOL InitCustomSharedEncoderDictionaryWithCache(
     MemoryManager* m, const uint8_t* encoded_dict, size_t size,
-    int quality, SharedEncoderDictionary* dict) {
+    CacheReader* cache, int quality, SharedEncoderDictionary* dict) {
   BROTLI_BOOL success = BROTLI_FALSE;
-  BrotliSharedDictionary* decoded_dict = BrotliSharedDictionaryCreateInstance(
+  BrotliSharedDictionary* decoded_dict;
+  BrotliInitSharedEncoderDictionary(dict);
+  dict->source_hash_ = HashEncodedDictionary(encoded_dict, size);
+  dict->source_size_ = size;
+  if (cache) {
+    const uint32_t* header = (const uint32_t*)CacheRead(
+        cache, CACHE_HEADER_SIZE * sizeof(uint32_t));
+    if (!header || header[0] != kSharedDictionaryCacheMagic ||
+        header[1] != (uint32_t)dict->source_hash_ ||
+        header[2] != (uint32_t)(dict->source_hash_ >> 32) ||
+        header[3] != (uint32_t)size || (int)header[4] < quality) {
+      return BROTLI_FALSE;
+    }
+  }
+  decoded_dict = BrotliSharedDictionaryCreateInstance(
       m->alloc_func, m->free_func, m->opaque);
   if (!decoded_dict) {  /* OOM */
     return BROTLI_FALSE;
@@ -586,11 +1013,30 @@ BROTLI_BOOL BrotliInitCustomSharedEncoderDictionary(
       decoded_dict, BROTLI_SHARED_DICTIONARY_SERIALIZED, size, encoded_dict);
   if (success) {
     success = InitCustomSharedEncoderDictionary(m,
-        decoded_dict, quality, dict);
+        decoded_dict, cache, quality, dict);
   }
   BrotliSharedDictionaryDestroyInstance(decoded_dict);
   return success;
 }
+
+BROTLI_BOOL BrotliInitCustomSharedEncoderDictionary(
+    MemoryManager* m, const uint8_t* encoded_dict, size_t size,
+    int quality, SharedEncoderDictionary* dict) {
+  return InitCustomSharedEncoderDictionaryWithCache(
+      m, encoded_dict, size, NULL, quality, dict);
+}
+
+BROTLI_BOOL BrotliInitCustomSharedEncoderDictionaryFromCache(
+    MemoryManager* m, const uint8_t* encoded_dict, size_t size,
+    const uint8_t* cache, size_t cache_size,
+    int quality, SharedEncoderDictionary* dict) {
+  CacheReader reader;
+  if (((size_t)cache & 3) != 0) return BROTLI_FALSE;
+  reader.next = cache;
+  reader.available = cache_size;
+  return InitCustomSharedEncoderDictionaryWithCache(
+      m, encoded_dict, size, &reader, quality, dict);
+}
 #endif  /* BROTLI_EXPERIMENTAL */
 
 void BrotliCleanupSharedEncoderDictionary(MemoryManager* m,
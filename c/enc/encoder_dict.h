@@ -71,6 +71,8 @@ typedef struct BrotliEncoderDictionary {
   /* from static_dict_lut.h, for slow encoder */
   const uint16_t* buckets;
   const DictWord* dict_words;
+  /* Prefix filter for |buckets|; NULL for custom words / transforms. */
+  const uint32_t* prefix_filter;
   /* Heavy version, for use by slow encoder when there are custom transforms.
      Contains every possible transformed dictionary word in a trie. It encodes
      about as fast as the non-heavy encoder but consumes a lot of memory and
@@ -118,6 +120,11 @@ typedef struct SharedEncoderDictionary {
 
   /* The maximum quality the dictionary was computed for */
   int max_quality;
+
+  /* Fingerprint of the serialized dictionary this one was parsed from; used
+     to match the cache of derived lookup structures against it. */
+  uint64_t source_hash_;
+  size_t source_size_;
 } SharedEncoderDictionary;
 
 typedef struct ManagedDictionary {
@@ -137,6 +144,28 @@ BROTLI_INTERNAL void BrotliInitSharedEncoderDictionary(
 BROTLI_INTERNAL BROTLI_BOOL BrotliInitCustomSharedEncoderDictionary(
     MemoryManager* m, const uint8_t* encoded_dict, size_t size,
     int quality, SharedEncoderDictionary* dict);
+
+/* Same as BrotliInitCustomSharedEncoderDictionary, but instead of rebuilding
+   the lookup structures (hash tables, LUT, heavy trie and prepared prefixes)
+   uses them in place from |cache|. |cache| must be 4-byte aligned, must be
+   produced by BrotliSerializeSharedEncoderDictionaryCache for the same
+   |encoded_dict| and has to outlive |dict|. Returns BROTLI_FALSE if |cache|
+   is malformed or does not match. */
+BROTLI_INTERNAL BROTLI_BOOL BrotliInitCustomSharedEncoderDictionaryFromCache(
+    MemoryManager* m, const uint8_t* encoded_dict, size_t size,
+    const uint8_t* cache, size_t cache_size,
+    int quality, SharedEncoderDictionary* dict);
+
+/* Returns the size of cache of lookup structures derived from |dict|. */
+BROTLI_INTERNAL size_t BrotliGetSharedEncoderDictionaryCacheSize(
+    const SharedEncoderDictionary* dict);
+
+/* Writes cache of lookup structures derived from |dict| to |out|. Format
+   uses the native byte order and layout.
+   REQUIRES: |out| is 4-byte aligned and has
+             BrotliGetSharedEncoderDictionaryCacheSize() bytes. */
+BROTLI_INTERNAL void BrotliSerializeSharedEncoderDictionaryCache(
+    const SharedEncoderDictionary* dict, uint8_t* out);
 #endif  /* BROTLI_EXPERIMENTAL */
 
 BROTLI_INTERNAL void BrotliCleanupSharedEncoderDictionary(
@@ -39,6 +39,11 @@ typedef struct {
    * "composite" hasher uses up to 4 allocations.
    */
   void* extra[4];
+  /**
+   * Sizes of "extra" allocations; after encoder reset those are reused, if
+   * large enough.
+   */
+  size_t extra_size[4];
 
   /**
    * False before the first invocation of HasherSetup (where "extra" memory)
@@ -232,11 +237,36 @@ static BROTLI_INLINE size_t BackwardMatchLengthCode(const BackwardMatch* self) {
 #define CAT(a, b) a ## b
 #define FN(X) EXPAND_CAT(X, HASHER())
 
+/* fast large window hashers */
+
+#define HASHER() HROLLING_FAST
+#define CHUNKLEN 32
+#define JUMP 4
+#define NUMBUCKETS 16777216
+#define MASK ((NUMBUCKETS * 64) - 1)
+#include "hash_rolling_inc.h"  /* NOLINT(build/include) */
+#undef JUMP
+#undef HASHER
+
+
+#define HASHER() HROLLING
+#define JUMP 1
+#include "hash_rolling_inc.h"  /* NOLINT(build/include) */
+#undef MASK
+#undef NUMBUCKETS
+#undef JUMP
+#undef CHUNKLEN
+#undef HASHER
+
 #define HASHER() H10
 #define BUCKET_BITS 17
 #define MAX_TREE_SEARCH_DEPTH 64
 #define MAX_TREE_COMP_LENGTH 128
+#define MAX_TREE_WINDOW_BITS 24
+#define HASHER_FAR HROLLING
 #include "hash_to_binary_tree_inc.h"  /* NOLINT(build/include) */
+#undef HASHER_FAR
+#undef MAX_TREE_WINDOW_BITS
 #undef MAX_TREE_SEARCH_DEPTH
 #undef MAX_TREE_COMP_LENGTH
 #undef BUCKET_BITS
@@ -338,27 +368,6 @@ static BROTLI_INLINE size_t BackwardMatchLengthCode(const BackwardMatch* self) {
 #undef BUCKET_BITS
 #undef HASHER
 
-/* fast large window hashers */
-
-#define HASHER() HROLLING_FAST
-#define CHUNKLEN 32
-#define JUMP 4
-#define NUMBUCKETS 16777216
-#define MASK ((NUMBUCKETS * 64) - 1)
-#include "hash_rolling_inc.h"  /* NOLINT(build/include) */
-#undef JUMP
-#undef HASHER
-
-
-#define HASHER() HROLLING
-#define JUMP 1
-#include "hash_rolling_inc.h"  /* NOLINT(build/include) */
-#undef MASK
-#undef NUMBUCKETS
-#undef JUMP
-#undef CHUNKLEN
-#undef HASHER
-
 #define HASHER() H35
 #define HASHER_A H3
 #define HASHER_B HROLLING_FAST
@@ -416,6 +425,10 @@ static BROTLI_INLINE void HasherInit(Hasher* hasher) {
   hasher->common.extra[1] = NULL;
   hasher->common.extra[2] = NULL;
   hasher->common.extra[3] = NULL;
+  hasher->common.extra_size[0] = 0;
+  hasher->common.extra_size[1] = 0;
+  hasher->common.extra_size[2] = 0;
+  hasher->common.extra_size[3] = 0;
   hasher->common.base64_regions = NULL;
 }
 
@@ -461,8 +474,18 @@ static BROTLI_INLINE void HasherSetup(MemoryManager* m, Hasher* hasher,
     HasherSize(params, one_shot, input_size, alloc_size);
     for (i = 0; i < 4; ++i) {
       if (alloc_size[i] == 0) continue;
+      /* Memory left from the previous stream is reused. */
+      if (hasher->common.extra_size[i] >= alloc_size[i]) continue;
+      if (hasher->common.extra[i] != NULL) {
+        BROTLI_FREE(m, hasher->common.extra[i]);
+      }
+      hasher->common.extra_size[i] = 0;
       hasher->common.extra[i] = BROTLI_ALLOC(m, uint8_t, alloc_size[i]);
       if (BROTLI_IS_OOM(m) || BROTLI_IS_NULL(hasher->common.extra[i])) return;
+      hasher->common.extra_size[i] = alloc_size[i];
+    }
+    if (hasher->common.base64_regions != NULL) {
+      BROTLI_FREE(m, hasher->common.base64_regions);
     }
     if (params->base64_mode && params->max_base64_regions > 0) {
       hasher->common.base64_regions = BROTLI_ALLOC(
@@ -707,6 +730,200 @@ static BROTLI_INLINE size_t FindAllCompoundDictionaryMatches(
   return found;
 }
 
+/* Same as FindCompoundDictionaryMatch, but for bucketed index. Whole bucket
+   is one contiguous 64-byte run, so only one random memory access is required
+   to inspect all candidates; items with the same tag are checked first, others
+   only could give matches shorter than 8 bytes. */
+static BROTLI_INLINE void FindBucketedCompoundDictionaryMatch(
+    const PreparedDictionary* self, const uint8_t* BROTLI_RESTRICT data,
+    const size_t ring_buffer_mask, const int* BROTLI_RESTRICT distance_cache,
+    const size_t cur_ix, const size_t max_length, const size_t distance_offset,
+    const size_t max_distance, HasherSearchResult* BROTLI_RESTRICT out) {
+  const uint32_t source_size = self->source_size;
+  const size_t boundary = distance_offset - source_size;
+  const uint32_t hash_bits = self->hash_bits;
+  const uint32_t bucket_bits = self->bucket_bits;
+  const uint32_t tag_bits = PreparedDictionaryTagBits(source_size);
+
+  const uint32_t hash_shift = 64u - bucket_bits;
+  const uint64_t hash_mask = (~((uint64_t)0U)) >> (64 - hash_bits);
+  const uint32_t offset_mask = 0x7FFFFFFFu >> tag_bits;
+  const uint32_t tag_mask = 0x7FFFFFFFu & ~offset_mask;
+
+  const uint32_t* items = (const uint32_t*)(&self[1]);
+  const uint8_t* source = NULL;
+
+  const size_t cur_ix_masked = cur_ix & ring_buffer_mask;
+  score_t best_score = out->score;
+  size_t best_len = out->len;
+  size_t i;
+  size_t pass;
+  const uint64_t h =
+      (BROTLI_UNALIGNED_LOAD64LE(&data[cur_ix_masked]) & hash_mask) *
+      kPreparedDictionaryHashMul64Long;
+  const size_t key = (size_t)(h >> hash_shift);
+  const uint32_t* BROTLI_RESTRICT bucket =
+      &items[key << PREPARED_DICTIONARY_BUCKET_BITS];
+  const uint32_t tag = PreparedDictionaryTag(&data[cur_ix_masked], tag_bits);
+
+  const void* tail = (const void*)&items[self->num_items];
+  if (self->magic == kBucketedPreparedDictionaryMagic) {
+    source = (const uint8_t*)tail;
+  } else {
+    /* kLeanBucketedPreparedDictionaryMagic */
+    source = (const uint8_t*)BROTLI_UNALIGNED_LOAD_PTR((const uint8_t**)tail);
+  }
+
+  BROTLI_DCHECK(cur_ix_masked + max_length <= ring_buffer_mask + 1);
+
+  for (i = 0; i < 4; ++i) {
+    const size_t distance = (size_t)distance_cache[i];
+    size_t offset;
+    size_t limit;
+    size_t len;
+    if (distance <= boundary || distance > distance_offset) continue;
+    offset = distance_offset - distance;
+    limit = source_size - offset;
+    limit = limit > max_length ? max_length : limit;
+    len = FindMatchLengthWithLimit(&source[offset], &data[cur_ix_masked],
+                                   limit);
+    if (len >= 2) {
+      score_t score = BackwardReferenceScoreUsingLastDistance(len);
+      if (best_score < score) {
+        if (i != 0) score -= BackwardReferencePenaltyUsingLastDistance(i);
+        if (best_score < score) {
+          best_score = score;
+          if (len > best_len) best_len = len;
+          out->len = len;
+          out->len_code_delta = 0;
+          out->distance = distance;
+          out->score = best_score;
+        }
+      }
+    }
+  }
+  /* we require matches of len >4, so increase best_len to 3, so we can compare
+   * 4 bytes all the time. */
+  if (best_len < 3) {
+    best_len = 3;
+  }
+  for (pass = 0; pass < 2; ++pass) {
+    /* Items with other tag could not match 8 or more bytes. */
+    if (pass == 1 && best_len >= 7) break;
+    for (i = 0; i < PREPARED_DICTIONARY_BUCKET_SIZE; ++i) {
+      const uint32_t item = bucket[i];
+      size_t offset;
+      size_t distance;
+      size_t limit;
+      if (item & 0x80000000u) break;  /* The rest of bucket is unused. */
+      if (((item & tag_mask) == tag) != (pass == 0)) continue;
+      offset = item & offset_mask;
+      distance = distance_offset - offset;
+      limit = source_size - offset;
+      limit = (limit > max_length) ? max_length : limit;
+      if (distance > max_distance) continue;
+      if (cur_ix_masked + best_len > ring_buffer_mask || best_len >= limit ||
+          /* compare 4 bytes ending at best_len + 1 */
+          BrotliUnalignedRead32(&data[cur_ix_masked + best_len - 3]) !=
+              BrotliUnalignedRead32(&source[offset + best_len - 3])) {
+        continue;
+      }
+      {
+        const size_t len = FindMatchLengthWithLimit(&source[offset],
+                                                    &data[cur_ix_masked],
+                                                    limit);
+        if (len >= 4) {
+          score_t score = BackwardReferenceScore(len, distance);
+          if (best_score < score) {
+            best_score = score;
+            best_len = len;
+            out->len = best_len;
+            out->len_code_delta = 0;
+            out->distance = distance;
+            out->score = best_score;
+          }
+        }
+      }
+    }
+  }
+}
+
+/* Same as FindAllCompoundDictionaryMatches, but for bucketed index. */
+static BROTLI_INLINE size_t FindAllBucketedCompoundDictionaryMatches(
+    const PreparedDictionary* self, const uint8_t* BROTLI_RESTRICT data,
+    const size_t ring_buffer_mask, const size_t cur_ix, const size_t min_length,
+    const size_t max_length, const size_t distance_offset,
+    const size_t max_distance, BackwardMatch* matches, size_t match_limit) {
+  const uint32_t source_size = self->source_size;
+  const uint32_t hash_bits = self->hash_bits;
+  const uint32_t bucket_bits = self->bucket_bits;
+  const uint32_t tag_bits = PreparedDictionaryTagBits(source_size);
+
+  const uint32_t hash_shift = 64u - bucket_bits;
+  const uint64_t hash_mask = (~((uint64_t)0U)) >> (64 - hash_bits);
+  const uint32_t offset_mask = 0x7FFFFFFFu >> tag_bits;
+  const uint32_t tag_mask = 0x7FFFFFFFu & ~offset_mask;
+
+  const uint32_t* items = (const uint32_t*)(&self[1]);
+  const uint8_t* source = NULL;
+
+  const size_t cur_ix_masked = cur_ix & ring_buffer_mask;
+  size_t best_len = min_length;
+  size_t i;
+  size_t pass;
+  const uint64_t h =
+      (BROTLI_UNALIGNED_LOAD64LE(&data[cur_ix_masked]) & hash_mask) *
+      kPreparedDictionaryHashMul64Long;
+  const size_t key = (size_t)(h >> hash_shift);
+  const uint32_t* BROTLI_RESTRICT bucket =
+      &items[key << PREPARED_DICTIONARY_BUCKET_BITS];
+  const uint32_t tag = PreparedDictionaryTag(&data[cur_ix_masked], tag_bits);
+  size_t found = 0;
+
+  const void* tail = (const void*)&items[self->num_items];
+  if (self->magic == kBucketedPreparedDictionaryMagic) {
+    source = (const uint8_t*)tail;
+  } else {
+    /* kLeanBucketedPreparedDictionaryMagic */
+    source = (const uint8_t*)BROTLI_UNALIGNED_LOAD_PTR((const uint8_t**)tail);
+  }
+
+  BROTLI_DCHECK(cur_ix_masked + max_length <= ring_buffer_mask + 1);
+
+  for (pass = 0; pass < 2; ++pass) {
+    /* Items with other tag could not match 8 or more bytes. */
+    if (pass == 1 && best_len >= 7) break;
+    for (i = 0; i < PREPARED_DICTIONARY_BUCKET_SIZE; ++i) {
+      const uint32_t item = bucket[i];
+      size_t offset;
+      size_t distance;
+      size_t limit;
+      size_t len;
+      if (item & 0x80000000u) break;  /* The rest of bucket is unused. */
+      if (((item & tag_mask) == tag) != (pass == 0)) continue;
+      offset = item & offset_mask;
+      distance = distance_offset - offset;
+      limit = source_size - offset;
+      limit = (limit > max_length) ? max_length : limit;
+      if (distance > max_distance) continue;
+      if (cur_ix_masked + best_len > ring_buffer_mask ||
+          best_len >= limit ||
+          data[cur_ix_masked + best_len] != source[offset + best_len]) {
+        continue;
+      }
+      len = FindMatchLengthWithLimit(
+          &source[offset], &data[cur_ix_masked], limit);
+      if (len > best_len) {
+        best_len = len;
+        InitBackwardMatch(matches++, distance, len);
+        found++;
+        if (found == match_limit) return found;
+      }
+    }
+  }
+  return found;
+}
+
 static BROTLI_INLINE void LookupCompoundDictionaryMatch(
     const CompoundDictionary* addon, const uint8_t* BROTLI_RESTRICT data,
     const size_t ring_buffer_mask, const int* BROTLI_RESTRICT distance_cache,
@@ -716,11 +933,19 @@ static BROTLI_INLINE void LookupCompoundDictionaryMatch(
   size_t base_offset = max_ring_buffer_distance + 1 + addon->total_size - 1;
   size_t d;
   for (d = 0; d < addon->num_chunks; ++d) {
-    /* Only one prepared dictionary type is currently supported. */
-    FindCompoundDictionaryMatch(
-        (const PreparedDictionary*)addon->chunks[d], data, ring_buffer_mask,
-        distance_cache, cur_ix, max_length,
-        base_offset - addon->chunk_offsets[d], max_distance, sr);
+    /* Only prepared dictionaries are currently supported. */
+    const PreparedDictionary* chunk =
+        (const PreparedDictionary*)addon->chunks[d];
+    if (!(addon->search_mask & (1u << d))) continue;
+    if (IsBucketedPreparedDictionary(chunk)) {
+      FindBucketedCompoundDictionaryMatch(chunk, data, ring_buffer_mask,
+          distance_cache, cur_ix, max_length,
+          base_offset - addon->chunk_offsets[d], max_distance, sr);
+    } else {
+      FindCompoundDictionaryMatch(chunk, data, ring_buffer_mask,
+          distance_cache, cur_ix, max_length,
+          base_offset - addon->chunk_offsets[d], max_distance, sr);
+    }
   }
 }
 
@@ -734,11 +959,21 @@ static BROTLI_INLINE size_t LookupAllCompoundDictionaryMatches(
   size_t d;
   size_t total_found = 0;
   for (d = 0; d < addon->num_chunks; ++d) {
-    /* Only one prepared dictionary type is currently supported. */
-    total_found += FindAllCompoundDictionaryMatches(
-        (const PreparedDictionary*)addon->chunks[d], data, ring_buffer_mask,
-        cur_ix, min_length, max_length, base_offset - addon->chunk_offsets[d],
-        max_distance, matches + total_found, match_limit - total_found);
+    /* Only prepared dictionaries are currently supported. */
+    const PreparedDictionary* chunk =
+        (const PreparedDictionary*)addon->chunks[d];
+    if (!(addon->search_mask & (1u << d))) continue;
+    if (IsBucketedPreparedDictionary(chunk)) {
+      total_found += FindAllBucketedCompoundDictionaryMatches(chunk, data,
+          ring_buffer_mask, cur_ix, min_length, max_length,
+          base_offset - addon->chunk_offsets[d], max_distance,
+          matches + total_found, match_limit - total_found);
+    } else {
+      total_found += FindAllCompoundDictionaryMatches(chunk, data,
+          ring_buffer_mask, cur_ix, min_length, max_length,
+          base_offset - addon->chunk_offsets[d], max_distance,
+          matches + total_found, match_limit - total_found);
+    }
     if (total_found == match_limit) break;
     if (total_found > 0) {
       min_length = BackwardMatchLength(&matches[total_found - 1]);
@@ -747,6 +982,58 @@ static BROTLI_INLINE size_t LookupAllCompoundDictionaryMatches(
   return total_found;
 }
 
+/* Returns the length of the longest match of data at |cur_ix| in |self|.
+   Only matches of 8+ bytes are reported, otherwise 0. */
+static BROTLI_INLINE size_t LongestCompoundDictionaryMatch(
+    const PreparedDictionary* self, const uint8_t* BROTLI_RESTRICT data,
+    const size_t ring_buffer_mask, const size_t cur_ix,
+    const size_t max_length) {
+  /* Each match found is longer than the previous one. */
+  BackwardMatch matches[PREPARED_DICTIONARY_BUCKET_SIZE];
+  size_t found;
+  if (IsBucketedPreparedDictionary(self)) {
+    found = FindAllBucketedCompoundDictionaryMatches(self, data,
+        ring_buffer_mask, cur_ix, 7, max_length, self->source_size,
+        self->source_size, matches, PREPARED_DICTIONARY_BUCKET_SIZE);
+  } else {
+    found = FindAllCompoundDictionaryMatches(self, data,
+        ring_buffer_mask, cur_ix, 7, max_length, self->source_size,
+        self->source_size, matches, PREPARED_DICTIONARY_BUCKET_SIZE);
+  }
+  return (found != 0) ? BackwardMatchLength(&matches[found - 1]) : 0;
+}
+
+/* Leaves only one chunk searchable: the one that covers |size| bytes at
+   |position| best. If no chunk has long enough matches there, none is
+   searched. Only the beginning of input is inspected; positions are probed
+   with a small step, and covered regions are skipped. */
+static BROTLI_INLINE void SelectCompoundDictionaryChunk(
+    CompoundDictionary* compound, const uint8_t* BROTLI_RESTRICT data,
+    const size_t ring_buffer_mask, const size_t position, size_t size) {
+  const size_t kSampleSize = 4096;
+  const size_t kStride = 4;
+  size_t best_score = 0;
+  size_t best_chunk = compound->num_chunks;
+  size_t d;
+  if (size > kSampleSize) size = kSampleSize;
+  for (d = 0; d < compound->num_chunks; ++d) {
+    size_t score = 0;
+    size_t pos = 0;
+    while (pos + 8 <= size) {
+      size_t len = LongestCompoundDictionaryMatch(compound->chunks[d], data,
+          ring_buffer_mask, position + pos, size - pos);
+      score += len;
+      pos += (len != 0) ? len : kStride;
+    }
+    if (score > best_score) {
+      best_score = score;
+      best_chunk = d;
+    }
+  }
+  compound->search_mask =
+      (best_chunk < compound->num_chunks) ? (1u << best_chunk) : 0;
+}
+
 #if defined(__cplusplus) || defined(c_plusplus)
 }  /* extern "C" */
 #endif
@@ -6,17 +6,24 @@
 */
 
 /* template parameters: FN, BUCKET_BITS, MAX_TREE_COMP_LENGTH,
-                        MAX_TREE_SEARCH_DEPTH */
+                        MAX_TREE_SEARCH_DEPTH, MAX_TREE_WINDOW_BITS,
+                        HASHER_FAR */
 
 /* A (forgetful) hash table where each hash bucket contains a binary tree of
    sequences whose first 4 bytes share the same hash code.
    Each sequence is MAX_TREE_COMP_LENGTH long and is identified by its starting
    position in the input data. The binary tree is sorted by the lexicographic
    order of the sequences, and it is also a max-heap with respect to the
-   starting positions. */
+   starting positions.
+
+   The forest covers at most the last 2^MAX_TREE_WINDOW_BITS positions. With a
+   larger (large-window) sliding window, the rolling hasher HASHER_FAR is used
+   to find long repeats that are further away. */
 
 #define HashToBinaryTree HASHER()
 
+#define FN_FAR(X) EXPAND_CAT(X, HASHER_FAR)
+
 #define BUCKET_SIZE (1 << BUCKET_BITS)
 
 static BROTLI_INLINE size_t FN(HashTypeLength)(void) { return 4; }
@@ -52,16 +59,32 @@ typedef struct HashToBinaryTree {
      the left and right children of a sequence starting at pos are
      forest_[2 * pos] and forest_[2 * pos + 1]. */
   uint32_t* forest_;  /* uint32_t[2 * num_nodes] */
+
+  /* True if the window does not fit the forest; then far_ is used. */
+  BROTLI_BOOL use_far_;
+  HASHER_FAR far_;
 } HashToBinaryTree;
 
+static BROTLI_INLINE int FN(TreeWindowBits)(const BrotliEncoderParams* params) {
+  return BROTLI_MIN(int, params->lgwin, MAX_TREE_WINDOW_BITS);
+}
+
 static void FN(Initialize)(
     HasherCommon* common, HashToBinaryTree* BROTLI_RESTRICT self,
     const BrotliEncoderParams* params) {
   self->buckets_ = (uint32_t*)common->extra[0];
   self->forest_ = (uint32_t*)common->extra[1];
 
-  self->window_mask_ = (1u << params->lgwin) - 1u;
+  self->window_mask_ = (1u << FN(TreeWindowBits)(params)) - 1u;
   self->invalid_pos_ = (uint32_t)(0 - self->window_mask_);
+
+  self->use_far_ = TO_BROTLI_BOOL(params->lgwin > MAX_TREE_WINDOW_BITS);
+  if (self->use_far_) {
+    HasherCommon far_common = *common;
+    far_common.extra[0] = common->extra[2];
+    far_common.extra[1] = NULL;
+    FN_FAR(Initialize)(&far_common, &self->far_, params);
+  }
 }
 
 static void FN(Prepare)
@@ -70,23 +93,26 @@ static void FN(Prepare)
   uint32_t invalid_pos = self->invalid_pos_;
   uint32_t i;
   uint32_t* BROTLI_RESTRICT buckets = self->buckets_;
-  BROTLI_UNUSED(data);
-  BROTLI_UNUSED(one_shot);
-  BROTLI_UNUSED(input_size);
   for (i = 0; i < BUCKET_SIZE; i++) {
     buckets[i] = invalid_pos;
   }
+  if (self->use_far_) {
+    FN_FAR(Prepare)(&self->far_, one_shot, input_size, data);
+  }
 }
 
 static BROTLI_INLINE void FN(HashMemAllocInBytes)(
     const BrotliEncoderParams* params, BROTLI_BOOL one_shot,
     size_t input_size, size_t* alloc_size) {
-  size_t num_nodes = (size_t)1 << params->lgwin;
+  size_t num_nodes = (size_t)1 << FN(TreeWindowBits)(params);
   if (one_shot && input_size < num_nodes) {
     num_nodes = input_size;
   }
   alloc_size[0] = sizeof(uint32_t) * BUCKET_SIZE;
   alloc_size[1] = 2 * sizeof(uint32_t) * num_nodes;
+  if (params->lgwin > MAX_TREE_WINDOW_BITS) {
+    FN_FAR(HashMemAllocInBytes)(params, one_shot, input_size, &alloc_size[2]);
+  }
 }
 
 static BROTLI_INLINE size_t FN(LeftChildIndex)(
@@ -198,7 +224,8 @@ static BROTLI_INLINE BackwardMatch* FN(StoreAndFindMatches)(
    Sets *num_matches to the number of matches found, and stores the found
    matches in matches[0] to matches[*num_matches - 1]. The matches will be
    sorted by strictly increasing length and (non-strictly) increasing
-   distance. */
+   distance; static dictionary matches go last and are sorted by length
+   only. */
 static BROTLI_INLINE size_t FN(FindAllMatches)(
     HashToBinaryTree* BROTLI_RESTRICT self,
     const BrotliEncoderDictionary* dictionary,
@@ -209,6 +236,9 @@ static BROTLI_INLINE size_t FN(FindAllMatches)(
     BackwardMatch* matches) {
   BackwardMatch* const orig_matches = matches;
   const size_t cur_ix_masked = cur_ix & ring_buffer_mask;
+  /* Maximum distance is window size - 16, see section 9.1. of the spec. */
+  const size_t max_tree_backward = BROTLI_MIN(size_t, max_backward,
+      self->window_mask_ - BROTLI_WINDOW_GAP + 1);
   size_t best_len = 1;
   const size_t short_match_max_backward =
       params->quality != HQ_ZOPFLIFICATION_QUALITY ? 16 : 64;
@@ -239,7 +269,29 @@ static BROTLI_INLINE size_t FN(FindAllMatches)(
   }
   if (best_len < max_length) {
     matches = FN(StoreAndFindMatches)(self, data, cur_ix,
-        ring_buffer_mask, max_length, max_backward, &best_len, matches);
+        ring_buffer_mask, max_length, max_tree_backward, &best_len, matches);
+  }
+  if (self->use_far_) {
+    /* Rolling hasher has to see every position, even if the forest has
+       already found the longest possible match. */
+    HasherSearchResult far_match;
+    far_match.len = best_len;
+    far_match.len_code_delta = 0;
+    far_match.distance = 0;
+    far_match.score = 0;
+    FN_FAR(FindLongestMatch)(&self->far_, dictionary, data, ring_buffer_mask,
+        NULL, cur_ix, max_length, max_backward, dictionary_distance,
+        params->dist.max_distance, &far_match);
+    if (far_match.len > best_len) {
+      /* Shorter matches that are not closer are useless; dropping them keeps
+         distances increasing. */
+      while (matches != orig_matches &&
+             matches[-1].distance >= far_match.distance) {
+        --matches;
+      }
+      best_len = far_match.len;
+      InitBackwardMatch(matches++, far_match.distance, far_match.len);
+    }
   }
   for (i = 0; i <= BROTLI_MAX_STATIC_DICTIONARY_MATCH_LEN; ++i) {
     dict_matches[i] = kInvalidMatch;
@@ -262,6 +314,14 @@ static BROTLI_INLINE size_t FN(FindAllMatches)(
       }
     }
   }
+#if defined(BROTLI_DEBUG) || defined(BROTLI_ENABLE_LOG)
+  for (i = 1; orig_matches + i < matches; ++i) {
+    BROTLI_DCHECK(BackwardMatchLength(&orig_matches[i - 1]) <
+                  BackwardMatchLength(&orig_matches[i]));
+    BROTLI_DCHECK(orig_matches[i].distance > max_backward ||
+                  orig_matches[i - 1].distance <= orig_matches[i].distance);
+  }
+#endif
   return (size_t)(matches - orig_matches);
 }
 
@@ -323,8 +383,14 @@ static BROTLI_INLINE void FN(StitchToPreviousBlock)(
           MAX_TREE_COMP_LENGTH, max_backward, NULL, NULL);
     }
   }
+  if (self->use_far_) {
+    FN_FAR(StitchToPreviousBlock)(&self->far_, num_bytes, position,
+        ringbuffer, ringbuffer_mask);
+  }
 }
 
 #undef BUCKET_SIZE
 
+#undef FN_FAR
+
 #undef HashToBinaryTree
@@ -48,4 +48,14 @@ static BROTLI_INLINE void FN(HistogramAddHistogram)(FN(Histogram)* self,
   }
 }
 
+/* Sets self to a + b in a single pass; bit_cost_ is left untouched. */
+static BROTLI_INLINE void FN(HistogramSetSum)(FN(Histogram)* self,
+    const FN(Histogram)* a, const FN(Histogram)* b) {
+  size_t i;
+  self->total_count_ = a->total_count_ + b->total_count_;
+  for (i = 0; i < DATA_SIZE; ++i) {
+    self->data_[i] = a->data_[i] + b->data_[i];
+  }
+}
+
 static BROTLI_INLINE size_t FN(HistogramDataSize)(void) { return DATA_SIZE; }
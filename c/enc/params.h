@@ -44,6 +44,7 @@ typedef struct BrotliEncoderParams {
   int base64_mode;
   size_t max_base64_regions;
   BrotliEncoderSimdHasher simd_hasher;
+  BROTLI_BOOL dictionary_selection;
 } BrotliEncoderParams;
 
 #endif  /* BROTLI_ENC_PARAMS_H_ */
@@ -206,10 +206,14 @@ static BROTLI_INLINE void ChooseHasher(const BrotliEncoderParams* params,
   if (params->lgwin > 24) {
     /* Different hashers for large window brotli: not for qualities <= 2,
        these are too fast for large window. Not for qualities >= 10: their
-       hasher already works well with large window. So the changes are:
+       hasher adds a rolling hasher itself once the window does not fit the
+       binary tree forest. So the changes are:
        H3 --> H35: for quality 3.
        H54 --> H55: for quality 4 with size hint > 1MB
-       H6/H68 --> H65: for qualities 5, 6, 7, 8, 9. */
+       H6/H68 --> H65: for qualities 5, 6, 7, 8, 9 with size hint > 1MB.
+       Smaller inputs could not use the long-distance rolling hasher, but its
+       table is 64MiB. Streams of unknown size are assumed to be large, see
+       UpdateSizeHint. */
     if (hparams->type == 3) {
       hparams->type = 35;
     }
@@ -35,6 +35,8 @@ typedef struct RingBuffer {
   const uint32_t total_size_;
 
   uint32_t cur_size_;
+  /* Allocated size; could be bigger than |cur_size_| after reset. */
+  uint32_t alloc_size_;
   /* Position to write in the ring buffer. */
   uint32_t pos_;
   /* The actual ring buffer containing the copy of the last two bytes, the data,
@@ -46,11 +48,18 @@ typedef struct RingBuffer {
 
 static BROTLI_INLINE void RingBufferInit(RingBuffer* rb) {
   rb->cur_size_ = 0;
+  rb->alloc_size_ = 0;
   rb->pos_ = 0;
   rb->data_ = 0;
   rb->buffer_ = 0;
 }
 
+/* Prepares ring buffer for the next stream; allocated memory is kept. */
+static BROTLI_INLINE void RingBufferReset(RingBuffer* rb) {
+  rb->cur_size_ = 0;
+  rb->pos_ = 0;
+}
+
 static BROTLI_INLINE void RingBufferSetup(
     const BrotliEncoderParams* params, RingBuffer* rb) {
   int window_bits = ComputeRbBits(params);
@@ -70,16 +79,19 @@ static BROTLI_INLINE void RingBufferFree(MemoryManager* m, RingBuffer* rb) {
 static BROTLI_INLINE void RingBufferInitBuffer(
     MemoryManager* m, const uint32_t buflen, RingBuffer* rb) {
   static const size_t kSlackForEightByteHashingEverywhere = 7;
-  uint8_t* new_data = BROTLI_ALLOC(
-      m, uint8_t, 2 + buflen + kSlackForEightByteHashingEverywhere);
   size_t i;
-  if (BROTLI_IS_OOM(m) || BROTLI_IS_NULL(new_data)) return;
-  if (rb->data_) {
-    memcpy(new_data, rb->data_,
-        2 + rb->cur_size_ + kSlackForEightByteHashingEverywhere);
-    BROTLI_FREE(m, rb->data_);
+  if (buflen > rb->alloc_size_ || !rb->data_) {
+    uint8_t* new_data = BROTLI_ALLOC(
+        m, uint8_t, 2 + buflen + kSlackForEightByteHashingEverywhere);
+    if (BROTLI_IS_OOM(m) || BROTLI_IS_NULL(new_data)) return;
+    if (rb->data_) {
+      memcpy(new_data, rb->data_,
+          2 + rb->cur_size_ + kSlackForEightByteHashingEverywhere);
+      BROTLI_FREE(m, rb->data_);
+    }
+    rb->data_ = new_data;
+    rb->alloc_size_ = buflen;
   }
-  rb->data_ = new_data;
   rb->cur_size_ = buflen;
   rb->buffer_ = rb->data_ + 2;
   rb->buffer_[-2] = rb->buffer_[-1] = 0;
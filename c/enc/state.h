@@ -94,6 +94,11 @@ typedef struct BrotliEncoderStateStruct {
   uint32_t remaining_metadata_bytes_;
   BrotliEncoderStreamState stream_state_;
 
+  brotli_encoder_dictionary_reference_func dictionary_reference_func_;
+  void* dictionary_reference_opaque_;
+  brotli_encoder_stage_func stage_func_;
+  void* stage_opaque_;
+
   BROTLI_BOOL is_last_block_emitted_;
   BROTLI_BOOL is_initialized_;
 } BrotliEncoderStateStruct;
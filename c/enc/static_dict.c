@@ -68,6 +68,14 @@ static BROTLI_INLINE BROTLI_BOOL IsMatch(const BrotliDictionary* dictionary,
   }
 }
 
+/* Returns BROTLI_FALSE if there are certainly no words (of 4+ bytes) starting
+   at |data| in the LUT of |dictionary|. */
+static BROTLI_INLINE BROTLI_BOOL MayHaveWords(
+    const BrotliEncoderDictionary* dictionary, const uint8_t* data) {
+  if (!dictionary->prefix_filter) return BROTLI_TRUE;
+  return StaticDictionaryFilterMayMatch(dictionary->prefix_filter, data);
+}
+
 /* Finds matches for a single static dictionary */
 static BROTLI_BOOL BrotliFindAllStaticDictionaryMatchesFor(
     const BrotliEncoderDictionary* dictionary, const uint8_t* data,
@@ -89,7 +97,7 @@ static BROTLI_BOOL BrotliFindAllStaticDictionaryMatchesFor(
     return has_found_match;
   }
 #endif  /* BROTLI_EXPERIMENTAL */
-  {
+  if (MayHaveWords(dictionary, data)) {
     size_t offset = dictionary->buckets[Hash15(data)];
     BROTLI_BOOL end = !offset;
     while (!end) {
@@ -333,7 +341,8 @@ static BROTLI_BOOL BrotliFindAllStaticDictionaryMatchesFor(
     }
   }
   /* Transforms with prefixes " " and "." */
-  if (max_length >= 5 && (data[0] == ' ' || data[0] == '.')) {
+  if (max_length >= 5 && (data[0] == ' ' || data[0] == '.') &&
+      MayHaveWords(dictionary, &data[1])) {
     BROTLI_BOOL is_space = TO_BROTLI_BOOL(data[0] == ' ');
     size_t offset = dictionary->buckets[Hash15(&data[1])];
     BROTLI_BOOL end = !offset;
@@ -427,9 +436,10 @@ static BROTLI_BOOL BrotliFindAllStaticDictionaryMatchesFor(
   }
   if (max_length >= 6) {
     /* Transforms with prefixes "e ", "s ", ", " and "\xC2\xA0" */
-    if ((data[1] == ' ' &&
-         (data[0] == 'e' || data[0] == 's' || data[0] == ',')) ||
-        (data[0] == 0xC2 && data[1] == 0xA0)) {
+    if (((data[1] == ' ' &&
+          (data[0] == 'e' || data[0] == 's' || data[0] == ',')) ||
+         (data[0] == 0xC2 && data[1] == 0xA0)) &&
+        MayHaveWords(dictionary, &data[2])) {
       size_t offset = dictionary->buckets[Hash15(&data[2])];
       BROTLI_BOOL end = !offset;
       while (!end) {
@@ -455,10 +465,11 @@ static BROTLI_BOOL BrotliFindAllStaticDictionaryMatchesFor(
   }
   if (max_length >= 9) {
     /* Transforms with prefixes " the " and ".com/" */
-    if ((data[0] == ' ' && data[1] == 't' && data[2] == 'h' &&
-         data[3] == 'e' && data[4] == ' ') ||
-        (data[0] == '.' && data[1] == 'c' && data[2] == 'o' &&
-         data[3] == 'm' && data[4] == '/')) {
+    if (((data[0] == ' ' && data[1] == 't' && data[2] == 'h' &&
+          data[3] == 'e' && data[4] == ' ') ||
+         (data[0] == '.' && data[1] == 'c' && data[2] == 'o' &&
+          data[3] == 'm' && data[4] == '/')) &&
+        MayHaveWords(dictionary, &data[5])) {
       size_t offset = dictionary->buckets[Hash15(&data[5])];
       BROTLI_BOOL end = !offset;
       while (!end) {
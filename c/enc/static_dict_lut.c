@@ -23,10 +23,15 @@ extern "C" {
 
 #if (BROTLI_STATIC_INIT != BROTLI_STATIC_INIT_NONE)
 
+static void SetFilterBit(uint32_t* filter, const uint8_t* data) {
+  const uint32_t h = StaticDictionaryFilterHash(data);
+  filter[h >> 5] |= 1u << (h & 31);
+}
+
 /* TODO(eustas): deal with largest bucket(s). Not it contains 163 items. */
 static BROTLI_BOOL BROTLI_COLD DoBrotliEncoderInitStaticDictionaryLut(
     const BrotliDictionary* dict, uint16_t* buckets, DictWord* words,
-    void* arena) {
+    uint32_t* filter, void* arena) {
   DictWord* slots = (DictWord*)arena;
   uint16_t* heads = (uint16_t*)(slots + BROTLI_ENC_STATIC_DICT_LUT_NUM_ITEMS);
   uint16_t* counts = heads + BROTLI_ENC_STATIC_DICT_LUT_NUM_BUCKETS;
@@ -188,11 +193,36 @@ static BROTLI_BOOL BROTLI_COLD DoBrotliEncoderInitStaticDictionaryLut(
     }
     words[pos - 1].len |= 0x80;
   }
+
+  memset(filter, 0, BROTLI_ENC_STATIC_DICT_LUT_FILTER_SIZE * sizeof(uint32_t));
+  for (i = 1; i < BROTLI_ENC_STATIC_DICT_LUT_NUM_ITEMS; ++i) {
+    const DictWord w = words[i];
+    const size_t len = w.len & 0x1F;
+    const uint8_t* dict_word =
+        dict->data + dict->offsets_by_length[len] + len * w.idx;
+    size_t k;
+    memcpy(transformed_word, dict_word, 4);
+    for (k = 0; k < 4; ++k) {
+      if (w.transform == BROTLI_TRANSFORM_IDENTITY) break;
+      if (transformed_word[k] >= 'a' && transformed_word[k] <= 'z') {
+        transformed_word[k] = transformed_word[k] - 32;
+      }
+      if (w.transform == BROTLI_TRANSFORM_UPPERCASE_FIRST) break;
+    }
+    SetFilterBit(filter, transformed_word);
+    /* "" + BROTLI_TRANSFORM_OMIT_LAST_1 + "ing " matches 4-byte words by
+       3-byte prefix. */
+    if (len == 4 && w.transform == BROTLI_TRANSFORM_IDENTITY) {
+      transformed_word[3] = 'i';
+      SetFilterBit(filter, transformed_word);
+    }
+  }
   return BROTLI_TRUE;
 }
 
 BROTLI_BOOL BrotliEncoderInitStaticDictionaryLut(
-    const BrotliDictionary* dict, uint16_t* buckets, DictWord* words) {
+    const BrotliDictionary* dict, uint16_t* buckets, DictWord* words,
+    uint32_t* filter) {
   size_t arena_size =
       BROTLI_ENC_STATIC_DICT_LUT_NUM_ITEMS *
           (sizeof(uint16_t) + sizeof(DictWord)) +
@@ -202,7 +232,8 @@ BROTLI_BOOL BrotliEncoderInitStaticDictionaryLut(
   if (arena == NULL) {
     return BROTLI_FALSE;
   }
-  ok = DoBrotliEncoderInitStaticDictionaryLut(dict, buckets, words, arena);
+  ok = DoBrotliEncoderInitStaticDictionaryLut(
+      dict, buckets, words, filter, arena);
   free(arena);
   return ok;
 }
@@ -211,10 +242,13 @@ BROTLI_MODEL("small")
 uint16_t kStaticDictionaryBuckets[BROTLI_ENC_STATIC_DICT_LUT_NUM_BUCKETS];
 BROTLI_MODEL("small")
 DictWord kStaticDictionaryWords[BROTLI_ENC_STATIC_DICT_LUT_NUM_ITEMS];
+BROTLI_MODEL("small")
+uint32_t kStaticDictionaryFilter[BROTLI_ENC_STATIC_DICT_LUT_FILTER_SIZE];
 
 #else  /* BROTLI_STATIC_INIT */
 
-/* Embed kStaticDictionaryBuckets and kStaticDictionaryWords. */
+/* Embed kStaticDictionaryBuckets, kStaticDictionaryWords and
+   kStaticDictionaryFilter. */
 #include "static_dict_lut_inc.h"
 
 #endif  /* BROTLI_STATIC_INIT */
@@ -28,18 +28,44 @@ typedef struct DictWord {
 #define BROTLI_ENC_STATIC_DICT_LUT_NUM_BUCKETS 32768
 #define BROTLI_ENC_STATIC_DICT_LUT_NUM_ITEMS 31705
 
+/* Bit-set over hashes of 4-byte prefixes of all (transformed) words in LUT.
+   Static dictionary matches not shorter than 4 bytes are only possible at
+   positions which prefix bit is set; unlike buckets, filter is small enough
+   to stay in L1 cache. */
+#define BROTLI_ENC_STATIC_DICT_LUT_FILTER_BITS 16
+#define BROTLI_ENC_STATIC_DICT_LUT_FILTER_SIZE \
+  (1u << (BROTLI_ENC_STATIC_DICT_LUT_FILTER_BITS - 5))
+
+static BROTLI_INLINE uint32_t StaticDictionaryFilterHash(const uint8_t* data) {
+  /* Multiplier differs from kHashMul32, so filter hash is independent from
+     bucket hash. */
+  uint32_t h = BROTLI_UNALIGNED_LOAD32LE(data) * 0x9E3779B1u;
+  return h >> (32 - BROTLI_ENC_STATIC_DICT_LUT_FILTER_BITS);
+}
+
+static BROTLI_INLINE BROTLI_BOOL StaticDictionaryFilterMayMatch(
+    const uint32_t* filter, const uint8_t* data) {
+  const uint32_t h = StaticDictionaryFilterHash(data);
+  return TO_BROTLI_BOOL((filter[h >> 5] >> (h & 31)) & 1);
+}
+
 #if (BROTLI_STATIC_INIT != BROTLI_STATIC_INIT_NONE)
 BROTLI_INTERNAL BROTLI_BOOL BrotliEncoderInitStaticDictionaryLut(
-    const BrotliDictionary* dictionary, uint16_t* buckets, DictWord* words);
+    const BrotliDictionary* dictionary, uint16_t* buckets, DictWord* words,
+    uint32_t* filter);
 BROTLI_INTERNAL extern BROTLI_MODEL("small") uint16_t
     kStaticDictionaryBuckets[BROTLI_ENC_STATIC_DICT_LUT_NUM_BUCKETS];
 BROTLI_INTERNAL extern BROTLI_MODEL("small") DictWord
     kStaticDictionaryWords[BROTLI_ENC_STATIC_DICT_LUT_NUM_ITEMS];
+BROTLI_INTERNAL extern BROTLI_MODEL("small") uint32_t
+    kStaticDictionaryFilter[BROTLI_ENC_STATIC_DICT_LUT_FILTER_SIZE];
 #else
 BROTLI_INTERNAL extern const BROTLI_MODEL("small") uint16_t
     kStaticDictionaryBuckets[BROTLI_ENC_STATIC_DICT_LUT_NUM_BUCKETS];
 BROTLI_INTERNAL extern const BROTLI_MODEL("small") DictWord
     kStaticDictionaryWords[BROTLI_ENC_STATIC_DICT_LUT_NUM_ITEMS];
+BROTLI_INTERNAL extern const BROTLI_MODEL("small") uint32_t
+    kStaticDictionaryFilter[BROTLI_ENC_STATIC_DICT_LUT_FILTER_SIZE];
 #endif
 
 #if defined(__cplusplus) || defined(c_plusplus)
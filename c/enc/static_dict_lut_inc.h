@@ -5828,3 +5828,299 @@ DictWord kStaticDictionaryWords[BROTLI_ENC_STATIC_DICT_LUT_NUM_ITEMS] = {
 134,0,1504},{5,11,383},{134,0,757},{6,0,1266},{135,0,1735},{5,0,598},{7,0,791},{
 7,10,1570},{8,0,108},{9,0,123},{140,10,542},{142,11,410},{9,11,660},{138,11,347}
 };
+
+const BROTLI_MODEL("small")
+uint32_t kStaticDictionaryFilter[BROTLI_ENC_STATIC_DICT_LUT_FILTER_SIZE] = {
+0x00802861,0x00202C0A,0x04080848,0x00008800,0x20062000,0x80250002,0x80000100,
+0x84529400,0x00402001,0x30040100,0x60000000,0x04200510,0x90401880,0x80000800,
+0x01042000,0x8442C000,0x06100808,0x019A0404,0xC8004001,0x040440C2,0x8AA125C0,
+0x300041A0,0x0000C840,0x0100D000,0x18800020,0x0028000E,0x2897A004,0x80C1A000,
+0x281080A0,0x64200607,0x020200B0,0x43000023,0x40610040,0x30001B01,0x8C04008C,
+0x86009542,0x20000200,0x320A0880,0xE0109000,0x00680004,0x10401000,0x00440004,
+0x02280192,0x00901040,0x20118450,0x0848D2A2,0x03040202,0x8503C000,0x0C091044,
+0x01040220,0x00080200,0x20100000,0x04041080,0x002D0004,0x68403019,0x4084100A,
+0x88004720,0x74080800,0xC0004924,0x1108001E,0x28228A00,0x000B10D0,0x49004111,
+0x08201844,0x808242C4,0x00421400,0xC4842280,0x11010420,0x23020810,0xA9808028,
+0x31200100,0x2098D200,0x0008C84C,0x00808901,0xA00A0001,0x00000186,0x0051010A,
+0x05400002,0x00802030,0x100000C0,0x81000580,0x0064004C,0x004844E2,0x42100000,
+0x43006000,0x30800406,0x20820001,0x59040080,0x8506084D,0x02022432,0x42800104,
+0x11006080,0x44080610,0xA8005800,0x08800000,0x00120009,0x22208088,0x00015000,
+0x20020000,0x040C0000,0x80010204,0x244C4480,0x00800303,0x01400203,0x40044003,
+0x147C4B00,0x08040060,0xB8002040,0x80083082,0x00208550,0x40000880,0x00102090,
+0xA1040000,0xC0304802,0x00001110,0x06801810,0xC0182098,0x00500018,0x0424A001,
+0x0A082002,0x00002100,0x00200820,0x2F084008,0x41201300,0x6024048C,0x0118C889,
+0x0C000000,0x80101122,0x03300402,0x00000483,0x5C000404,0xA0548090,0x80860104,
+0x88004001,0x54200000,0x40621800,0xA02000A1,0x08020018,0x90108602,0x01941504,
+0x10280A44,0x0F102000,0x0A000840,0x00280084,0x00103000,0x28991400,0x03020000,
+0x40040100,0x10892100,0x81001000,0x81502010,0x21009140,0x00880401,0x02080302,
+0x00202A30,0x51108800,0x1080214E,0x20201480,0x00106844,0x01858400,0x04000000,
+0x82160001,0x0000200C,0x3C881000,0x18105800,0x27204100,0x41024802,0x00409800,
+0x00040000,0x000A1404,0x032B4182,0x30886840,0x82904422,0x00AC1004,0x0A004008,
+0x3914E802,0x04816000,0x80200100,0x40C8A408,0x0010C088,0x04001820,0x10851300,
+0x40021804,0x400A8928,0x14820424,0x72041848,0x0A220481,0x00200A55,0xA4010808,
+0x10001198,0x08000080,0x00400100,0x1840209C,0x38142401,0x05000140,0x08200040,
+0x02200012,0x01085800,0x00010409,0x00888110,0x08850040,0x01004813,0x48006221,
+0x80040048,0x90000000,0x41041020,0x02063246,0x40800012,0x0A114820,0x04381108,
+0x00000000,0x88008012,0x00000408,0x00422000,0x00800102,0x0A821000,0x5D000460,
+0x08022500,0x00428000,0x00090581,0x41A88920,0x040E0226,0x011A0100,0x03010210,
+0x4D825860,0x000000A1,0x404A0400,0x81040004,0x03308208,0x04020102,0x09000000,
+0x00000201,0x80010000,0x0002000A,0x80000820,0x01D00000,0x00088510,0x2A816406,
+0x50425003,0x43880308,0xC0020004,0x0E021444,0x06000500,0x00486082,0x44000000,
+0x0C801400,0x21004120,0x00982024,0x0C0084C0,0x00200801,0x0C0000C0,0x85014000,
+0x00048320,0xA4110710,0x01210108,0x41144801,0x11214000,0x60E01018,0x001004A0,
+0x02000000,0x01040528,0x00800100,0x00000800,0x8110C000,0x42C40000,0x1A501008,
+0x10024000,0xC80C2400,0x04080010,0x20041091,0x08000041,0x28CC0002,0x41900084,
+0x004C2148,0x11240408,0x00EA4081,0x00800052,0x40000090,0x0801C200,0x06080A03,
+0x81405481,0x00610425,0x04010000,0x29061800,0x28C58408,0x05018088,0xE0082000,
+0x91043000,0xA0400488,0x72002089,0x58002500,0x95091406,0x10028800,0x0000005A,
+0x06000600,0x01000200,0x02901003,0x00006400,0x08020010,0x00800042,0x20046400,
+0x40089005,0x00788881,0x82032C52,0xC00C4860,0x04800400,0x83081E09,0x80000000,
+0x22082404,0x88015500,0x00400612,0x41111028,0x20000020,0x21009000,0x4000C800,
+0x409B8035,0x38D20001,0x01009000,0x04140500,0x00484020,0x0ACC4080,0x0020848E,
+0x02060000,0x10803021,0x00460801,0xA2181180,0x0600C910,0x1088E000,0x00806060,
+0x0005400A,0x00092204,0x80918800,0x00C40004,0x60080100,0x80016002,0x10388508,
+0x00C20010,0x30091132,0x0C000010,0x0025842C,0x81019880,0x70005004,0x000000C4,
+0x80480400,0x1050A004,0x08001040,0x00002000,0x84110040,0x04000021,0x40000030,
+0x000C9400,0x01488000,0x8C004228,0x05190820,0x40280000,0x48188428,0x00049100,
+0x0D410400,0x0130F008,0x80424118,0x18014024,0x00900A20,0x0010210D,0x02220900,
+0x04012804,0x10110800,0x0C020010,0x00020120,0x10200000,0x29000004,0x1400A102,
+0x18000400,0x0401CA04,0x1109B021,0x00000C00,0x08280020,0x48205020,0x30410000,
+0x60040021,0xC1400000,0x10442080,0xC9013033,0x11218043,0x40100092,0x01024080,
+0x22020008,0x500410A1,0x00800000,0x04C00490,0x20800C00,0x30C00082,0x012013CB,
+0x02020024,0x02000200,0x35120022,0x01092012,0x40C00080,0x02281802,0x20183800,
+0x42B08000,0x04020A20,0x10151040,0x2A800804,0x70924488,0x48020304,0x14004010,
+0x0047000C,0x82806028,0x2000E020,0xA0500041,0x00400032,0x9104000A,0x4100C020,
+0x40254548,0x00000852,0x4104C022,0x95004010,0x03020019,0x2890220C,0xD4000082,
+0x2100000A,0x00040400,0x02090420,0x05202002,0x001082B0,0x00301118,0x00083020,
+0x610C4040,0x008440C4,0x00391002,0x8821C009,0x09200821,0x00900000,0x04220011,
+0x08000100,0x00203490,0x01400000,0x0824020D,0x20300218,0x61042120,0x81A08112,
+0x11000104,0x18021000,0x90155004,0x400A0140,0xA2080410,0x04000340,0x80000810,
+0x22914280,0x1808C401,0x00040000,0x0107000E,0x40000444,0x000AC400,0x81202220,
+0x22040880,0x093C5009,0x04001440,0x00315110,0x008200C2,0x08842008,0x44424000,
+0x04291900,0x04008480,0x22800A01,0x00002445,0x00004E18,0x40888106,0x11113848,
+0x04100080,0x80020022,0x10010020,0x20040804,0x08001460,0x041B8330,0x00042122,
+0x0204C00A,0x00000006,0x48002008,0x40842603,0x00004841,0x80000400,0x844C0044,
+0x0000C22E,0x01C01080,0x04061083,0xC0210A44,0x20021101,0x40840240,0x20845103,
+0x89008480,0x00810400,0x444018C0,0x2000408B,0x88062094,0x40028028,0x80020008,
+0x10141014,0x02042300,0x24882240,0x98100080,0x40101016,0x00804848,0x09002410,
+0x00810063,0x10480806,0x00000004,0x20800200,0x30440288,0x20C40006,0x20101A68,
+0x20001018,0x08414AE0,0x35200E04,0x1110E011,0x00308122,0x80012101,0x01401000,
+0x83000016,0x18882008,0x26449444,0x68408180,0x60027000,0x58000740,0x02001800,
+0x00002221,0x20060004,0xC4080000,0x25801921,0x01850814,0x20820001,0x00086008,
+0x04900084,0x00040002,0x400000CA,0x45002182,0x02046601,0x30988000,0x70400101,
+0x00002014,0x00800C01,0x08088204,0x00002A01,0x470100E4,0x00115040,0x04400403,
+0xC1806008,0x11380100,0x81000080,0x20809050,0x00401000,0x00101100,0x2C004824,
+0x00001000,0xA0000208,0x00444006,0x041A2000,0x02010202,0x2A054500,0x8010018A,
+0x80003100,0x80710201,0x206094A9,0x20801010,0x40000220,0x08B00500,0x40000023,
+0x00680006,0x70008005,0x0480410A,0x02448470,0x00804108,0x00910080,0x009C3412,
+0x40310040,0x64000803,0x00A10010,0x01248100,0x04884040,0x1D084081,0xB30051B0,
+0x001A4008,0x0800C088,0x11400E00,0x6020C081,0x08698520,0x00008648,0xE0201610,
+0x42BC3488,0x40018000,0x00058000,0x200010A2,0x11002082,0x001004A4,0x04031410,
+0x9026B001,0x00082280,0x000C0016,0x00012500,0x0C880020,0x70810140,0x00000C42,
+0x20004012,0x098C0322,0x0140C1C0,0x40480600,0x48080200,0x10000202,0x80044A00,
+0x000A0408,0x4C000804,0x10000400,0x44050008,0x01004003,0x94244220,0x24808020,
+0x80000008,0x80120001,0x90108C08,0x6000004A,0x30461006,0x0C00D824,0x211644C2,
+0x08090902,0x2000E000,0x0A08A484,0x03020018,0xD0810312,0x00602400,0x20480104,
+0xC040000A,0x00001040,0x080010A3,0x42040050,0xC0092005,0x10001081,0x20002024,
+0x00090680,0x80820200,0x0B100588,0x10C40000,0x20001780,0x01022809,0x9CA28004,
+0x51001880,0xC0314080,0x00102003,0x00102001,0x00090028,0x08020000,0x02114203,
+0x0210088F,0x00000440,0x00A80000,0x04103304,0x2000E500,0x90808061,0x80800004,
+0x03400104,0x81810548,0x08004020,0x32401302,0x4006190C,0x8201204E,0x20A00060,
+0x30100042,0x00040838,0x00200048,0x88009800,0xD0080280,0x0C250000,0x02402100,
+0x80460C40,0x090A0680,0x10002000,0x58800058,0x02084203,0x00029276,0x8B040C41,
+0xC1204328,0x24001602,0x01011800,0x00242000,0x002CC088,0x20148000,0x22850000,
+0x2103050E,0x00200010,0x00044820,0x00120040,0x20542004,0x08011884,0x00024081,
+0x00B00040,0x113C0403,0x40305C46,0x01001814,0x64008402,0x1200CA02,0x28090408,
+0x02508000,0x09908040,0x10000B43,0x0108C2A0,0x08000802,0x10020490,0xC0400045,
+0x60000090,0x05008000,0x08800005,0x1362042A,0x40000890,0x0000C420,0x00200003,
+0x400240A5,0x02001000,0x02020400,0x20000908,0x54810000,0x40120100,0x00032200,
+0x0000201D,0x00083531,0x908C0124,0x00801000,0x21801810,0x00818008,0x10008002,
+0xB220290C,0x00818810,0x301E0058,0x01180148,0x040000D4,0x00200090,0x20008004,
+0x21154043,0x1D044200,0x081C1884,0x080280A8,0x12008406,0x00100106,0x01A00008,
+0x63040080,0x6400302A,0x01040018,0x000240C0,0xC3903100,0xC0041100,0x10182289,
+0xAB401401,0x04620000,0x08810002,0x00010610,0x488C205C,0x1020C04C,0x01EA2800,
+0xC0001480,0x0012304A,0x0A088000,0x00244061,0x90220E80,0x041C0085,0x08000910,
+0x28008410,0x41880588,0x41000202,0x10020300,0x00405000,0xD1008009,0x10002401,
+0x10009801,0x00050502,0x0C180228,0x280480A2,0x08040063,0xA0040860,0x20200004,
+0x48082500,0x08000310,0x20124086,0x80100100,0x41008080,0x8E404100,0x80002400,
+0x00808820,0x82C00040,0x00090A21,0x10000000,0x00040702,0x40020200,0x50192120,
+0x09008840,0x44001010,0x0204008A,0xC8047000,0x20320400,0x10100802,0x60810001,
+0x10180404,0x1040A802,0x40440008,0x00000408,0x00020000,0x00801241,0x12000122,
+0x000A1010,0x1C00044C,0x10008140,0x0C484261,0x00CC0888,0x00000600,0x100088D0,
+0x20803000,0x90010001,0x000A0000,0x00508003,0x00222520,0x00000882,0x08808000,
+0x12002408,0x00089414,0x61121000,0x08920206,0x00020000,0x00412004,0x00080080,
+0x60400242,0x00002450,0x80001000,0x64C00006,0x18013202,0x00001900,0x02014042,
+0x0D000090,0x12412202,0x019CC80B,0x00500242,0x01010080,0x60040010,0x64007043,
+0x80904820,0x24180200,0x20004104,0x00000022,0x20232000,0x18002900,0x08A44050,
+0x628A08B0,0x0A011040,0x234002C0,0x00428000,0x80004080,0x00180280,0x200700C4,
+0x00040004,0x00004010,0x00800438,0x10828844,0x10022101,0x41100208,0x12082108,
+0x8802C005,0x21013142,0x40004009,0x8000C408,0x00020102,0x40004140,0x14800048,
+0x40000084,0x28010043,0x08044020,0x0044827A,0x01054126,0xA2030501,0x2C800202,
+0x20805108,0x10280180,0x0A000106,0x04400108,0x31121802,0x10200800,0x090D8834,
+0x0C000204,0x10811C04,0x81000140,0x00008018,0x08C10422,0x00005061,0x40801208,
+0x05624C18,0x00000432,0x40005108,0x000000C0,0x00118080,0x400000B0,0x12404450,
+0x01248088,0x05100000,0x08881309,0x80842585,0x40110000,0xA0100008,0x04012600,
+0x00408206,0x24011480,0x28504924,0x01089140,0x01866201,0x811C8242,0x48000088,
+0x0004C015,0x01010002,0x11020442,0x0430501D,0x01202840,0x201C1420,0x40110004,
+0x0004050A,0x30480100,0x00843148,0xA5840118,0x48080080,0x18000000,0x00045400,
+0x51100840,0x881A0060,0x01060041,0x10CB0220,0x01000020,0x08030410,0xC0000240,
+0x00020A25,0x60000041,0x41088040,0x08500000,0x0C043000,0x10801448,0x04144050,
+0x08010800,0x00040824,0x6800200C,0x0C0C0004,0x00200520,0x21130008,0x30803000,
+0xE3040299,0xA9444808,0x601196D2,0x1CE10819,0x05844080,0x40006020,0x10120800,
+0x23008080,0x00080404,0x00482331,0x10430000,0x0142012A,0x20080000,0x48004A08,
+0x09052002,0x00880861,0x48000082,0x0000A000,0x10000802,0x0CCA0020,0x90081002,
+0xC820C080,0x00100028,0x14800022,0x18900103,0x08406024,0x00A50060,0x230118D0,
+0x584000C0,0x2B316004,0x80480200,0x00000040,0x2AC00081,0xA1006004,0x008120C8,
+0x00340911,0x00444000,0x02880000,0x94901610,0x00400041,0x01100805,0x400E0280,
+0x71500100,0x04410482,0x00000000,0x00000089,0x22002003,0x0487C200,0x04011428,
+0xA0204110,0x8120E402,0x04010000,0x00011040,0x18000010,0x02023010,0x92940204,
+0x010A04A0,0xA0040040,0x0800C000,0x0050000C,0x30084268,0x29320102,0x01006200,
+0x04001030,0x200048C0,0x60400002,0x000041A0,0x00001408,0x04810834,0x62400082,
+0x01040080,0x42011200,0x002B000A,0x30480031,0x42104000,0x04400080,0x64890016,
+0x40006820,0x02048260,0x00010006,0x28804014,0x01120600,0x18080008,0xC40E0080,
+0x2E040028,0x00801908,0x80100034,0x01006004,0x00000024,0x0004104A,0x000A4310,
+0x00000000,0x008550A0,0x00010124,0x25001013,0xC1004A08,0x1E400042,0x000A00B0,
+0x0010120F,0x080CC050,0x84006048,0x00024211,0x11401006,0xA1404005,0x0B400101,
+0x61000022,0x0200442A,0x40018204,0x08509008,0x40120158,0x11400000,0x00000890,
+0xB8A0A840,0x00048040,0x0B017060,0x61004200,0x00010200,0x4A20C848,0x01041000,
+0x94100036,0x0420000C,0x4D090800,0x42001401,0x0080010A,0x40010408,0xA0020450,
+0x00211042,0x0028019A,0x01002009,0x10008C06,0x90152011,0x408A0008,0x8C0C0288,
+0x44040080,0x18818002,0x50000108,0x0A884000,0x0010D251,0x17002116,0x01407112,
+0x40480094,0x1A640418,0x02100400,0x12A01008,0x40200002,0x00200801,0x1002A041,
+0x408C0500,0x04042410,0x90001210,0x01040005,0x00020223,0x23040005,0x9A12C201,
+0x24001046,0x18015820,0x01000868,0x26050810,0x006A0A00,0x22043802,0x10008402,
+0x80010004,0x169B1402,0x08001040,0x08040010,0x84088200,0x01000000,0x00A41021,
+0x020C8975,0x02081000,0x10000048,0x01208604,0x04040202,0x88882080,0x00108400,
+0x08800101,0x80100000,0x29004280,0x02908000,0x50531890,0x8100A401,0x01402016,
+0x40009C68,0x10121280,0x08800020,0x04010112,0x000020C8,0x20008840,0x608C1820,
+0x8A020000,0x04153004,0x00404060,0x20000026,0x00000112,0x08101048,0x00441260,
+0x8082110A,0x02D20115,0x00102006,0x80400021,0x00820501,0x80400004,0x01004038,
+0x44000080,0x00435401,0x00240000,0x0F800001,0x14000642,0x2B480401,0x40044444,
+0x18892008,0x00110012,0x00040400,0x20022109,0x8000800B,0x28001201,0x00000034,
+0x00080000,0x00300001,0x00408000,0x00490085,0x0220A109,0x02880046,0x88028C06,
+0x00051080,0x000C4422,0x00108009,0x00200480,0x10000084,0x4000400A,0x020062A0,
+0x22101026,0x61101004,0x00006002,0x20180050,0x905B0288,0x80081000,0x0000100A,
+0x48410503,0x04211820,0x12158010,0x00800000,0x02040084,0x0118015C,0x00644000,
+0x8A440004,0xB3042841,0x8300C200,0x20102100,0x00420023,0x01341080,0x00208221,
+0x50020802,0x00412030,0x00047100,0x81200800,0x00C00001,0x03000088,0x0900C240,
+0x00A28080,0xC8000410,0x00030002,0x20820C40,0x00804800,0x48000040,0x94100038,
+0x800C5020,0x01020010,0x40002000,0x06018101,0x408780B0,0x41010000,0x01200024,
+0x48002001,0x88A09800,0x42006430,0x10200006,0x00040082,0xA1000025,0xAE100510,
+0x40020408,0x10003049,0x20001564,0x00802400,0x05000019,0x04448100,0x08600016,
+0x400404F0,0xCC041010,0x1220C012,0x01080148,0x20200140,0x00048001,0x08208505,
+0x02DC0641,0x20E0C0A0,0x84000004,0x08000402,0x020024B2,0x08890002,0x22000400,
+0xA2400004,0x90940438,0x90842801,0x01044008,0x40100C48,0xA0218007,0xD2180904,
+0x04000020,0x00140880,0x10B0A020,0x48012100,0x090044C5,0x08000050,0x24020802,
+0x202800A0,0x24104000,0xC8100640,0x4081A808,0x22886120,0x46840882,0x0C080010,
+0x00821214,0x602A2400,0x00602180,0x40820280,0x00004080,0x00000001,0x00140001,
+0x42040400,0x000081C2,0x20001880,0x0A000085,0x4024A200,0x00C01000,0x20C00484,
+0x20800000,0x0416804C,0x02A0C250,0x10402100,0x500A2001,0x02846C00,0x20080012,
+0x81804061,0x00C41040,0x20001440,0x21021200,0x800403A4,0x2B000026,0xC0005043,
+0x82102042,0x40004206,0x06884100,0x00000050,0x00104102,0x40001008,0x00085C40,
+0x811040C0,0x00090100,0x0200C044,0x01C01000,0x00800140,0x01000441,0x00004C11,
+0x04208030,0x0750008A,0x00200004,0x80C0D000,0x01803000,0x00401000,0x61004028,
+0x0600C640,0x0082440C,0x12428043,0x86004286,0x801061A2,0x20070000,0x0040800C,
+0x08109011,0x00000940,0x00858800,0x82304003,0x20C20800,0x00040321,0x39000782,
+0x01808020,0x800C0808,0x00120211,0x001A120C,0x20001400,0x21105480,0x04612160,
+0x01249820,0x80002028,0x10000104,0x0C022100,0x00001001,0xA4402481,0x82800903,
+0x00101000,0x30040000,0x00020021,0x02181000,0x00808008,0xA0200400,0x08811025,
+0x02000014,0xC5102000,0x28800811,0x02600120,0x463811A8,0xA0250084,0x204001A2,
+0x42000000,0x00040004,0x31002288,0x9811821C,0x02812030,0x65044244,0x80002208,
+0x24479682,0x24848000,0x9A002009,0x00048000,0x01100100,0x48120460,0x22001490,
+0x40009008,0x02804028,0x00040000,0x40001120,0x41300098,0x00082000,0x28008030,
+0x80001844,0x10000008,0x48000028,0x0A000840,0x00C10030,0x50A020CA,0x08204060,
+0x40040002,0x0A8DE910,0x00020044,0x4080C028,0x00008202,0x20001C81,0x24441880,
+0x00200088,0x0808401C,0x48300002,0x500C5018,0x020A0680,0x88000020,0x02200460,
+0xA1021003,0x07622210,0x50000600,0x902194C6,0x1008D001,0x48208A80,0x203E0522,
+0x14000040,0x25001000,0x0E010480,0x02011014,0x58101001,0x800020C2,0x40004480,
+0x94500808,0x00040000,0x80A2C221,0x400800C8,0x00001400,0x80241001,0x43000108,
+0x24230030,0x00010024,0x20728002,0x44000001,0x12020000,0x41018024,0x30404401,
+0x51A00844,0x01004080,0x20100020,0x00000A20,0x20000800,0x01880404,0x14082080,
+0x89010041,0x060250A2,0x000A0000,0x9A04A888,0x08234080,0x00892060,0x48000015,
+0x40060008,0x1191D088,0x06904085,0x00400402,0x51125100,0x00100100,0x0C104884,
+0x15100181,0x08002009,0x01004410,0x88018400,0x2C401001,0x09000082,0x08202008,
+0x20202440,0x214B0100,0x00040108,0x000001D4,0x00101003,0x80C00BA2,0x2200A08A,
+0x01108049,0x08085050,0x01800022,0x09000220,0x21104680,0x16100000,0x01008208,
+0x00682505,0x0081114A,0x54400B00,0x10140010,0x40400014,0x2800E000,0x04060200,
+0x000A0004,0x11080012,0x00006A08,0x82060680,0x24000014,0x04002082,0xA0180000,
+0x00200080,0x11182000,0x200002C3,0x80009004,0x00C00420,0x00218800,0x30020601,
+0x1008000C,0x01500110,0x150900A2,0x43042102,0x140C6082,0x8A004D00,0x00000044,
+0x204044A0,0x20048000,0x00200410,0x20812010,0x04004841,0x20042260,0x27012000,
+0x00000018,0x00040100,0x0028C200,0x80020003,0x2000120D,0x22803041,0x00000800,
+0x11204000,0x08013000,0x04000022,0x208910D0,0x04420260,0x00802440,0x68020500,
+0x88001001,0x00240201,0x00700262,0x089010A0,0x28098400,0x81041400,0x80008500,
+0x60000004,0x60065004,0x05342800,0x001B42F0,0x14050600,0x62200088,0x60088260,
+0x0440801C,0x00021159,0x94021001,0x40840008,0x04D0E010,0x05A58700,0x01080900,
+0xA8810103,0x41340292,0x4C10C01D,0x10101000,0x20104420,0x04000011,0x00000030,
+0x10000420,0x10840104,0x21200402,0x00280000,0x01011021,0x80000000,0x01120080,
+0x80404A08,0x13856408,0x9010410C,0x880A5000,0x04100040,0x12010020,0x4020C010,
+0x18004400,0x00209021,0x20240002,0x11E00042,0x03110080,0x4CE80008,0x00000001,
+0x29088020,0x442C0000,0x00092000,0x00008002,0x04012004,0x00040681,0xD0084800,
+0x050108A1,0x44112401,0x100C0980,0xC1800020,0x00004402,0x10024800,0x080040A0,
+0x28960124,0x2C500902,0x00809880,0x00180C04,0x01208010,0x01010040,0x0090A402,
+0x8A024000,0x0501401C,0x10062000,0x08880060,0x00340050,0x82020020,0x00910080,
+0x24009020,0x08000000,0x00000001,0x54008110,0x00230400,0x21000012,0x98208004,
+0x00610400,0x60000980,0x0800C000,0x41204002,0x00420140,0x48227400,0x38010004,
+0x44086180,0x80010040,0x00300E40,0x0C041020,0x08020088,0x00110010,0x84810448,
+0xA1100904,0x52000420,0x00014040,0x40401220,0x01021840,0x13118802,0x40502002,
+0x1D105150,0x144242A1,0x49000000,0xA0008102,0x01800040,0x00001901,0x08044050,
+0x8808081C,0x12150C00,0xA0480024,0x40042114,0x00090000,0x01100231,0x29A280B4,
+0x0034010A,0x0104C402,0x00804248,0x00840801,0x00000007,0x00880028,0x20600200,
+0x00518080,0xA00C0008,0xC0000040,0x80112188,0x60070800,0x20404000,0x05000080,
+0x8C000000,0x30900042,0x08028804,0x22400310,0x44000002,0x80028147,0x00A40082,
+0x00200500,0x44140105,0x88801001,0x08018800,0xC040284C,0xA420090E,0x01008380,
+0x0F004000,0x39042800,0xA8018258,0x00000000,0x81430008,0x10146A01,0x41801081,
+0x40230032,0x40000030,0x8000001F,0x846010A4,0x0409C100,0x00600030,0x004000BA,
+0x15600106,0x0A027001,0x20002010,0x82040100,0x45000400,0x00120C04,0x02048050,
+0x40490800,0x20100520,0x80206800,0x0460000C,0x03806010,0x02000000,0x01010002,
+0x0026C000,0x00821021,0x45202492,0x00200280,0x48008400,0x01609000,0x1020000C,
+0x00800028,0x40042000,0x00410008,0x640400A8,0x08002008,0x10100000,0x00050101,
+0x1048E020,0x00000432,0x04020420,0x00800000,0x02142083,0x88A80000,0x28609100,
+0x20000140,0x00480011,0x88008004,0xAC400900,0x2A000030,0x00811072,0x4701104A,
+0x0808AA09,0x06204412,0x50800000,0x46004510,0x00000A18,0x00108020,0x68001000,
+0x03004011,0x82100448,0x1001841E,0x54040891,0x18200528,0xA4110400,0x30400040,
+0x0E602904,0x000004C0,0x00580100,0x1484083A,0x328041C0,0x02014002,0x9C100420,
+0x12006020,0x01800070,0x2004800C,0x20844819,0x04814010,0x00804004,0x0080010C,
+0x80004C00,0x10108002,0x04040000,0x00026109,0x08000010,0x00801248,0x61800CD0,
+0x18004000,0x28022092,0x20000000,0x10C40050,0x10002000,0x04034390,0x00401040,
+0xA8088800,0x00261001,0x00800204,0x00000008,0x08014260,0x2004C800,0x640402A6,
+0x04280108,0x08400200,0x00000410,0x02063220,0x00100011,0x59850200,0x8D000120,
+0x14006100,0x40200000,0x38800200,0x18100C40,0x00062082,0x00200008,0x1A014500,
+0x08C80402,0x00004800,0x00990101,0x08210112,0x24248026,0x01000000,0x00884000,
+0x49001130,0x10C10801,0x00000081,0x02084080,0x04300088,0x60070106,0x08010301,
+0x001C0202,0x00804400,0x00000200,0x514001A0,0x00140800,0x08000011,0x00810046,
+0x08000040,0x05A00AC0,0x4A000400,0x13000503,0x040028AA,0x085100C0,0x00124110,
+0x0002000A,0x01000804,0x08580200,0x80008008,0x00100000,0x60140028,0x608C4280,
+0x00012108,0x01850405,0x04002089,0x80044888,0xC0609000,0x10200108,0x08440022,
+0x44081012,0x40110400,0x48800611,0x84A02024,0x26002500,0x84208802,0x00000103,
+0x05882200,0xA0093081,0x14084000,0x02811600,0x20501000,0xC0403054,0x00150480,
+0x0000AA0C,0x00008400,0x33004300,0x00800048,0x80080485,0x0400C120,0x41004143,
+0x51101000,0x04300005,0x40018020,0x40401010,0x0406B000,0x00848100,0x42282404,
+0x6000140A,0xA004A006,0x40004000,0x30100A10,0x00088404,0x00080221,0x00000000,
+0x04420011,0x00008626,0xB0100880,0x1920E400,0x02089000,0x00010026,0x00046080,
+0xC900A020,0x0418C000,0x020084F0,0x10244000,0x11810000,0x0C008810,0x00000C66,
+0x02041066,0x00400621,0x90020004,0x04505000,0x90840020,0x0210A511,0x801A2000,
+0x80084202,0x10084801,0x0C00C000,0x00301400,0x02410000,0x20804800,0x08180084,
+0x00600110,0x10202880,0xC020D002,0x00180100,0x24010020,0x00044041,0x00906061,
+0x0029028A,0x20088000,0x05005014,0x40041101,0x02EC8288,0xC2012044,0x08008100,
+0x11590001,0x33821800,0x8500A000,0x0C20C148,0x051018C0,0x21001100,0x09005C00,
+0x40082A40,0x60065880,0x08002000,0x02000200,0x05080048,0x00420840,0x120A3014,
+0x80042200,0x10C28000,0x00880361,0x01481005,0x64000000,0x06019408,0x0010B144,
+0x84010480,0x00884001,0x02140006,0x888A0021,0x00690088,0x00801000,0x00108012,
+0x74000000,0x80291800,0x00040002,0x4C424000,0x1A000500,0x09008002,0x00902150,
+0x00014050,0x08100810,0x4C001104,0x22022118,0x00080000,0x08081004,0x41901011,
+0x6A842023,0x0108A088,0x14201000,0x00442234,0x03160408,0x80120097,0x0D000800,
+0x040300C8,0x08C0A020,0x2C004094,0x00009209,0x40210810,0x81060A8B,0x45A020E0,
+0x02004024,0x02032580,0x04020020,0x68040200,0x00110150,0x282530C4,0x20938810,
+0x0618C000,0x00084002,0x08053008,0x80001C00,0x10A00000,0x00018100,0x0C018484,
+0x82000908,0x10418204,0x90019810,0x10920000,0x10400063,0x82011010,0x0080100C,
+0x20080000,0x01091523,0x2030C080,0x00004002,0x00400402,0x29890312,0x00084042,
+0x04804000,0x0400000C,0x20220000,0x35500014,0x24202048,0x00258908,0x24000030,
+0x01005302,0x02060240,0x84240D00,0x0004840D,0x0002CC09,0x40201000,0x81300114,
+0x000204A0,0x60012814,0xC224A080,0x0550400B,0x60045060,0x43603400,0x802C0840,
+0x01820081,0x90212000,0xC0185403,0x1208128B,0xC0400022,0x02060100,0x405801A0,
+0x049C21C4,0x19508020,0x140C0040,0x00040310,0x00000050,0xC00C8614,0x00308200,
+0x00008480,0x21310200,0x41081208,0x40002904,0x00140002,0x00860404,0x18040400,
+0x820000A0,0x00010002,0x80800011,0x1A104000,0x90080298,0x4401811C,0x12102005,
+0x65000400,0x00300800,0xA0040804,0x7000090A,0x08002094,0x02004020,0x03040003,
+0x20440002,0x81108005,0x44400000,0x28041002};
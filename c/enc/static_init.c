@@ -23,7 +23,8 @@ extern "C" {
 static BROTLI_BOOL DoBrotliEncoderStaticInit(void) {
   const BrotliDictionary* dict = BrotliGetDictionary();
   BROTLI_BOOL ok = BrotliEncoderInitStaticDictionaryLut(
-      dict, kStaticDictionaryBuckets, kStaticDictionaryWords);
+      dict, kStaticDictionaryBuckets, kStaticDictionaryWords,
+      kStaticDictionaryFilter);
   if (!ok) return BROTLI_FALSE;
   ok = BrotliEncoderInitDictionaryHash(dict, kStaticDictionaryHashWords,
                                        kStaticDictionaryHashLengths);
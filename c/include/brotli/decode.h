@@ -176,6 +176,29 @@ BROTLI_DEC_API BROTLI_BOOL BrotliDecoderAttachDictionary(
     BrotliDecoderState* state, BrotliSharedDictionaryType type,
     size_t data_size, const uint8_t data[BROTLI_ARRAY_PARAM(data_size)]);
 
+/**
+ * Attaches all dictionaries of an already populated ::BrotliSharedDictionary.
+ *
+ * Unlike ::BrotliDecoderAttachDictionary, nothing is parsed, copied or
+ * allocated: decoder refers to word lists, transforms and LZ77 prefixes of
+ * @p dictionary. This way the same (e.g. memory-mapped) serialized dictionary
+ * is parsed once with ::BrotliSharedDictionaryAttach and then cheaply used by
+ * any number of decoders.
+ *
+ * @p dictionary and data attached to it should be kept accessible and
+ * unmodified until decoder instance is destroyed.
+ *
+ * @note Dictionaries can NOT be attached after actual decoding is started.
+ *
+ * @param state decoder instance
+ * @param dictionary populated shared dictionary instance
+ * @returns ::BROTLI_FALSE if dictionary count limit is reached, or custom
+ *          static dictionary is already attached
+ * @returns ::BROTLI_TRUE if dictionary is accepted / attached
+ */
+BROTLI_DEC_API BROTLI_BOOL BrotliDecoderAttachSharedDictionary(
+    BrotliDecoderState* state, const BrotliSharedDictionary* dictionary);
+
 /**
  * Creates an instance of ::BrotliDecoderState and initializes it.
  *
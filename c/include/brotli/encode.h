@@ -260,8 +260,25 @@ typedef enum BrotliEncoderParameter {
    *
    * Controls whether the encoder uses SIMD hashers.
    * See ::BrotliEncoderSimdHasher for options.
+   *
+   * SIMD hashers find exactly the same matches as their scalar counterparts,
+   * so this setting affects only speed; produced stream is byte-identical.
+   */
+  BROTLI_PARAM_SIMD_HASHER = 12,
+  /**
+   * Flag that enables per-stream selection of raw (LZ77) dictionary.
+   *
+   * When set, encoder inspects the first few KiB of input (or less, if stream
+   * is flushed earlier) and then looks for matches only in the attached raw
+   * dictionary (or a prefix of attached serialized dictionary) that covers it
+   * best; if none does, dictionaries are not searched at all. This saves
+   * hasher time when dictionaries for different kinds of content are
+   * attached.
+   *
+   * Decoder still @b MUST have all the same dictionaries attached in the same
+   * order, as skipped ones keep their place in the distance space.
    */
-  BROTLI_PARAM_SIMD_HASHER = 12
+  BROTLI_PARAM_DICTIONARY_SELECTION = 13
 } BrotliEncoderParameter;
 
 /**
@@ -313,6 +330,26 @@ BROTLI_ENC_API BrotliEncoderState* BrotliEncoderCreateInstance(
  */
 BROTLI_ENC_API void BrotliEncoderDestroyInstance(BrotliEncoderState* state);
 
+/**
+ * Resets ::BrotliEncoderState instance to the state right after creation.
+ *
+ * Parameters are set to default values, attached dictionaries are detached
+ * and callbacks (see ::BrotliEncoderSetDictionaryReferenceCallback and
+ * ::BrotliEncoderSetStageCallback) are cleared, as in a new instance; they
+ * should be set again for the next stream, if needed. Allocated memory (ring
+ * buffer, hash tables, output storage) is kept and reused by the next stream,
+ * which makes compression of many small inputs with the same instance cheaper
+ * than creating a new instance for each of them. On the other hand, memory
+ * used by the biggest of the streams is not released until the instance is
+ * destroyed.
+ *
+ * @param state encoder instance to be reset
+ * @returns ::BROTLI_FALSE if instance is not usable anymore (e.g. memory
+ *          allocation failed); it should be destroyed
+ * @returns ::BROTLI_TRUE otherwise
+ */
+BROTLI_ENC_API BROTLI_BOOL BrotliEncoderReset(BrotliEncoderState* state);
+
 /* Opaque type for pointer to different possible internal structures containing
    dictionary prepared for the encoder */
 typedef struct BrotliEncoderPreparedDictionaryStruct
@@ -345,6 +382,41 @@ BrotliEncoderPrepareDictionary(BrotliSharedDictionaryType type,
     int quality,
     brotli_alloc_func alloc_func, brotli_free_func free_func, void* opaque);
 
+/**
+ * Same as ::BrotliEncoderPrepareDictionary, but uses lookup structures
+ * stored in @p cache instead of building them.
+ *
+ * Only ::BROTLI_SHARED_DICTIONARY_SERIALIZED type is supported. Words LUT,
+ * hash tables and the trie for custom transforms are used in place, so
+ * preparing a dictionary this way is cheap both in time and memory.
+ *
+ * Serialized dictionaries are only supported if library is built with
+ * @c BROTLI_EXPERIMENTAL defined; otherwise this function always fails.
+ *
+ * @warning @p cache @b MUST be 4-byte aligned and, as well as @p data,
+ *          @b MUST outlive the created instance.
+ *
+ * @param type type of dictionary stored in data
+ * @param data_size size of @p data buffer
+ * @param data pointer to the dictionary data
+ * @param cache_size size of @p cache buffer
+ * @param cache output of ::BrotliEncoderSerializePreparedDictionary for
+ *        dictionary prepared from the same @p data
+ * @param quality the maximum Brotli quality to prepare the dictionary for;
+ *        @b MUST NOT exceed the quality @p cache was prepared for
+ * @param alloc_func custom memory allocation function
+ * @param free_func custom memory free function
+ * @param opaque custom memory manager handle
+ * @returns @c NULL if @p cache is malformed or does not match @p data, or if
+ *          serialized dictionaries are not supported
+ */
+BROTLI_ENC_API BrotliEncoderPreparedDictionary*
+BrotliEncoderPrepareDictionaryWithCache(BrotliSharedDictionaryType type,
+    size_t data_size, const uint8_t data[BROTLI_ARRAY_PARAM(data_size)],
+    size_t cache_size, const uint8_t cache[BROTLI_ARRAY_PARAM(cache_size)],
+    int quality,
+    brotli_alloc_func alloc_func, brotli_free_func free_func, void* opaque);
+
 BROTLI_ENC_API void BrotliEncoderDestroyPreparedDictionary(
     BrotliEncoderPreparedDictionary* dictionary);
 
@@ -362,6 +434,129 @@ BROTLI_ENC_API BROTLI_BOOL BrotliEncoderAttachPreparedDictionary(
     BrotliEncoderState* state,
     const BrotliEncoderPreparedDictionary* dictionary);
 
+/**
+ * Serializes a raw prepared dictionary into a self-contained form.
+ *
+ * Serialized form contains both the lookup structures and a copy of the
+ * dictionary data. It could be stored once, and then used in place by any
+ * number of processes with ::BrotliEncoderLoadPreparedDictionaryFromMemory,
+ * e.g. after mapping the file to memory. Format uses the native byte order;
+ * dictionaries produced by Java @c PreparedDictionaryGenerator (that use
+ * older index layout) are accepted as well.
+ *
+ * Dictionary prepared with ::BROTLI_SHARED_DICTIONARY_SERIALIZED type is
+ * serialized as a cache of its lookup structures instead; it does not contain
+ * the dictionary data and is only usable with
+ * ::BrotliEncoderPrepareDictionaryWithCache. In that case @p buffer @b MUST be
+ * 4-byte aligned.
+ *
+ * @param dictionary dictionary prepared with ::BROTLI_SHARED_DICTIONARY_RAW
+ *        or ::BROTLI_SHARED_DICTIONARY_SERIALIZED type
+ * @param[in, out] buffer_size @b in: size of @p buffer; \n
+ *                 @b out: size of serialized dictionary, or @c 0 if
+ *                 dictionary could not be serialized
+ * @param buffer output buffer, could be @c NULL if @p buffer_size is @c 0
+ * @returns ::BROTLI_FALSE if dictionary could not be serialized, or @p buffer
+ *          is too small (then @p buffer_size is set to the required size)
+ * @returns ::BROTLI_TRUE otherwise
+ */
+BROTLI_ENC_API BROTLI_BOOL BrotliEncoderSerializePreparedDictionary(
+    const BrotliEncoderPreparedDictionary* dictionary, size_t* buffer_size,
+    uint8_t* buffer);
+
+/**
+ * Validates a serialized prepared dictionary and wraps it for use in place.
+ *
+ * Nothing is copied or allocated: the result points into @p data.
+ *
+ * @warning @p data @b MUST be 4-byte aligned and @b MUST outlive the result;
+ *          the result @b MUST NOT be passed to
+ *          ::BrotliEncoderDestroyPreparedDictionary.
+ *
+ * @param data_size size of @p data buffer
+ * @param data output of ::BrotliEncoderSerializePreparedDictionary
+ * @returns @c NULL if @p data is not a valid serialized dictionary
+ * @returns dictionary that could be used with
+ *          ::BrotliEncoderAttachPreparedDictionary otherwise
+ */
+BROTLI_ENC_API const BrotliEncoderPreparedDictionary*
+BrotliEncoderLoadPreparedDictionaryFromMemory(size_t data_size,
+    const uint8_t data[BROTLI_ARRAY_PARAM(data_size)]);
+
+/**
+ * Callback to fire on backward reference to attached raw dictionaries.
+ *
+ * Offset is counted in the concatenation of raw dictionaries, in the order
+ * they were attached. Callback is fired when meta-block is produced; in rare
+ * cases encoder might decide to store that meta-block uncompressed afterwards.
+ *
+ * @param opaque callback handle
+ * @param offset position of the first referenced dictionary byte
+ * @param length number of referenced bytes
+ */
+typedef void (*brotli_encoder_dictionary_reference_func)(
+    void* opaque, size_t offset, size_t length);
+
+/**
+ * Sets callback for observing references to attached raw dictionaries.
+ *
+ * Useful for estimating dictionary effectiveness, e.g. to find dictionary
+ * regions that are never referenced. Note that the lowest qualities do not
+ * use attached dictionaries at all.
+ *
+ * @param state encoder instance
+ * @param func callback on dictionary reference, or @c NULL to disable
+ * @param opaque callback handle
+ */
+BROTLI_ENC_API void BrotliEncoderSetDictionaryReferenceCallback(
+    BrotliEncoderState* state, brotli_encoder_dictionary_reference_func func,
+    void* opaque);
+
+/** Encoder work stages, see ::BrotliEncoderSetStageCallback. */
+typedef enum BrotliEncoderStage {
+  /** Encoder is not working, i.e. control is returned to the caller. */
+  BROTLI_ENCODER_STAGE_IDLE = 0,
+  /**
+   * Search of backward references (hashing, LZ77 matching), including
+   * allocation of command buffers and hash tables for it.
+   *
+   * Qualities 0 and 1 compress in a single pass; all work is reported as
+   * this stage.
+   */
+  BROTLI_ENCODER_STAGE_MATCHING = 1,
+  /** Block splitting, context modeling and histogram clustering. */
+  BROTLI_ENCODER_STAGE_BLOCK_SPLITTING = 2,
+  /** Building prefix codes and writing meta-block. */
+  BROTLI_ENCODER_STAGE_ENTROPY_CODING = 3
+} BrotliEncoderStage;
+
+/**
+ * Callback to fire when encoder enters a work stage.
+ *
+ * Stage lasts until the next callback. Callback is fired on encoder thread;
+ * it should be cheap, as it is invoked several times per meta-block.
+ *
+ * @param opaque callback handle
+ * @param stage stage that starts now
+ */
+typedef void (*brotli_encoder_stage_func)(
+    void* opaque, BrotliEncoderStage stage);
+
+/**
+ * Sets callback for observing encoder work stages.
+ *
+ * Useful for profiling, e.g. to find out how much time is spent in each
+ * stage. Encoder itself does not measure time. Copying input into the
+ * encoder window (and its allocation) and output to the caller is done in
+ * ::BROTLI_ENCODER_STAGE_IDLE stage.
+ *
+ * @param state encoder instance
+ * @param func callback on stage change, or @c NULL to disable
+ * @param opaque callback handle
+ */
+BROTLI_ENC_API void BrotliEncoderSetStageCallback(
+    BrotliEncoderState* state, brotli_encoder_stage_func func, void* opaque);
+
 /**
  * Calculates the output size bound for the given @p input_size.
  *
@@ -6,6 +6,12 @@
 
 /* Command line interface for Brotli library. */
 
+/* Use 64-bit off_t, so that fseeko / ftello reach beyond 2GiB on 32-bit
+   platforms. */
+#if !defined(_WIN32) && !defined(_FILE_OFFSET_BITS)
+#define _FILE_OFFSET_BITS 64
+#endif
+
 /* Mute strerror/strcpy warnings. */
 #include <brotli/shared_dictionary.h>
 #if !defined(_CRT_SECURE_NO_WARNINGS)
@@ -14,6 +20,7 @@
 
 #include <errno.h>
 #include <fcntl.h>
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -26,11 +33,13 @@
 #include "../common/version.h"
 #include <brotli/decode.h>
 #include <brotli/encode.h>
+#include "dictionary_generator.h"
 
 #if defined(_WIN32)
 #include <io.h>
 #include <share.h>
 #include <sys/utime.h>
+#include <windows.h>
 
 #define MAKE_BINARY(FILENO) (_setmode((FILENO), _O_BINARY), (FILENO))
 
@@ -70,11 +79,59 @@ static int ms_open(const char* filename, int oflag, int pmode) {
   return result;
 }
 #else  /* !defined(_WIN32) */
+#include <dirent.h>
 #include <unistd.h>
 #include <utime.h>
 #define MAKE_BINARY(FILENO) (FILENO)
 #endif  /* defined(_WIN32) */
 
+#if defined(_WIN32) || defined(__EMSCRIPTEN__)
+#define HAVE_MMAP 0
+#else
+#include <sys/mman.h>
+#define HAVE_MMAP 1
+#endif
+
+#if defined(_WIN32)
+#define HAVE_THREADS 1
+#elif defined(__EMSCRIPTEN__)
+#define HAVE_THREADS 0
+#else
+#include <pthread.h>
+#define HAVE_THREADS 1
+#endif
+
+#if defined(_WIN32) || defined(__EMSCRIPTEN__)
+#define HAVE_GETRUSAGE 0
+#else
+#include <sys/resource.h>
+#define HAVE_GETRUSAGE 1
+#endif
+
+/* Time stamp counter is used to report cycles per byte in benchmark mode. */
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define HAVE_CYCLE_COUNTER 1
+#define READ_CYCLE_COUNTER() ((uint64_t)__rdtsc())
+#elif (defined(__GNUC__) || defined(__clang__)) && \
+    (defined(__x86_64__) || defined(__i386__))
+#define HAVE_CYCLE_COUNTER 1
+#define READ_CYCLE_COUNTER() ((uint64_t)__builtin_ia32_rdtsc())
+#else
+#define HAVE_CYCLE_COUNTER 0
+#define READ_CYCLE_COUNTER() ((uint64_t)0)
+#endif
+
+#if defined(_WIN32)
+#define HAVE_FSEEKO 0
+#elif defined(_POSIX_C_SOURCE) && (_POSIX_C_SOURCE >= 200112L)
+#define HAVE_FSEEKO 1
+#elif defined(_LARGEFILE_SOURCE) || defined(__APPLE__)
+#define HAVE_FSEEKO 1
+#else
+#define HAVE_FSEEKO 0
+#endif
+
 #if defined(_POSIX_C_SOURCE) && (_POSIX_C_SOURCE >= 200809L)
 #define HAVE_UTIMENSAT 1
 #elif defined(_ATFILE_SOURCE)
@@ -94,12 +151,15 @@ static int ms_open(const char* filename, int oflag, int pmode) {
 #endif  /* HAVE_UTIMENSAT */
 
 typedef enum {
+  COMMAND_ANALYZE,
+  COMMAND_BENCH,
   COMMAND_COMPRESS,
   COMMAND_DECOMPRESS,
   COMMAND_HELP,
   COMMAND_INVALID,
   COMMAND_TEST_INTEGRITY,
   COMMAND_NOOP,
+  COMMAND_TRAIN,
   COMMAND_VERSION
 } Command;
 
@@ -114,11 +174,44 @@ typedef enum {
 #define DEFAULT_SUFFIX ".br"
 #define MAX_OPTIONS 24
 #define MAX_COMMENT_LEN 80
+#define DEFAULT_MAX_DICTIONARY_SIZE (16 << 10)
+#define DICTIONARY_SLICE_LEN 16
+#define MAX_THREADS 256
+/* Upper limit of input chunk size for multi-threaded compression. */
+#define MAX_CHUNK_LGSIZE 24
+/* Chunk sizes for --seekable; compressed chunk size should fit 32 bits. */
+#define DEFAULT_SEEKABLE_CHUNK_SIZE (1 << 20)
+#define MIN_SEEKABLE_CHUNK_SIZE (1 << 10)
+#define MAX_SEEKABLE_CHUNK_SIZE (1 << 30)
+
+#define NUM_ENCODER_STAGES 4
+/* Time spent in encoder stages, see BrotliEncoderSetStageCallback. */
+typedef struct StageTimer {
+  BrotliEncoderStage stage;
+  double stage_start_time;
+  double times[NUM_ENCODER_STAGES];  /* Seconds, indexed by stage. */
+} StageTimer;
+
+typedef struct SparseState {
+  uint64_t offset;  /* Output size so far. */
+  uint64_t hole;  /* Size of skipped zero blocks, not yet seeked over. */
+} SparseState;
 
 typedef struct {
   /* Parameters */
   int quality;
   int lgwin;
+  int simd_hasher;  /* -1, if not set */
+  int threads;
+  /* -T is set; input bigger than chunk is compressed in chunks, even with
+     a single thread, so that output does not depend on the thread count. */
+  BROTLI_BOOL split_input;
+  BROTLI_BOOL in_worker;  /* File is processed by one of parallel workers. */
+  size_t max_dictionary_size;  /* for --train */
+  BROTLI_BOOL shared_dictionary;  /* for --train */
+  int bench_quality_min;  /* for --bench */
+  int bench_quality_max;  /* for --bench */
+  int bench_lgwin_max;  /* for --bench; lgwin is the lower bound */
   int verbosity;
   BROTLI_BOOL force_overwrite;
   BROTLI_BOOL junk_source;
@@ -127,8 +220,14 @@ typedef struct {
   BROTLI_BOOL write_to_stdout;
   BROTLI_BOOL test_integrity;
   BROTLI_BOOL decompress;
+  BROTLI_BOOL decode;  /* Input is decoded: -d or -t. */
   BROTLI_BOOL large_window;
   BROTLI_BOOL allow_concatenated;
+  BROTLI_BOOL recursive;
+  size_t seekable_chunk_size;  /* 0, if output is not seekable */
+  BROTLI_BOOL range_set;  /* for --range */
+  uint64_t range_offset;
+  uint64_t range_length;
   const char* output_path;
   const char* dictionary_path;
   const char* suffix;
@@ -145,26 +244,40 @@ typedef struct {
   char** argv;
   uint8_t* dictionary;
   size_t dictionary_size;
+  BrotliSharedDictionaryType dictionary_type;
   BrotliEncoderPreparedDictionary* prepared_dictionary;
+  /* Reused for all files (see BrotliEncoderReset). */
+  BrotliEncoderState* encoder;
   BrotliDecoderState* decoder;
   char* modified_path;  /* Storage for path with appended / cut suffix */
   int iterator;
   int ignore;
   BROTLI_BOOL iterator_error;
+  /* Input files found in directories with -r; NULL if not expanded. */
+  char** file_list;
+  size_t file_list_size;
   uint8_t* buffer;
   uint8_t* input;
-  uint8_t* output;
   const char* current_input_path;
   const char* current_output_path;
   int64_t input_file_length;  /* -1, if impossible to calculate */
+  /* Input ends with seekable index; it is a sequence of streams. */
+  BROTLI_BOOL seekable_input;
   FILE* fin;
   FILE* fout;
+  /* Whole input file, if it is memory-mapped. */
+  const uint8_t* mapped_input;
+  size_t mapped_input_size;
+  BROTLI_BOOL mapped_input_eof;
+  /* NULL, if I/O is synchronous. */
+  struct AsyncIo* async_io;
+  /* Zero blocks of output are skipped, see WriteFileData. */
+  BROTLI_BOOL sparse_output;
+  SparseState sparse;
 
   /* I/O buffers */
   size_t available_in;
   const uint8_t* next_in;
-  size_t available_out;
-  uint8_t* next_out;
 
   /* Reporting */
   /* size_t would be large enough,
@@ -173,6 +286,12 @@ typedef struct {
   size_t total_out;
   clock_t start_time;
   clock_t end_time;
+  /* Telemetry for verbose mode. */
+  double wall_start_time;
+  double progress_time;  /* Last progress report. */
+  StageTimer stage_timer;
+  /* Chunks are compressed in parallel; stage times are summed. */
+  BROTLI_BOOL parallel_stages;
 } Context;
 
 /* Parse base 64 encoded string to buffer. Not performance-centric.
@@ -242,6 +361,112 @@ static BROTLI_BOOL ParseInt(const char* s, int low, int high, int* result) {
   return BROTLI_TRUE;
 }
 
+/* Parse up to 9 decimal digits with optional k/K/m/M suffix. */
+static BROTLI_BOOL ParseSize(const char* s, size_t low, size_t high,
+                             size_t* result) {
+  size_t value = 0;
+  int i;
+  for (i = 0; i < 9; ++i) {
+    char c = s[i];
+    if (c < '0' || c > '9') break;
+    value = (10 * value) + (size_t)(c - '0');
+  }
+  if (i == 0) return BROTLI_FALSE;
+  if (i > 1 && s[0] == '0') return BROTLI_FALSE;
+  if (s[i] == 'k' || s[i] == 'K') {
+    if (value > (high >> 10)) return BROTLI_FALSE;
+    value <<= 10;
+    i++;
+  } else if (s[i] == 'm' || s[i] == 'M') {
+    if (value > (high >> 20)) return BROTLI_FALSE;
+    value <<= 20;
+    i++;
+  }
+  if (s[i] != 0) return BROTLI_FALSE;
+  if (value < low || value > high) return BROTLI_FALSE;
+  *result = value;
+  return BROTLI_TRUE;
+}
+
+/* Parse up to 18 decimal digits with optional k/K/m/M/g/G suffix. */
+static BROTLI_BOOL ParseOffset(const char* s, uint64_t* result) {
+  uint64_t value = 0;
+  int shift = 0;
+  int i;
+  for (i = 0; i < 18; ++i) {
+    char c = s[i];
+    if (c < '0' || c > '9') break;
+    value = (10 * value) + (uint64_t)(c - '0');
+  }
+  if (i == 0) return BROTLI_FALSE;
+  if (i > 1 && s[0] == '0') return BROTLI_FALSE;
+  if (s[i] == 'k' || s[i] == 'K') {
+    shift = 10;
+  } else if (s[i] == 'm' || s[i] == 'M') {
+    shift = 20;
+  } else if (s[i] == 'g' || s[i] == 'G') {
+    shift = 30;
+  }
+  if (shift != 0) {
+    if (value > (((uint64_t)1 << 62) >> shift)) return BROTLI_FALSE;
+    value <<= shift;
+    i++;
+  }
+  if (s[i] != 0) return BROTLI_FALSE;
+  *result = value;
+  return BROTLI_TRUE;
+}
+
+/* Parse "OFF:LEN" range. */
+static BROTLI_BOOL ParseRange(const char* s, uint64_t* offset,
+                              uint64_t* length) {
+  char first[20];
+  const char* colon = strchr(s, ':');
+  size_t len = colon ? (size_t)(colon - s) : 0;
+  if (len == 0 || len >= sizeof(first)) return BROTLI_FALSE;
+  memcpy(first, s, len);
+  first[len] = 0;
+  return TO_BROTLI_BOOL(ParseOffset(first, offset) &&
+                        ParseOffset(colon + 1, length));
+}
+
+/* Parse "NUM" or "NUM-NUM" range (quality or window size). */
+static BROTLI_BOOL ParseIntRange(const char* s, int low_limit,
+                                 int high_limit, int* low, int* high) {
+  char first[6];
+  const char* dash = strchr(s, '-');
+  size_t len = dash ? (size_t)(dash - s) : strlen(s);
+  if (len == 0 || len >= sizeof(first)) return BROTLI_FALSE;
+  memcpy(first, s, len);
+  first[len] = 0;
+  if (!ParseInt(first, low_limit, high_limit, low)) return BROTLI_FALSE;
+  if (!dash) {
+    *high = *low;
+    return BROTLI_TRUE;
+  }
+  return ParseInt(dash + 1, *low, high_limit, high);
+}
+
+/* Parses -w / --lgwin value; range is accepted for benchmark only, and
+   0 ("chosen by compressor") can not be a part of a range. */
+static BROTLI_BOOL ParseLgwin(const char* s, Context* params) {
+  if (!ParseIntRange(s, 0, BROTLI_MAX_WINDOW_BITS,
+                     &params->lgwin, &params->bench_lgwin_max)) {
+    fprintf(stderr, "error parsing lgwin value [%s]\n", s);
+    return BROTLI_FALSE;
+  }
+  if (params->lgwin != 0 && params->lgwin < BROTLI_MIN_WINDOW_BITS) {
+    fprintf(stderr, "lgwin parameter (%d) smaller than the minimum (%d)\n",
+            params->lgwin, BROTLI_MIN_WINDOW_BITS);
+    return BROTLI_FALSE;
+  }
+  if (params->lgwin == 0 && params->bench_lgwin_max != 0) {
+    fprintf(stderr, "lgwin range can not start with 0\n");
+    return BROTLI_FALSE;
+  }
+  return BROTLI_TRUE;
+}
+
 /* Returns "base file name" or its tail, if it contains '/' or '\'. */
 static const char* FileName(const char* path) {
   const char* separator_position = strrchr(path, '/');
@@ -281,6 +506,10 @@ static Command ParseParams(Context* params) {
   BROTLI_BOOL after_dash_dash = BROTLI_FALSE;
   BROTLI_BOOL comment_set = BROTLI_FALSE;
   BROTLI_BOOL concatenated_set = BROTLI_FALSE;
+  BROTLI_BOOL maxdict_set = BROTLI_FALSE;
+  BROTLI_BOOL threads_set = BROTLI_FALSE;
+  BROTLI_BOOL bench_range_set = BROTLI_FALSE;
+  BROTLI_BOOL seekable_set = BROTLI_FALSE;
   Command command = COMMAND_COMPRESS;
 
   if (CheckAlias(argv[0], "brcat")) {
@@ -307,7 +536,8 @@ static Command ParseParams(Context* params) {
     }
 
     /* Too many options. The expected longest option list is:
-       "-q 0 -w 10 -o f -D d -S b -d -f -k -n -v -K --", i.e. 17 items in total.
+       "-q 0 -w 10 -o f -D d -S b -T 2 -d -f -k -n -v -K --", i.e. 19 items in
+       total.
        This check is an additional guard that is never triggered, but provides
        a guard for future changes. */
     if (next_option_index > (MAX_OPTIONS - 2)) {
@@ -385,6 +615,13 @@ static Command ParseParams(Context* params) {
           }
           params->copy_stat = BROTLI_FALSE;
           continue;
+        } else if (c == 'r') {
+          if (params->recursive) {
+            fprintf(stderr, "argument --recursive / -r already set\n");
+            return COMMAND_INVALID;
+          }
+          params->recursive = BROTLI_TRUE;
+          continue;
         } else if (c == 's') {
           if (squash_set) {
             fprintf(stderr, "argument --squash / -s already set\n");
@@ -428,9 +665,9 @@ static Command ParseParams(Context* params) {
           params->quality = 11;
           continue;
         }
-        /* o/q/w/C/D/S with parameter is expected */
+        /* o/q/w/C/D/S/T with parameter is expected */
         if (c != 'o' && c != 'q' && c != 'w' && c != 'C' && c != 'D' &&
-            c != 'S') {
+            c != 'S' && c != 'T') {
           fprintf(stderr, "invalid argument -%c\n", c);
           return COMMAND_INVALID;
         }
@@ -466,18 +703,8 @@ static Command ParseParams(Context* params) {
             fprintf(stderr, "lgwin parameter already set\n");
             return COMMAND_INVALID;
           }
-          lgwin_set = ParseInt(argv[i], 0,
-                               BROTLI_MAX_WINDOW_BITS, &params->lgwin);
-          if (!lgwin_set) {
-            fprintf(stderr, "error parsing lgwin value [%s]\n", argv[i]);
-            return COMMAND_INVALID;
-          }
-          if (params->lgwin != 0 && params->lgwin < BROTLI_MIN_WINDOW_BITS) {
-            fprintf(stderr,
-                    "lgwin parameter (%d) smaller than the minimum (%d)\n",
-                    params->lgwin, BROTLI_MIN_WINDOW_BITS);
-            return COMMAND_INVALID;
-          }
+          lgwin_set = ParseLgwin(argv[i], params);
+          if (!lgwin_set) return COMMAND_INVALID;
         } else if (c == 'C') {
           if (comment_set) {
             fprintf(stderr, "comment already set\n");
@@ -502,11 +729,35 @@ static Command ParseParams(Context* params) {
           }
           suffix_set = BROTLI_TRUE;
           params->suffix = argv[i];
+        } else if (c == 'T') {
+          if (threads_set) {
+            fprintf(stderr, "number of threads already set\n");
+            return COMMAND_INVALID;
+          }
+          threads_set = ParseInt(argv[i], 1, MAX_THREADS, &params->threads);
+          if (!threads_set) {
+            fprintf(stderr, "error parsing threads value [%s]\n", argv[i]);
+            return COMMAND_INVALID;
+          }
         }
       }
     } else {  /* Double-dash. */
       arg = &arg[2];
-      if (strcmp("best", arg) == 0) {
+      if (strcmp("analyze", arg) == 0) {
+        if (command_set) {
+          fprintf(stderr, "command already set when parsing --analyze\n");
+          return COMMAND_INVALID;
+        }
+        command_set = BROTLI_TRUE;
+        command = COMMAND_ANALYZE;
+      } else if (strcmp("bench", arg) == 0) {
+        if (command_set) {
+          fprintf(stderr, "command already set when parsing --bench\n");
+          return COMMAND_INVALID;
+        }
+        command_set = BROTLI_TRUE;
+        command = COMMAND_BENCH;
+      } else if (strcmp("best", arg) == 0) {
         if (quality_set) {
           fprintf(stderr, "quality already set\n");
           return COMMAND_INVALID;
@@ -550,6 +801,12 @@ static Command ParseParams(Context* params) {
           return COMMAND_INVALID;
         }
         params->copy_stat = BROTLI_FALSE;
+      } else if (strcmp("recursive", arg) == 0) {
+        if (params->recursive) {
+          fprintf(stderr, "argument --recursive / -r already set\n");
+          return COMMAND_INVALID;
+        }
+        params->recursive = BROTLI_TRUE;
       } else if (strcmp("rm", arg) == 0) {
         if (keep_set) {
           fprintf(stderr, "argument --rm / -j or --keep / -k already set\n");
@@ -565,6 +822,19 @@ static Command ParseParams(Context* params) {
         squash_set = BROTLI_TRUE;
         params->reject_uncompressible = BROTLI_TRUE;
         continue;
+      } else if (strcmp("seekable", arg) == 0) {
+        if (seekable_set) {
+          fprintf(stderr, "argument --seekable already set\n");
+          return COMMAND_INVALID;
+        }
+        seekable_set = BROTLI_TRUE;
+        params->seekable_chunk_size = DEFAULT_SEEKABLE_CHUNK_SIZE;
+      } else if (strcmp("shared", arg) == 0) {
+        if (params->shared_dictionary) {
+          fprintf(stderr, "argument --shared already set\n");
+          return COMMAND_INVALID;
+        }
+        params->shared_dictionary = BROTLI_TRUE;
       } else if (strcmp("stdout", arg) == 0) {
         if (output_set) {
           fprintf(stderr, "write to standard output already set\n");
@@ -579,6 +849,13 @@ static Command ParseParams(Context* params) {
         }
         command_set = BROTLI_TRUE;
         command = COMMAND_TEST_INTEGRITY;
+      } else if (strcmp("train", arg) == 0) {
+        if (command_set) {
+          fprintf(stderr, "command already set when parsing --train\n");
+          return COMMAND_INVALID;
+        }
+        command_set = BROTLI_TRUE;
+        command = COMMAND_TRAIN;
       } else if (strcmp("verbose", arg) == 0) {
         if (params->verbosity > 0) {
           fprintf(stderr, "argument --verbose / -v already set\n");
@@ -598,7 +875,21 @@ static Command ParseParams(Context* params) {
         }
         key_len = (size_t)(value - arg);
         value++;
-        if (strncmp("comment", arg, key_len) == 0) {
+        if (strncmp("bench", arg, key_len) == 0) {
+          if (command_set) {
+            fprintf(stderr, "command already set when parsing --bench\n");
+            return COMMAND_INVALID;
+          }
+          command_set = BROTLI_TRUE;
+          command = COMMAND_BENCH;
+          bench_range_set = ParseIntRange(value,
+              BROTLI_MIN_QUALITY, BROTLI_MAX_QUALITY,
+              &params->bench_quality_min, &params->bench_quality_max);
+          if (!bench_range_set) {
+            fprintf(stderr, "error parsing quality range [%s]\n", value);
+            return COMMAND_INVALID;
+          }
+        } else if (strncmp("comment", arg, key_len) == 0) {
           if (comment_set) {
             fprintf(stderr, "comment already set\n");
             return COMMAND_INVALID;
@@ -615,23 +906,24 @@ static Command ParseParams(Context* params) {
             return COMMAND_INVALID;
           }
           params->dictionary_path = value;
-        } else if (strncmp("lgwin", arg, key_len) == 0) {
-          if (lgwin_set) {
-            fprintf(stderr, "lgwin parameter already set\n");
+        } else if (strncmp("maxdict", arg, key_len) == 0) {
+          if (maxdict_set) {
+            fprintf(stderr, "maximal dictionary size already set\n");
             return COMMAND_INVALID;
           }
-          lgwin_set = ParseInt(value, 0,
-                               BROTLI_MAX_WINDOW_BITS, &params->lgwin);
-          if (!lgwin_set) {
-            fprintf(stderr, "error parsing lgwin value [%s]\n", value);
+          maxdict_set = ParseSize(value, 256, 1u << 25,
+                                  &params->max_dictionary_size);
+          if (!maxdict_set) {
+            fprintf(stderr, "error parsing maxdict value [%s]\n", value);
             return COMMAND_INVALID;
           }
-          if (params->lgwin != 0 && params->lgwin < BROTLI_MIN_WINDOW_BITS) {
-            fprintf(stderr,
-                    "lgwin parameter (%d) smaller than the minimum (%d)\n",
-                    params->lgwin, BROTLI_MIN_WINDOW_BITS);
+        } else if (strncmp("lgwin", arg, key_len) == 0) {
+          if (lgwin_set) {
+            fprintf(stderr, "lgwin parameter already set\n");
             return COMMAND_INVALID;
           }
+          lgwin_set = ParseLgwin(value, params);
+          if (!lgwin_set) return COMMAND_INVALID;
         } else if (strncmp("large_window", arg, key_len) == 0) {
           /* This option is intentionally not mentioned in help. */
           if (lgwin_set) {
@@ -644,12 +936,25 @@ static Command ParseParams(Context* params) {
             fprintf(stderr, "error parsing lgwin value [%s]\n", value);
             return COMMAND_INVALID;
           }
+          params->bench_lgwin_max = params->lgwin;
           if (params->lgwin != 0 && params->lgwin < BROTLI_MIN_WINDOW_BITS) {
             fprintf(stderr,
                     "lgwin parameter (%d) smaller than the minimum (%d)\n",
                     params->lgwin, BROTLI_MIN_WINDOW_BITS);
             return COMMAND_INVALID;
           }
+        } else if (strncmp("simd_hasher", arg, key_len) == 0) {
+          /* This option is intentionally not mentioned in help; it is used
+             to check that output does not depend on the chosen hasher. */
+          if (params->simd_hasher >= 0) {
+            fprintf(stderr, "simd_hasher parameter already set\n");
+            return COMMAND_INVALID;
+          }
+          if (!ParseInt(value, BROTLI_SIMD_HASHER_DEFAULT,
+                        BROTLI_SIMD_HASHER_DISABLE, &params->simd_hasher)) {
+            fprintf(stderr, "error parsing simd_hasher value [%s]\n", value);
+            return COMMAND_INVALID;
+          }
         } else if (strncmp("output", arg, key_len) == 0) {
           if (output_set) {
             fprintf(stderr,
@@ -675,6 +980,38 @@ static Command ParseParams(Context* params) {
           }
           suffix_set = BROTLI_TRUE;
           params->suffix = value;
+        } else if (strncmp("threads", arg, key_len) == 0) {
+          if (threads_set) {
+            fprintf(stderr, "number of threads already set\n");
+            return COMMAND_INVALID;
+          }
+          threads_set = ParseInt(value, 1, MAX_THREADS, &params->threads);
+          if (!threads_set) {
+            fprintf(stderr, "error parsing threads value [%s]\n", value);
+            return COMMAND_INVALID;
+          }
+        } else if (strncmp("range", arg, key_len) == 0) {
+          if (params->range_set) {
+            fprintf(stderr, "range already set\n");
+            return COMMAND_INVALID;
+          }
+          params->range_set = ParseRange(value,
+              &params->range_offset, &params->range_length);
+          if (!params->range_set) {
+            fprintf(stderr, "error parsing range [%s]\n", value);
+            return COMMAND_INVALID;
+          }
+        } else if (strncmp("seekable", arg, key_len) == 0) {
+          if (seekable_set) {
+            fprintf(stderr, "argument --seekable already set\n");
+            return COMMAND_INVALID;
+          }
+          seekable_set = ParseSize(value, MIN_SEEKABLE_CHUNK_SIZE,
+              MAX_SEEKABLE_CHUNK_SIZE, &params->seekable_chunk_size);
+          if (!seekable_set) {
+            fprintf(stderr, "error parsing seekable chunk size [%s]\n", value);
+            return COMMAND_INVALID;
+          }
         } else {
           fprintf(stderr, "invalid parameter: [%s]\n", arg);
           return COMMAND_INVALID;
@@ -685,9 +1022,68 @@ static Command ParseParams(Context* params) {
 
   params->input_count = input_count;
   params->longest_path_len = longest_path_len;
+  if (lgwin_set && params->bench_lgwin_max != params->lgwin &&
+      command != COMMAND_BENCH) {
+    return COMMAND_INVALID;
+  }
+  if (threads_set && command != COMMAND_COMPRESS &&
+      command != COMMAND_DECOMPRESS && command != COMMAND_TEST_INTEGRITY) {
+    return COMMAND_INVALID;
+  }
+  params->split_input = threads_set;
+  if (seekable_set && command != COMMAND_COMPRESS) return COMMAND_INVALID;
+  if (params->range_set && command != COMMAND_DECOMPRESS &&
+      command != COMMAND_TEST_INTEGRITY) {
+    return COMMAND_INVALID;
+  }
   params->decompress = (command == COMMAND_DECOMPRESS);
-  params->test_integrity = (command == COMMAND_TEST_INTEGRITY);
+  params->decode = (command == COMMAND_DECOMPRESS ||
+                    command == COMMAND_TEST_INTEGRITY);
+  /* Compressed output is discarded in analysis mode as well. */
+  params->test_integrity = (command == COMMAND_TEST_INTEGRITY ||
+                            command == COMMAND_ANALYZE);
+
+  if (command == COMMAND_ANALYZE) {
+    /* Optional output is a pruned dictionary. */
+    if (!params->dictionary_path) return COMMAND_INVALID;
+    if (params->write_to_stdout) return COMMAND_INVALID;
+    if (params->junk_source || params->reject_uncompressible) {
+      return COMMAND_INVALID;
+    }
+    if (maxdict_set || params->shared_dictionary) return COMMAND_INVALID;
+    return command;
+  }
+
+  if (command == COMMAND_BENCH) {
+    /* Inputs are only read; results are written to standard output. */
+    if (params->output_path || params->write_to_stdout) return COMMAND_INVALID;
+    if (params->junk_source || params->reject_uncompressible) {
+      return COMMAND_INVALID;
+    }
+    if (params->allow_concatenated || params->comment_len) {
+      return COMMAND_INVALID;
+    }
+    if (maxdict_set || params->shared_dictionary) return COMMAND_INVALID;
+    if (bench_range_set && quality_set) return COMMAND_INVALID;
+    if (!bench_range_set) {
+      params->bench_quality_min = params->quality;
+      params->bench_quality_max = params->quality;
+    }
+    return command;
+  }
 
+  if (command == COMMAND_TRAIN) {
+    /* All inputs are merged into a single dictionary. */
+    if (!params->output_path && !params->write_to_stdout) {
+      return COMMAND_INVALID;
+    }
+    if (params->dictionary_path) return COMMAND_INVALID;
+    if (params->junk_source || params->reject_uncompressible) {
+      return COMMAND_INVALID;
+    }
+    return command;
+  }
+  if (maxdict_set || params->shared_dictionary) return COMMAND_INVALID;
   if (input_count > 1 && output_set) return COMMAND_INVALID;
   if (params->test_integrity) {
     if (params->output_path) return COMMAND_INVALID;
@@ -705,6 +1101,10 @@ static Command ParseParams(Context* params) {
   if (params->allow_concatenated && params->comment_len) {
     return COMMAND_INVALID;
   }
+  /* Comment is not checked / embedded per chunk. */
+  if ((seekable_set || params->range_set) && params->comment_len) {
+    return COMMAND_INVALID;
+  }
 
   return command;
 }
@@ -725,6 +1125,7 @@ static void PrintHelp(const char* name, BROTLI_BOOL error) {
   fprintf(media,
 "Options:\n"
 "  -#                          compression level (0-9)\n"
+
 "  -c, --stdout                write on standard output\n"
 "  -d, --decompress            decompress\n"
 "  -f, --force                 force output file overwrite\n"
@@ -734,13 +1135,31 @@ static void PrintHelp(const char* name, BROTLI_BOOL error) {
 "  -s, --squash                remove destination file if larger than source\n"
 "  -k, --keep                  keep source file(s) (default)\n"
 "  -n, --no-copy-stat          do not copy source file(s) attributes\n"
-"  -o FILE, --output=FILE      output file (only if 1 input file)\n");
+"  -o FILE, --output=FILE      output file (only if 1 input file)\n"
+"  -r, --recursive             process files in FILE directories\n"
+"                              recursively\n");
   fprintf(media,
 "  -q NUM, --quality=NUM       compression level (%d-%d)\n",
           BROTLI_MIN_QUALITY, BROTLI_MAX_QUALITY);
   fprintf(media,
 "  -t, --test                  test compressed file integrity\n"
-"  -v, --verbose               verbose mode\n");
+"  --train                     train raw (LZ77) dictionary on FILE(s)\n"
+"                              and write it to -o FILE or -c\n"
+"  --shared                    with --train: generate serialized shared\n"
+"                              dictionary with custom words and transforms\n"
+"  --maxdict=NUM               trained dictionary size limit (default: %dK)\n",
+          DEFAULT_MAX_DICTIONARY_SIZE >> 10);
+  fprintf(media,
+"  --analyze                   report how -D FILE dictionary is used when\n"
+"                              compressing FILE(s); with -o FILE write\n"
+"                              dictionary with unused regions removed\n"
+"  --bench[=NUM[-NUM]]         benchmark compression of FILE(s) in memory\n"
+"                              for quality range (default: -q value) and\n"
+"                              -w NUM[-NUM] window range;\n"
+"                              report speed, ratio and memory as JSON\n");
+  fprintf(media,
+"  -v, --verbose               verbose mode; report progress of long jobs\n"
+"                              and time spent in encoder stages\n");
   fprintf(media,
 "  -w NUM, --lgwin=NUM         set LZ77 window size (0, %d-%d)\n"
 "                              window size = 2**NUM - 16\n"
@@ -760,12 +1179,31 @@ static void PrintHelp(const char* name, BROTLI_BOOL error) {
 "                              when encoding: embed comment (fingerprint)\n",
           MAX_COMMENT_LEN);
   fprintf(media,
-"  -D FILE, --dictionary=FILE  use FILE as raw (LZ77) dictionary\n"
-"  -K, --concatenated          allows concatenated brotli streams as input\n");
+"  -D FILE, --dictionary=FILE  use FILE as raw (LZ77) or serialized shared\n"
+"                              dictionary\n"
+"  -K, --concatenated          allows concatenated brotli streams as input;\n"
+"                              they are decompressed sequentially, even with\n"
+"                              -T, unless input is made with --seekable\n"
+"  --range=OFF:LEN             decompress only LEN bytes starting at OFF;\n"
+"                              input should be made with --seekable\n");
   fprintf(media,
 "  -S SUF, --suffix=SUF        output file suffix (default:'%s')\n",
           DEFAULT_SUFFIX);
   fprintf(media,
+"  --seekable[=NUM]            compress chunks of NUM bytes (default: %dM)\n"
+"                              as separate streams and append index, so that\n"
+"                              --range could be decompressed alone (or\n"
+"                              in parallel with -T)\n",
+          DEFAULT_SEEKABLE_CHUNK_SIZE >> 20);
+  fprintf(media,
+"  -T NUM, --threads=NUM       use NUM threads (1-%d): process several\n"
+"                              FILEs at once, or compress chunks of single\n"
+"                              input; output does not depend on NUM;\n"
+"                              single stream is read / written in background;\n"
+"                              streams of --seekable input are decompressed\n"
+"                              in parallel\n",
+          MAX_THREADS);
+  fprintf(media,
 "  -V, --version               display version and exit\n"
 "  -Z, --best                  use best compression level (11) (default)\n"
 "Simple options could be coalesced, i.e. '-9kf' is equivalent to '-9 -k -f'.\n"
@@ -816,17 +1254,48 @@ static BROTLI_BOOL OpenOutputFile(const char* output_path, FILE** f,
   return BROTLI_TRUE;
 }
 
+/* Moves position of |f| to the end; returns file size, or -1 on failure.
+   On MSVC fseek / ftell are 64-bit; elsewhere fseeko / ftello are used,
+   if available. */
+static int64_t SeekFileEnd(FILE* f) {
+#if HAVE_FSEEKO
+  off_t position;
+  if (fseeko(f, 0, SEEK_END) != 0) return -1;
+  position = ftello(f);
+#elif defined(_MSC_VER) && (_MSC_VER >= 1400)
+  int64_t position;
+  if (fseek(f, 0, SEEK_END) != 0) return -1;
+  position = ftell(f);
+#else
+  long position;
+  if (fseek(f, 0L, SEEK_END) != 0) return -1;
+  position = ftell(f);
+#endif
+  return (position < 0) ? -1 : (int64_t)position;
+}
+
+/* Sets position of |f|; fails if |offset| does not fit file offset type. */
+static BROTLI_BOOL SeekFile(FILE* f, uint64_t offset) {
+#if HAVE_FSEEKO
+  off_t position = (off_t)offset;
+  if (position < 0 || (uint64_t)position != offset) return BROTLI_FALSE;
+  return TO_BROTLI_BOOL(fseeko(f, position, SEEK_SET) == 0);
+#elif defined(_MSC_VER) && (_MSC_VER >= 1400)
+  if (offset > (uint64_t)INT64_MAX) return BROTLI_FALSE;
+  return TO_BROTLI_BOOL(fseek(f, (int64_t)offset, SEEK_SET) == 0);
+#else
+  if (offset > (uint64_t)LONG_MAX) return BROTLI_FALSE;
+  return TO_BROTLI_BOOL(fseek(f, (long)offset, SEEK_SET) == 0);
+#endif
+}
+
 static int64_t FileSize(const char* path) {
   FILE* f = fopen(path, "rb");
   int64_t retval;
   if (f == NULL) {
     return -1;
   }
-  if (fseek(f, 0L, SEEK_END) != 0) {
-    fclose(f);
-    return -1;
-  }
-  retval = ftell(f);
+  retval = SeekFileEnd(f);
   if (fclose(f) != 0) {
     return -1;
   }
@@ -898,6 +1367,22 @@ static void CopyStat(const char* input_path, const char* output_path,
 
 /* Result ownership is passed to caller.
    |*dictionary_size| is set to resulting buffer size. */
+/* Serialized shared dictionaries (e.g. made with "--train --shared") are only
+   supported if library is built with BROTLI_EXPERIMENTAL; otherwise (or if
+   data is not a valid shared dictionary) file is used as a raw dictionary. */
+static BROTLI_BOOL IsSerializedSharedDictionary(
+    const uint8_t* data, size_t size) {
+  BrotliSharedDictionary* probe;
+  BROTLI_BOOL result;
+  if (size < 2 || data[0] != 0x91 || data[1] != 0) return BROTLI_FALSE;
+  probe = BrotliSharedDictionaryCreateInstance(NULL, NULL, NULL);
+  if (!probe) return BROTLI_FALSE;
+  result = BrotliSharedDictionaryAttach(
+      probe, BROTLI_SHARED_DICTIONARY_SERIALIZED, size, data);
+  BrotliSharedDictionaryDestroyInstance(probe);
+  return result;
+}
+
 static BROTLI_BOOL ReadDictionary(Context* context, Command command) {
   static const int kMaxDictionarySize =
       BROTLI_MAX_DISTANCE - BROTLI_MAX_BACKWARD_LIMIT(24);
@@ -946,9 +1431,17 @@ static BROTLI_BOOL ReadDictionary(Context* context, Command command) {
   }
   fclose(f);
   context->dictionary = buffer;
-  if (command == COMMAND_COMPRESS) {
+  if (IsSerializedSharedDictionary(buffer, context->dictionary_size)) {
+    context->dictionary_type = BROTLI_SHARED_DICTIONARY_SERIALIZED;
+    if (command == COMMAND_ANALYZE) {
+      fprintf(stderr, "only raw dictionaries could be analyzed\n");
+      return BROTLI_FALSE;
+    }
+  }
+  if (command == COMMAND_COMPRESS || command == COMMAND_ANALYZE ||
+      command == COMMAND_BENCH) {
     context->prepared_dictionary = BrotliEncoderPrepareDictionary(
-        BROTLI_SHARED_DICTIONARY_RAW, context->dictionary_size,
+        context->dictionary_type, context->dictionary_size,
         context->dictionary, BROTLI_MAX_QUALITY, NULL, NULL, NULL);
     if (context->prepared_dictionary == NULL) {
       fprintf(stderr, "failed to prepare dictionary [%s]\n",
@@ -959,6 +1452,221 @@ static BROTLI_BOOL ReadDictionary(Context* context, Command command) {
   return BROTLI_TRUE;
 }
 
+/* Recursive directory traversal (-r). Entries are sorted by name, so that
+   files are processed in the same order on every run. Symbolic links to
+   directories are not followed. */
+
+#define FILE_KIND_OTHER 0
+#define FILE_KIND_REGULAR 1
+#define FILE_KIND_DIRECTORY 2
+
+static int FileKind(const char* path, BROTLI_BOOL follow_links) {
+#if defined(_WIN32)
+  DWORD attributes = GetFileAttributesA(path);
+  if (attributes == INVALID_FILE_ATTRIBUTES) return FILE_KIND_OTHER;
+  if (attributes & FILE_ATTRIBUTE_DIRECTORY) {
+    if (!follow_links && (attributes & FILE_ATTRIBUTE_REPARSE_POINT)) {
+      return FILE_KIND_OTHER;
+    }
+    return FILE_KIND_DIRECTORY;
+  }
+  return FILE_KIND_REGULAR;
+#else
+  struct stat st;
+  if (lstat(path, &st) != 0) return FILE_KIND_OTHER;
+  if (S_ISLNK(st.st_mode)) {
+    if (stat(path, &st) != 0) return FILE_KIND_OTHER;
+    if (S_ISDIR(st.st_mode) && !follow_links) return FILE_KIND_OTHER;
+  }
+  if (S_ISDIR(st.st_mode)) return FILE_KIND_DIRECTORY;
+  if (S_ISREG(st.st_mode)) return FILE_KIND_REGULAR;
+  return FILE_KIND_OTHER;
+#endif
+}
+
+static int CompareNames(const void* a, const void* b) {
+  return strcmp(*(const char* const*)a, *(const char* const*)b);
+}
+
+static BROTLI_BOOL AppendName(char*** names, size_t* count, size_t* capacity,
+                              const char* name) {
+  size_t len = strlen(name);
+  char* copy;
+  if (*count == *capacity) {
+    size_t new_capacity = *capacity ? 2 * *capacity : 64;
+    char** new_names = (char**)realloc(*names, new_capacity * sizeof(char*));
+    if (!new_names) return BROTLI_FALSE;
+    *names = new_names;
+    *capacity = new_capacity;
+  }
+  copy = (char*)malloc(len + 1);
+  if (!copy) return BROTLI_FALSE;
+  memcpy(copy, name, len + 1);
+  (*names)[(*count)++] = copy;
+  return BROTLI_TRUE;
+}
+
+static void FreeNames(char** names, size_t count) {
+  size_t i;
+  for (i = 0; i < count; ++i) free(names[i]);
+  free(names);
+}
+
+/* Lists directory entries, except "." and ".."; result is sorted. */
+static BROTLI_BOOL ReadDirectory(const char* path, char*** names,
+                                 size_t* count) {
+  size_t capacity = 0;
+  BROTLI_BOOL is_ok = BROTLI_TRUE;
+#if defined(_WIN32)
+  WIN32_FIND_DATAA entry;
+  HANDLE handle;
+  size_t path_len = strlen(path);
+  char* pattern = (char*)malloc(path_len + 3);
+  *names = NULL;
+  *count = 0;
+  if (!pattern) {
+    fprintf(stderr, "out of memory\n");
+    return BROTLI_FALSE;
+  }
+  memcpy(pattern, path, path_len);
+  memcpy(pattern + path_len, "\\*", 3);
+  handle = FindFirstFileA(pattern, &entry);
+  free(pattern);
+  if (handle == INVALID_HANDLE_VALUE) {
+    fprintf(stderr, "failed to read directory [%s]\n", path);
+    return BROTLI_FALSE;
+  }
+  do {
+    if (strcmp(entry.cFileName, ".") == 0) continue;
+    if (strcmp(entry.cFileName, "..") == 0) continue;
+    is_ok = AppendName(names, count, &capacity, entry.cFileName);
+  } while (is_ok && FindNextFileA(handle, &entry));
+  FindClose(handle);
+#else
+  struct dirent* entry;
+  DIR* dir = opendir(path);
+  *names = NULL;
+  *count = 0;
+  if (!dir) {
+    fprintf(stderr, "failed to read directory [%s]: %s\n", path,
+            strerror(errno));
+    return BROTLI_FALSE;
+  }
+  while (is_ok && (entry = readdir(dir)) != NULL) {
+    if (strcmp(entry->d_name, ".") == 0) continue;
+    if (strcmp(entry->d_name, "..") == 0) continue;
+    is_ok = AppendName(names, count, &capacity, entry->d_name);
+  }
+  closedir(dir);
+#endif
+  if (!is_ok) {
+    fprintf(stderr, "out of memory\n");
+    FreeNames(*names, *count);
+    *names = NULL;
+    *count = 0;
+    return BROTLI_FALSE;
+  }
+  if (*count > 1) qsort(*names, *count, sizeof(char*), CompareNames);
+  return BROTLI_TRUE;
+}
+
+/* Checks if file found in directory should be processed; e.g. files that
+   already have suffix are not compressed again. */
+static BROTLI_BOOL IsListedFile(Context* context, Command command,
+                                const char* name) {
+  size_t name_len = strlen(name);
+  size_t suffix_len = strlen(context->suffix);
+  BROTLI_BOOL has_suffix = TO_BROTLI_BOOL(name_len > suffix_len &&
+      strcmp(name + name_len - suffix_len, context->suffix) == 0);
+  if (command == COMMAND_COMPRESS) return TO_BROTLI_BOOL(!has_suffix);
+  if (command == COMMAND_DECOMPRESS || command == COMMAND_TEST_INTEGRITY) {
+    return has_suffix;
+  }
+  return BROTLI_TRUE;
+}
+
+static BROTLI_BOOL AppendFileListEntry(Context* context, const char* path,
+                                       size_t* capacity) {
+  size_t path_len = strlen(path);
+  if (!AppendName(&context->file_list, &context->file_list_size, capacity,
+                  path)) {
+    fprintf(stderr, "out of memory\n");
+    return BROTLI_FALSE;
+  }
+  if (context->longest_path_len < path_len) {
+    context->longest_path_len = path_len;
+  }
+  return BROTLI_TRUE;
+}
+
+static BROTLI_BOOL ListDirectoryFiles(Context* context, Command command,
+    const char* path, size_t* capacity) {
+  char** names;
+  size_t count;
+  size_t path_len = strlen(path);
+  BROTLI_BOOL needs_separator = TO_BROTLI_BOOL(path_len > 0 &&
+      path[path_len - 1] != '/' && path[path_len - 1] != '\\');
+  BROTLI_BOOL is_ok = BROTLI_TRUE;
+  size_t i;
+  if (!ReadDirectory(path, &names, &count)) return BROTLI_FALSE;
+  for (i = 0; is_ok && i < count; ++i) {
+    size_t name_len = strlen(names[i]);
+    char* child = (char*)malloc(path_len + 1 + name_len + 1);
+    int kind;
+    if (!child) {
+      fprintf(stderr, "out of memory\n");
+      is_ok = BROTLI_FALSE;
+      break;
+    }
+    memcpy(child, path, path_len);
+    if (needs_separator) child[path_len] = '/';
+    memcpy(child + path_len + (needs_separator ? 1 : 0), names[i],
+           name_len + 1);
+    kind = FileKind(child, BROTLI_FALSE);
+    if (kind == FILE_KIND_DIRECTORY) {
+      is_ok = ListDirectoryFiles(context, command, child, capacity);
+    } else if (kind == FILE_KIND_REGULAR &&
+               IsListedFile(context, command, names[i])) {
+      is_ok = AppendFileListEntry(context, child, capacity);
+    }
+    free(child);
+  }
+  FreeNames(names, count);
+  return is_ok;
+}
+
+/* Replaces input arguments with the list of files; directories are
+   traversed recursively. */
+static BROTLI_BOOL ExpandInputs(Context* context, Command command) {
+  size_t capacity = 64;
+  int ignore = 0;
+  int i;
+  /* Not NULL even if empty; empty list is not a request to read console. */
+  context->file_list = (char**)malloc(capacity * sizeof(char*));
+  context->file_list_size = 0;
+  if (!context->file_list) {
+    fprintf(stderr, "out of memory\n");
+    return BROTLI_FALSE;
+  }
+  for (i = 1; i < context->argc; ++i) {
+    const char* arg = context->argv[i];
+    BROTLI_BOOL is_ok;
+    if (i == context->not_input_indices[ignore]) {
+      ignore++;
+      continue;
+    }
+    if (strcmp(arg, "-") != 0 &&
+        FileKind(arg, BROTLI_TRUE) == FILE_KIND_DIRECTORY) {
+      is_ok = ListDirectoryFiles(context, command, arg, &capacity);
+    } else {
+      is_ok = AppendFileListEntry(context, arg, &capacity);
+    }
+    if (!is_ok) return BROTLI_FALSE;
+  }
+  context->input_count = context->file_list_size;
+  return BROTLI_TRUE;
+}
+
 static BROTLI_BOOL NextFile(Context* context) {
   const char* arg;
   size_t arg_len;
@@ -968,26 +1676,31 @@ static BROTLI_BOOL NextFile(Context* context) {
 
   context->input_file_length = -1;
 
-  /* No input path; read from console. */
-  if (context->input_count == 0) {
+  if (context->file_list) {
+    if ((size_t)context->iterator > context->file_list_size) {
+      return BROTLI_FALSE;
+    }
+    arg = context->file_list[context->iterator - 1];
+  } else if (context->input_count == 0) {
+    /* No input path; read from console. */
     if (context->iterator > 1) return BROTLI_FALSE;
     context->current_input_path = NULL;
     /* Either write to the specified path, or to console. */
     context->current_output_path = context->output_path;
     return BROTLI_TRUE;
-  }
+  } else {
+    /* Skip option arguments. */
+    while (context->iterator == context->not_input_indices[context->ignore]) {
+      context->iterator++;
+      context->ignore++;
+    }
 
-  /* Skip option arguments. */
-  while (context->iterator == context->not_input_indices[context->ignore]) {
-    context->iterator++;
-    context->ignore++;
-  }
+    /* All args are scanned already. */
+    if (context->iterator >= context->argc) return BROTLI_FALSE;
 
-  /* All args are scanned already. */
-  if (context->iterator >= context->argc) return BROTLI_FALSE;
-
-  /* Iterator now points to the input file name. */
-  arg = context->argv[context->iterator];
+    /* Iterator now points to the input file name. */
+    arg = context->argv[context->iterator];
+  }
   arg_len = strlen(arg);
   /* Read from console. */
   if (arg_len == 1 && arg[0] == '-') {
@@ -1032,11 +1745,312 @@ static BROTLI_BOOL NextFile(Context* context) {
   }
 }
 
+/* Minimal portable threads: only start / join and a mutex. */
+typedef void (*ThreadFunc)(void* opaque);
+
+typedef struct Thread {
+#if HAVE_THREADS && defined(_WIN32)
+  HANDLE handle;
+#elif HAVE_THREADS
+  pthread_t handle;
+#endif
+  BROTLI_BOOL is_started;
+  ThreadFunc func;
+  void* opaque;
+} Thread;
+
+typedef struct Mutex {
+#if HAVE_THREADS && defined(_WIN32)
+  CRITICAL_SECTION handle;
+#elif HAVE_THREADS
+  pthread_mutex_t handle;
+#else
+  int unused;  /* Empty structs are not allowed. */
+#endif
+} Mutex;
+
+#if HAVE_THREADS && defined(_WIN32)
+static DWORD WINAPI ThreadMain(LPVOID opaque) {
+  Thread* thread = (Thread*)opaque;
+  thread->func(thread->opaque);
+  return 0;
+}
+#elif HAVE_THREADS
+static void* ThreadMain(void* opaque) {
+  Thread* thread = (Thread*)opaque;
+  thread->func(thread->opaque);
+  return NULL;
+}
+#endif
+
+/* Runs |func| synchronously, if thread could not be started. */
+static void StartThread(Thread* thread, ThreadFunc func, void* opaque) {
+  thread->func = func;
+  thread->opaque = opaque;
+  thread->is_started = BROTLI_FALSE;
+#if HAVE_THREADS && defined(_WIN32)
+  thread->handle = CreateThread(NULL, 0, ThreadMain, thread, 0, NULL);
+  thread->is_started = TO_BROTLI_BOOL(thread->handle != NULL);
+#elif HAVE_THREADS
+  thread->is_started = TO_BROTLI_BOOL(
+      pthread_create(&thread->handle, NULL, ThreadMain, thread) == 0);
+#endif
+  if (!thread->is_started) func(opaque);
+}
+
+static void JoinThread(Thread* thread) {
+  if (!thread->is_started) return;
+#if HAVE_THREADS && defined(_WIN32)
+  WaitForSingleObject(thread->handle, INFINITE);
+  CloseHandle(thread->handle);
+#elif HAVE_THREADS
+  pthread_join(thread->handle, NULL);
+#endif
+  thread->is_started = BROTLI_FALSE;
+}
+
+static void InitMutex(Mutex* mutex) {
+#if HAVE_THREADS && defined(_WIN32)
+  InitializeCriticalSection(&mutex->handle);
+#elif HAVE_THREADS
+  pthread_mutex_init(&mutex->handle, NULL);
+#else
+  mutex->unused = 0;
+#endif
+}
+
+static void LockMutex(Mutex* mutex) {
+#if HAVE_THREADS && defined(_WIN32)
+  EnterCriticalSection(&mutex->handle);
+#elif HAVE_THREADS
+  pthread_mutex_lock(&mutex->handle);
+#else
+  (void)mutex;
+#endif
+}
+
+static void UnlockMutex(Mutex* mutex) {
+#if HAVE_THREADS && defined(_WIN32)
+  LeaveCriticalSection(&mutex->handle);
+#elif HAVE_THREADS
+  pthread_mutex_unlock(&mutex->handle);
+#else
+  (void)mutex;
+#endif
+}
+
+static void DestroyMutex(Mutex* mutex) {
+#if HAVE_THREADS && defined(_WIN32)
+  DeleteCriticalSection(&mutex->handle);
+#elif HAVE_THREADS
+  pthread_mutex_destroy(&mutex->handle);
+#else
+  (void)mutex;
+#endif
+}
+
+static const size_t kFileBufferSize = 1 << 19;
+
+/* Regular input files bigger than read buffer are memory-mapped; this saves
+   copying input to read buffer. Input is read with fread, if mapping
+   fails. */
+static void MapInputFile(Context* context) {
+#if HAVE_MMAP
+  struct stat statbuf;
+  size_t size;
+  void* map;
+  int fd = fileno(context->fin);
+  if (!context->current_input_path) return;
+  if (fstat(fd, &statbuf) != 0 || !S_ISREG(statbuf.st_mode)) return;
+  size = (size_t)statbuf.st_size;
+  if (size <= kFileBufferSize || (uint64_t)size != (uint64_t)statbuf.st_size) {
+    return;
+  }
+  map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (map == MAP_FAILED) return;
+#if defined(MADV_SEQUENTIAL)
+  madvise(map, size, MADV_SEQUENTIAL);
+#endif
+  context->mapped_input = (const uint8_t*)map;
+  context->mapped_input_size = size;
+  context->mapped_input_eof = BROTLI_FALSE;
+#else
+  (void)context;
+#endif
+}
+
+static void UnmapInputFile(Context* context) {
+#if HAVE_MMAP
+  if (context->mapped_input) {
+    munmap((void*)context->mapped_input, context->mapped_input_size);
+  }
+#endif
+  context->mapped_input = NULL;
+  context->mapped_input_size = 0;
+}
+
+/* Decompressed output could be mostly zeros (e.g. disk images); all-zero
+   aligned blocks are not written, but skipped with fseek, so that file system
+   could store them as holes. It is used only for named regular files; files
+   opened by shell could be in append mode, where seeking does not work. */
+#define SPARSE_BLOCK_SIZE 4096
+
+static const uint8_t kZeroBlock[SPARSE_BLOCK_SIZE] = {0};
+
+static void SetupSparseOutput(Context* context) {
+  context->sparse_output = BROTLI_FALSE;
+  context->sparse.offset = 0;
+  context->sparse.hole = 0;
+#if !defined(_WIN32)
+  if (context->decompress && context->current_output_path) {
+    struct stat statbuf;
+    if (fstat(fileno(context->fout), &statbuf) == 0 &&
+        S_ISREG(statbuf.st_mode)) {
+      context->sparse_output = BROTLI_TRUE;
+    }
+  }
+#endif
+}
+
+/* Seeks over pending hole; steps are small enough to fit long. */
+static BROTLI_BOOL SkipHole(FILE* file, SparseState* sparse) {
+  while (sparse->hole > 0) {
+    long step = (sparse->hole < ((uint64_t)1 << 30)) ?
+        (long)sparse->hole : (1L << 30);
+    if (fseek(file, step, SEEK_CUR) != 0) return BROTLI_FALSE;
+    sparse->hole -= (uint64_t)step;
+  }
+  return BROTLI_TRUE;
+}
+
+static BROTLI_BOOL WriteSparseData(FILE* file, SparseState* sparse,
+                                   const uint8_t* data, size_t size) {
+  if (size == 0) return BROTLI_TRUE;
+  if (!SkipHole(file, sparse)) return BROTLI_FALSE;
+  return TO_BROTLI_BOOL(fwrite(data, 1, size, file) == size);
+}
+
+/* Writes |data| to |file|; if |sparse| is not NULL, zero blocks are skipped.
+   Returns BROTLI_FALSE and sets errno, if write fails. */
+static BROTLI_BOOL WriteFileData(FILE* file, SparseState* sparse,
+                                 const uint8_t* data, size_t size) {
+  const uint8_t* pending = data;
+  if (!sparse) return TO_BROTLI_BOOL(fwrite(data, 1, size, file) == size);
+  while (size > 0) {
+    size_t block_pos = (size_t)(sparse->offset & (SPARSE_BLOCK_SIZE - 1));
+    size_t chunk = BROTLI_MIN(size_t, size, SPARSE_BLOCK_SIZE - block_pos);
+    if (chunk == SPARSE_BLOCK_SIZE &&
+        memcmp(data, kZeroBlock, SPARSE_BLOCK_SIZE) == 0) {
+      if (!WriteSparseData(file, sparse, pending, (size_t)(data - pending))) {
+        return BROTLI_FALSE;
+      }
+      sparse->hole += SPARSE_BLOCK_SIZE;
+      pending = data + SPARSE_BLOCK_SIZE;
+    }
+    data += chunk;
+    size -= chunk;
+    sparse->offset += chunk;
+  }
+  return WriteSparseData(file, sparse, pending, (size_t)(data - pending));
+}
+
+/* Trailing hole is terminated with a zero byte to set file size. */
+static BROTLI_BOOL FinishSparseOutput(FILE* file, SparseState* sparse) {
+  if (sparse->hole == 0) return BROTLI_TRUE;
+  sparse->hole--;
+  return WriteSparseData(file, sparse, kZeroBlock, 1);
+}
+
+/* Asynchronous I/O (with -T / --threads): the next piece of input is read
+   and the previous piece of output is written in background, while the
+   current one is processed. */
+#define ASYNC_WRITE_BUFFER_SIZE (1 << 21)
+
+typedef struct IoJob {
+  Thread thread;
+  BROTLI_BOOL is_pending;
+  FILE* file;
+  SparseState* sparse;  /* For write job; NULL if output is not sparse. */
+  uint8_t* data;
+  size_t size;
+  BROTLI_BOOL is_eof;
+  int error;  /* errno, or 0 */
+} IoJob;
+
+typedef struct AsyncIo {
+  IoJob read_job;
+  IoJob write_job;
+  uint8_t* read_buffers[2];
+  int read_index;  /* Buffer for the next read. */
+  uint8_t* write_buffers[2];
+  int write_index;  /* Buffer that is being filled. */
+  size_t write_size;
+  BROTLI_BOOL is_eof;  /* Input consumed so far ends at end of file. */
+} AsyncIo;
+
+static AsyncIo* CreateAsyncIo(void) {
+  size_t buffers_size = 2 * kFileBufferSize + 2 * ASYNC_WRITE_BUFFER_SIZE;
+  AsyncIo* io = (AsyncIo*)malloc(sizeof(AsyncIo) + buffers_size);
+  uint8_t* buffers;
+  if (!io) return NULL;
+  buffers = (uint8_t*)&io[1];
+  memset(io, 0, sizeof(AsyncIo));
+  io->read_buffers[0] = buffers;
+  io->read_buffers[1] = buffers + kFileBufferSize;
+  io->write_buffers[0] = buffers + 2 * kFileBufferSize;
+  io->write_buffers[1] = io->write_buffers[0] + ASYNC_WRITE_BUFFER_SIZE;
+  return io;
+}
+
+static void RunReadJob(void* opaque) {
+  IoJob* job = (IoJob*)opaque;
+  job->size = fread(job->data, 1, job->size, job->file);
+  job->error = ferror(job->file) ? (errno ? errno : EIO) : 0;
+  job->is_eof = TO_BROTLI_BOOL(feof(job->file));
+}
+
+static void RunWriteJob(void* opaque) {
+  IoJob* job = (IoJob*)opaque;
+  BROTLI_BOOL is_ok = WriteFileData(job->file, job->sparse, job->data,
+                                    job->size);
+  job->error = is_ok ? 0 : (errno ? errno : EIO);
+}
+
+static void StartIoJob(IoJob* job, ThreadFunc func, FILE* file,
+                       uint8_t* data, size_t size) {
+  job->file = file;
+  job->data = data;
+  job->size = size;
+  job->is_eof = BROTLI_FALSE;
+  job->error = 0;
+  job->is_pending = BROTLI_TRUE;
+  StartThread(&job->thread, func, job);
+}
+
+static void FinishIoJob(IoJob* job) {
+  if (!job->is_pending) return;
+  JoinThread(&job->thread);
+  job->is_pending = BROTLI_FALSE;
+}
+
+/* Waits for background I/O; unwritten output is dropped. */
+static void StopAsyncIo(Context* context) {
+  AsyncIo* io = context->async_io;
+  if (!io) return;
+  FinishIoJob(&io->read_job);
+  FinishIoJob(&io->write_job);
+  io->read_index = 0;
+  io->write_size = 0;
+  io->is_eof = BROTLI_FALSE;
+}
+
 static BROTLI_BOOL OpenFiles(Context* context) {
   BROTLI_BOOL is_ok = OpenInputFile(context->current_input_path, &context->fin);
+  if (is_ok) MapInputFile(context);
   if (!context->test_integrity && is_ok) {
     is_ok = OpenOutputFile(
         context->current_output_path, &context->fout, context->force_overwrite);
+    if (is_ok) SetupSparseOutput(context);
   }
   return is_ok;
 }
@@ -1044,6 +2058,7 @@ static BROTLI_BOOL OpenFiles(Context* context) {
 static BROTLI_BOOL CloseFiles(Context* context, BROTLI_BOOL rm_input,
                               BROTLI_BOOL rm_output) {
   BROTLI_BOOL is_ok = BROTLI_TRUE;
+  StopAsyncIo(context);
   if (!context->test_integrity && context->fout) {
     /* Apply metadata via the still-open fd, before close, to close the TOCTOU
        window between fclose() and the metadata syscalls. */
@@ -1063,6 +2078,7 @@ static BROTLI_BOOL CloseFiles(Context* context, BROTLI_BOOL rm_input,
     }
   }
 
+  UnmapInputFile(context);
   if (context->fin) {
     if (fclose(context->fin) != 0) {
       if (is_ok) {
@@ -1082,27 +2098,103 @@ static BROTLI_BOOL CloseFiles(Context* context, BROTLI_BOOL rm_input,
   return is_ok;
 }
 
-static const size_t kFileBufferSize = 1 << 19;
+/* Wall-clock time in seconds. */
+static double WallTime(void) {
+#if defined(_WIN32)
+  LARGE_INTEGER frequency;
+  LARGE_INTEGER counter;
+  QueryPerformanceFrequency(&frequency);
+  QueryPerformanceCounter(&counter);
+  return (double)counter.QuadPart / (double)frequency.QuadPart;
+#elif defined(CLOCK_MONOTONIC)
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (double)t.tv_sec + (double)t.tv_nsec * 1e-9;
+#else
+  return (double)clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+static void ResetStageTimer(StageTimer* timer) {
+  int i;
+  timer->stage = BROTLI_ENCODER_STAGE_IDLE;
+  timer->stage_start_time = WallTime();
+  for (i = 0; i < NUM_ENCODER_STAGES; ++i) timer->times[i] = 0.0;
+}
+
+static void OnEncoderStage(void* opaque, BrotliEncoderStage stage) {
+  StageTimer* timer = (StageTimer*)opaque;
+  double now = WallTime();
+  timer->times[timer->stage] += now - timer->stage_start_time;
+  timer->stage = stage;
+  timer->stage_start_time = now;
+}
 
 static void InitializeBuffers(Context* context) {
   context->available_in = 0;
   context->next_in = NULL;
-  context->available_out = kFileBufferSize;
-  context->next_out = context->output;
   context->total_in = 0;
   context->total_out = 0;
   if (context->verbosity > 0) {
     context->start_time = clock();
+    context->wall_start_time = WallTime();
+    context->progress_time = context->wall_start_time;
+    context->parallel_stages = BROTLI_FALSE;
+    ResetStageTimer(&context->stage_timer);
   }
 }
 
 /* This method might give the false-negative result.
    However, after an empty / incomplete read it should tell the truth. */
 static BROTLI_BOOL HasMoreInput(Context* context) {
+  if (context->mapped_input) return !context->mapped_input_eof;
+  /* Background read could have already reached the end of file. */
+  if (context->async_io) return !context->async_io->is_eof;
   return feof(context->fin) ? BROTLI_FALSE : BROTLI_TRUE;
 }
 
+/* Takes the result of background read and starts the next one. */
+static BROTLI_BOOL ProvideInputAsync(Context* context) {
+  AsyncIo* io = context->async_io;
+  IoJob* job = &io->read_job;
+  if (!job->is_pending) {
+    if (io->is_eof) {
+      context->available_in = 0;
+      return BROTLI_TRUE;
+    }
+    StartIoJob(job, RunReadJob, context->fin, io->read_buffers[io->read_index],
+               kFileBufferSize);
+  }
+  FinishIoJob(job);
+  context->available_in = job->size;
+  context->total_in += job->size;
+  context->next_in = job->data;
+  io->is_eof = job->is_eof;
+  if (job->error) {
+    fprintf(stderr, "failed to read input [%s]: %s\n",
+            PrintablePath(context->current_input_path), strerror(job->error));
+    return BROTLI_FALSE;
+  }
+  io->read_index ^= 1;
+  if (!io->is_eof) {
+    StartIoJob(job, RunReadJob, context->fin, io->read_buffers[io->read_index],
+               kFileBufferSize);
+  }
+  return BROTLI_TRUE;
+}
+
 static BROTLI_BOOL ProvideInput(Context* context) {
+  if (context->mapped_input) {
+    /* Input is sliced the same way as it is read, because output of some
+       compression levels depends on it. */
+    size_t remaining = context->mapped_input_size - context->total_in;
+    context->available_in = BROTLI_MIN(size_t, remaining, kFileBufferSize);
+    context->next_in = context->mapped_input + context->total_in;
+    context->total_in += context->available_in;
+    context->mapped_input_eof = TO_BROTLI_BOOL(remaining < kFileBufferSize);
+    return BROTLI_TRUE;
+  }
+  if (context->async_io) return ProvideInputAsync(context);
   context->available_in =
       fread(context->input, 1, kFileBufferSize, context->fin);
   context->total_in += context->available_in;
@@ -1115,15 +2207,57 @@ static BROTLI_BOOL ProvideInput(Context* context) {
   return BROTLI_TRUE;
 }
 
-/* Internal: should be used only in Provide-/Flush-Output. */
-static BROTLI_BOOL WriteOutput(Context* context) {
-  size_t out_size = (size_t)(context->next_out - context->output);
-  context->total_out += out_size;
-  if (out_size == 0) return BROTLI_TRUE;
+/* Starts background write of filled buffer, after the previous one is over;
+   this way the order of writes is preserved. */
+static BROTLI_BOOL SubmitOutput(Context* context) {
+  AsyncIo* io = context->async_io;
+  IoJob* job = &io->write_job;
+  FinishIoJob(job);
+  if (job->error) {
+    fprintf(stderr, "failed to write output [%s]: %s\n",
+            PrintablePath(context->current_output_path), strerror(job->error));
+    job->error = 0;
+    return BROTLI_FALSE;
+  }
+  if (io->write_size == 0) return BROTLI_TRUE;
+  job->sparse = context->sparse_output ? &context->sparse : NULL;
+  StartIoJob(job, RunWriteJob, context->fout,
+             io->write_buffers[io->write_index], io->write_size);
+  io->write_index ^= 1;
+  io->write_size = 0;
+  return BROTLI_TRUE;
+}
+
+/* Output is copied: buffers returned by BrotliEncoderTakeOutput /
+   BrotliDecoderTakeOutput are only valid until the next call, so writing them
+   in place would block (de)compression until the write is over. Copying is
+   several times cheaper than writing to a file (even to page cache). */
+static BROTLI_BOOL WriteOutputAsync(Context* context, const uint8_t* data,
+                                    size_t size) {
+  AsyncIo* io = context->async_io;
+  while (size > 0) {
+    size_t chunk = BROTLI_MIN(size_t, size,
+                              ASYNC_WRITE_BUFFER_SIZE - io->write_size);
+    memcpy(io->write_buffers[io->write_index] + io->write_size, data, chunk);
+    io->write_size += chunk;
+    data += chunk;
+    size -= chunk;
+    if (io->write_size == ASYNC_WRITE_BUFFER_SIZE) {
+      if (!SubmitOutput(context)) return BROTLI_FALSE;
+    }
+  }
+  return BROTLI_TRUE;
+}
+
+static BROTLI_BOOL WriteOutput(Context* context, const uint8_t* data,
+                               size_t size) {
+  context->total_out += size;
+  if (size == 0) return BROTLI_TRUE;
   if (context->test_integrity) return BROTLI_TRUE;
+  if (context->async_io) return WriteOutputAsync(context, data, size);
 
-  fwrite(context->output, 1, out_size, context->fout);
-  if (ferror(context->fout)) {
+  if (!WriteFileData(context->fout,
+      context->sparse_output ? &context->sparse : NULL, data, size)) {
     fprintf(stderr, "failed to write output [%s]: %s\n",
             PrintablePath(context->current_output_path), strerror(errno));
     return BROTLI_FALSE;
@@ -1131,20 +2265,153 @@ static BROTLI_BOOL WriteOutput(Context* context) {
   return BROTLI_TRUE;
 }
 
-static BROTLI_BOOL ProvideOutput(Context* context) {
-  if (!WriteOutput(context)) return BROTLI_FALSE;
-  context->available_out = kFileBufferSize;
-  context->next_out = context->output;
+/* Completes background writes, if any, and sets size of sparse file. */
+static BROTLI_BOOL FlushOutput(Context* context) {
+  if (context->test_integrity) return BROTLI_TRUE;
+  /* Second call waits for the last write. */
+  if (context->async_io &&
+      (!SubmitOutput(context) || !SubmitOutput(context))) {
+    return BROTLI_FALSE;
+  }
+  if (context->sparse_output &&
+      !FinishSparseOutput(context->fout, &context->sparse)) {
+    fprintf(stderr, "failed to write output [%s]: %s\n",
+            PrintablePath(context->current_output_path), strerror(errno));
+    return BROTLI_FALSE;
+  }
   return BROTLI_TRUE;
 }
 
-static BROTLI_BOOL FlushOutput(Context* context) {
-  if (!WriteOutput(context)) return BROTLI_FALSE;
-  context->available_out = 0;
-  context->next_out = context->output;
+/* Output is written directly from encoder / decoder buffers. */
+static BROTLI_BOOL WriteEncoderOutput(Context* context,
+                                      BrotliEncoderState* s) {
+  while (BrotliEncoderHasMoreOutput(s)) {
+    size_t size = 0;
+    const uint8_t* data = BrotliEncoderTakeOutput(s, &size);
+    if (!WriteOutput(context, data, size)) return BROTLI_FALSE;
+  }
   return BROTLI_TRUE;
 }
 
+static BROTLI_BOOL WriteDecoderOutput(Context* context,
+                                      BrotliDecoderState* s) {
+  while (BrotliDecoderHasMoreOutput(s)) {
+    size_t size = 0;
+    const uint8_t* data = BrotliDecoderTakeOutput(s, &size);
+    if (!WriteOutput(context, data, size)) return BROTLI_FALSE;
+  }
+  return BROTLI_TRUE;
+}
+
+/* Parallel processing of multiple files: each worker has a private copy of
+   the context (buffers, decoder, current files); input files are handed out
+   in command line order under the mutex. */
+typedef BROTLI_BOOL (*ProcessFileFunc)(Context* context);
+
+typedef struct FileWorkers {
+  Mutex mutex;
+  Context* context;  /* Shared; guarded by |mutex|. */
+  ProcessFileFunc process;
+  BROTLI_BOOL failed;  /* Guarded by |mutex|. */
+} FileWorkers;
+
+typedef struct FileWorker {
+  Thread thread;
+  FileWorkers* workers;
+  Context context;
+} FileWorker;
+
+static BROTLI_BOOL UseFileWorkers(Context* context) {
+  /* Output written to console would be interleaved. */
+  return TO_BROTLI_BOOL(context->threads > 1 && context->input_count > 1 &&
+                        !context->write_to_stdout);
+}
+
+static void RunFileWorker(void* opaque) {
+  FileWorker* worker = (FileWorker*)opaque;
+  FileWorkers* workers = worker->workers;
+  Context* shared = workers->context;
+  Context* context = &worker->context;
+  for (;;) {
+    BROTLI_BOOL has_next;
+    LockMutex(&workers->mutex);
+    has_next = !workers->failed && NextFile(shared);
+    if (has_next) {
+      context->current_input_path = shared->current_input_path;
+      context->current_output_path = shared->current_output_path;
+      context->input_file_length = shared->input_file_length;
+      if (shared->current_output_path == shared->modified_path) {
+        strcpy(context->modified_path, shared->modified_path);
+        context->current_output_path = context->modified_path;
+      }
+    }
+    UnlockMutex(&workers->mutex);
+    if (!has_next) break;
+    if (!workers->process(context)) {
+      LockMutex(&workers->mutex);
+      workers->failed = BROTLI_TRUE;
+      UnlockMutex(&workers->mutex);
+      break;
+    }
+  }
+}
+
+static BROTLI_BOOL ProcessFilesInParallel(Context* context,
+                                          ProcessFileFunc process) {
+  size_t num_workers = BROTLI_MIN(size_t,
+      (size_t)context->threads, context->input_count);
+  size_t modified_path_len =
+      context->longest_path_len + strlen(context->suffix) + 1;
+  FileWorkers workers;
+  FileWorker* worker =
+      (FileWorker*)calloc(num_workers, sizeof(FileWorker));
+  size_t num_started = 0;
+  size_t i;
+  if (!worker) {
+    fprintf(stderr, "out of memory\n");
+    return BROTLI_FALSE;
+  }
+  InitMutex(&workers.mutex);
+  workers.context = context;
+  workers.process = process;
+  workers.failed = BROTLI_FALSE;
+  for (i = 0; i < num_workers; ++i) {
+    Context* copy = &worker[i].context;
+    *copy = *context;
+    copy->in_worker = BROTLI_TRUE;
+    copy->encoder = NULL;
+    copy->decoder = NULL;
+    copy->fin = NULL;
+    copy->fout = NULL;
+    copy->mapped_input = NULL;
+    copy->async_io = NULL;
+    copy->modified_path = (char*)malloc(modified_path_len);
+    copy->buffer = (uint8_t*)malloc(kFileBufferSize);
+    if (!copy->modified_path || !copy->buffer) {
+      fprintf(stderr, "out of memory\n");
+      workers.failed = BROTLI_TRUE;
+      break;
+    }
+    copy->input = copy->buffer;
+    worker[i].workers = &workers;
+  }
+  if (!workers.failed) {
+    for (num_started = 0; num_started < num_workers; ++num_started) {
+      StartThread(&worker[num_started].thread, RunFileWorker,
+                  &worker[num_started]);
+    }
+  }
+  for (i = 0; i < num_started; ++i) JoinThread(&worker[i].thread);
+  for (i = 0; i < num_workers; ++i) {
+    BrotliEncoderDestroyInstance(worker[i].context.encoder);
+    free(worker[i].context.modified_path);
+    free(worker[i].context.buffer);
+  }
+  free(worker);
+  DestroyMutex(&workers.mutex);
+  return TO_BROTLI_BOOL(!workers.failed);
+}
+
 static void PrintBytes(size_t value) {
   if (value < 1024) {
     fprintf(stderr, "%d B", (int)value);
@@ -1157,12 +2424,69 @@ static void PrintBytes(size_t value) {
   }
 }
 
+/* Encoder stages that took |elapsed| seconds of wall time. */
+static void PrintStageTimes(Context* context, double elapsed) {
+  const double* times = context->stage_timer.times;
+  double other = elapsed - times[BROTLI_ENCODER_STAGE_MATCHING] -
+      times[BROTLI_ENCODER_STAGE_BLOCK_SPLITTING] -
+      times[BROTLI_ENCODER_STAGE_ENTROPY_CODING];
+  fprintf(stderr, "; matching %1.2f sec, block splitting %1.2f sec, "
+          "entropy coding %1.2f sec", times[BROTLI_ENCODER_STAGE_MATCHING],
+          times[BROTLI_ENCODER_STAGE_BLOCK_SPLITTING],
+          times[BROTLI_ENCODER_STAGE_ENTROPY_CODING]);
+  if (context->parallel_stages) {
+    fprintf(stderr, " (summed over threads)");
+  } else {
+    fprintf(stderr, ", I/O and other %1.2f sec", other > 0.0 ? other : 0.0);
+  }
+}
+
 static void PrintFileProcessingProgress(Context* context) {
   fprintf(stderr, "[%s]: ", PrintablePath(context->current_input_path));
   PrintBytes(context->total_in);
   fprintf(stderr, " -> ");
   PrintBytes(context->total_out);
   fprintf(stderr, " in %1.2f sec", (double)(context->end_time - context->start_time) / CLOCKS_PER_SEC);
+  if (!context->decode) {
+    PrintStageTimes(context, WallTime() - context->wall_start_time);
+  }
+}
+
+/* Minimal interval between progress reports, in seconds. */
+#define PROGRESS_INTERVAL 5.0
+
+/* Periodic report of long-running job in verbose mode: throughput (of
+   uncompressed data), ratio, ETA (if input size is known) and time spent
+   in encoder stages. */
+static void ReportProgress(Context* context) {
+  double now = WallTime();
+  double elapsed = now - context->wall_start_time;
+  size_t raw_size =
+      context->decode ? context->total_out : context->total_in;
+  size_t compressed_size =
+      context->decode ? context->total_in : context->total_out;
+  if (now - context->progress_time < PROGRESS_INTERVAL) return;
+  context->progress_time = now;
+  fprintf(stderr, "%s [%s]: ",
+          context->decode ? "Decompressing" : "Compressing",
+          PrintablePath(context->current_input_path));
+  PrintBytes(context->total_in);
+  fprintf(stderr, " -> ");
+  PrintBytes(context->total_out);
+  fprintf(stderr, ", %1.2f MiB/s", (double)raw_size / 1048576.0 / elapsed);
+  if (compressed_size > 0) {
+    fprintf(stderr, ", ratio %1.3f",
+            (double)raw_size / (double)compressed_size);
+  }
+  if (context->input_file_length > 0 && context->total_in > 0 &&
+      (uint64_t)context->input_file_length >= context->total_in) {
+    double done = (double)context->total_in /
+        (double)context->input_file_length;
+    fprintf(stderr, ", %1.0f%% done, ETA %1.0f sec", 100.0 * done,
+            elapsed * (1.0 - done) / done);
+  }
+  if (!context->decode) PrintStageTimes(context, elapsed);
+  fprintf(stderr, "\n");
 }
 
 static const char* PrettyDecoderErrorString(BrotliDecoderErrorCode code) {
@@ -1181,6 +2505,156 @@ static const char* PrettyDecoderErrorString(BrotliDecoderErrorCode code) {
   return error_str;
 }
 
+/* Seekable format (--seekable): input is cut into chunks that are compressed
+   as separate streams, so that each chunk could be decoded alone; the file is
+   a sequence of concatenated streams. The last stream has no data, but
+   a metadata block with the index: compressed and decompressed size of each
+   chunk, then the number of chunks and magic (4 bytes each, little-endian).
+   Index stream is composed here bit by bit; its layout is fixed, so the
+   index is found from the end of file. */
+#define SEEK_ENTRY_SIZE 8
+#define SEEK_FOOTER_SIZE 8
+/* Metadata block size limit. */
+#define MAX_SEEK_INDEX_SIZE (1u << 24)
+#define MAX_SEEK_CHUNKS \
+    ((MAX_SEEK_INDEX_SIZE - SEEK_FOOTER_SIZE) / SEEK_ENTRY_SIZE)
+
+/* ISLAST and ISLASTEMPTY bits of the last (empty) metablock. */
+static const uint8_t kSeekIndexEnd = 3;
+static const uint8_t kSeekIndexMagic[4] = {'B', 'r', 'S', 'k'};
+
+typedef struct SeekIndex {
+  uint8_t* data;  /* Entries, then footer. */
+  size_t size;
+  size_t capacity;
+  uint32_t num_chunks;
+  /* Set by ReadSeekIndex. */
+  uint64_t decompressed_size;
+} SeekIndex;
+
+static void StoreLE32(uint8_t* p, uint32_t value) {
+  p[0] = (uint8_t)value;
+  p[1] = (uint8_t)(value >> 8);
+  p[2] = (uint8_t)(value >> 16);
+  p[3] = (uint8_t)(value >> 24);
+}
+
+static uint32_t LoadLE32(const uint8_t* p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) |
+      ((uint32_t)p[3] << 24);
+}
+
+/* Composes header of index stream: WBITS (16), ISLAST (0), MNIBBLES (0),
+   reserved bit, MSKIPBYTES, MSKIPLEN - 1 and padding. Returns header size
+   (at most 4 bytes). */
+static size_t SeekIndexHeader(size_t index_size, uint8_t* header) {
+  uint32_t skip_len = (uint32_t)index_size - 1;
+  uint32_t skip_bytes = 1;
+  uint32_t bits;
+  size_t size;
+  size_t i;
+  while (skip_bytes < 3 && (skip_len >> (8 * skip_bytes)) != 0) skip_bytes++;
+  bits = (3u << 2) | (skip_bytes << 5) | (skip_len << 7);
+  size = (7 + 8 * skip_bytes + 7) / 8;
+  for (i = 0; i < size; ++i) header[i] = (uint8_t)(bits >> (8 * i));
+  return size;
+}
+
+static BROTLI_BOOL AddSeekIndexEntry(SeekIndex* index,
+    size_t compressed_size, size_t size) {
+  if (index->num_chunks == MAX_SEEK_CHUNKS) {
+    fprintf(stderr, "too many chunks for seekable index\n");
+    return BROTLI_FALSE;
+  }
+  /* Footer is reserved as well. */
+  if (index->size + SEEK_ENTRY_SIZE + SEEK_FOOTER_SIZE > index->capacity) {
+    size_t capacity = index->capacity ? 2 * index->capacity : 1024;
+    uint8_t* data = (uint8_t*)realloc(index->data, capacity);
+    if (!data) {
+      fprintf(stderr, "out of memory\n");
+      return BROTLI_FALSE;
+    }
+    index->data = data;
+    index->capacity = capacity;
+  }
+  StoreLE32(index->data + index->size, (uint32_t)compressed_size);
+  StoreLE32(index->data + index->size + 4, (uint32_t)size);
+  index->size += SEEK_ENTRY_SIZE;
+  index->num_chunks++;
+  return BROTLI_TRUE;
+}
+
+static BROTLI_BOOL WriteSeekIndex(Context* context, SeekIndex* index) {
+  uint8_t header[4];
+  size_t header_size;
+  StoreLE32(index->data + index->size, index->num_chunks);
+  memcpy(index->data + index->size + 4, kSeekIndexMagic, 4);
+  index->size += SEEK_FOOTER_SIZE;
+  header_size = SeekIndexHeader(index->size, header);
+  return TO_BROTLI_BOOL(WriteOutput(context, header, header_size) &&
+      WriteOutput(context, index->data, index->size) &&
+      WriteOutput(context, &kSeekIndexEnd, 1));
+}
+
+static BROTLI_BOOL ReadAt(FILE* f, uint64_t offset, uint8_t* data,
+                          size_t size) {
+  if (!SeekFile(f, offset)) return BROTLI_FALSE;
+  return TO_BROTLI_BOOL(fread(data, 1, size, f) == size);
+}
+
+/* Reads index of seekable file; only footer is checked, if |index| is NULL.
+   Returns BROTLI_FALSE, if file is not seekable. Changes file position. */
+static BROTLI_BOOL ReadSeekIndex(FILE* fin, SeekIndex* index) {
+  uint8_t footer[SEEK_FOOTER_SIZE + 1];
+  uint8_t header[4];
+  uint8_t expected_header[4];
+  size_t header_size;
+  size_t index_size;
+  int64_t end = SeekFileEnd(fin);
+  uint64_t file_size;
+  uint64_t chunks_size = 0;
+  uint64_t decompressed_size = 0;
+  uint32_t num_chunks;
+  uint32_t i;
+  if (end < 0) return BROTLI_FALSE;
+  file_size = (uint64_t)end;
+  if (file_size < sizeof(footer) ||
+      !ReadAt(fin, file_size - sizeof(footer), footer, sizeof(footer))) {
+    return BROTLI_FALSE;
+  }
+  if (footer[SEEK_FOOTER_SIZE] != kSeekIndexEnd) return BROTLI_FALSE;
+  if (memcmp(footer + 4, kSeekIndexMagic, 4) != 0) return BROTLI_FALSE;
+  num_chunks = LoadLE32(footer);
+  if (num_chunks == 0 || num_chunks > MAX_SEEK_CHUNKS) return BROTLI_FALSE;
+  index_size = num_chunks * SEEK_ENTRY_SIZE + SEEK_FOOTER_SIZE;
+  header_size = SeekIndexHeader(index_size, expected_header);
+  if (file_size < header_size + index_size + 1) return BROTLI_FALSE;
+  chunks_size = file_size - (header_size + index_size + 1);
+  if (!ReadAt(fin, chunks_size, header, header_size) ||
+      memcmp(header, expected_header, header_size) != 0) {
+    return BROTLI_FALSE;
+  }
+  if (!index) return BROTLI_TRUE;
+
+  index->data = (uint8_t*)malloc(index_size);
+  if (!index->data) return BROTLI_FALSE;
+  index->size = index_size;
+  index->capacity = index_size;
+  index->num_chunks = num_chunks;
+  if (!ReadAt(fin, chunks_size + header_size, index->data, index_size)) {
+    return BROTLI_FALSE;
+  }
+  /* Chunks should exactly fill the rest of file. */
+  for (i = 0; i < num_chunks; ++i) {
+    uint32_t compressed_size = LoadLE32(index->data + i * SEEK_ENTRY_SIZE);
+    if (compressed_size > chunks_size) return BROTLI_FALSE;
+    chunks_size -= compressed_size;
+    decompressed_size += LoadLE32(index->data + i * SEEK_ENTRY_SIZE + 4);
+  }
+  index->decompressed_size = decompressed_size;
+  return TO_BROTLI_BOOL(chunks_size == 0);
+}
+
 static void OnMetadataStart(void* opaque, size_t size) {
   Context* context = (Context*) opaque;
   if (context->comment_state == COMMENT_INIT) {
@@ -1213,21 +2687,26 @@ static void OnMetadataChunk(void* opaque, const uint8_t* data, size_t size) {
   }
 }
 
-static BROTLI_BOOL InitDecoder(Context* context) {
-  context->decoder = BrotliDecoderCreateInstance(NULL, NULL, NULL);
-  if (!context->decoder) {
-    fprintf(stderr, "out of memory\n");
-    return BROTLI_FALSE;
-  }
+/* Returns NULL, if memory is exhausted. */
+static BrotliDecoderState* CreateDecoder(Context* context) {
+  BrotliDecoderState* s = BrotliDecoderCreateInstance(NULL, NULL, NULL);
+  if (!s) return NULL;
   /* This allows decoding "large-window" streams. Though it creates
       fragmentation (new builds decode streams that old builds don't),
       it is better from used experience perspective. */
-  BrotliDecoderSetParameter(
-      context->decoder, BROTLI_DECODER_PARAM_LARGE_WINDOW, 1u);
+  BrotliDecoderSetParameter(s, BROTLI_DECODER_PARAM_LARGE_WINDOW, 1u);
   if (context->dictionary) {
-    BrotliDecoderAttachDictionary(context->decoder,
-        BROTLI_SHARED_DICTIONARY_RAW, context->dictionary_size,
-        context->dictionary);
+    BrotliDecoderAttachDictionary(s, context->dictionary_type,
+        context->dictionary_size, context->dictionary);
+  }
+  return s;
+}
+
+static BROTLI_BOOL InitDecoder(Context* context) {
+  context->decoder = CreateDecoder(context);
+  if (!context->decoder) {
+    fprintf(stderr, "out of memory\n");
+    return BROTLI_FALSE;
   }
   return BROTLI_TRUE;
 }
@@ -1235,6 +2714,7 @@ static BROTLI_BOOL InitDecoder(Context* context) {
 static BROTLI_BOOL DecompressFile(Context* context) {
   BrotliDecoderState* s = context->decoder;
   BrotliDecoderResult result = BROTLI_DECODER_RESULT_NEEDS_MORE_INPUT;
+  size_t available_out;
   if (context->comment_len) {
     context->comment_state = COMMENT_INIT;
     BrotliDecoderSetMetadataCallbacks(s, &OnMetadataStart, &OnMetadataChunk,
@@ -1265,12 +2745,18 @@ static BROTLI_BOOL DecompressFile(Context* context) {
       }
       if (!ProvideInput(context)) return BROTLI_FALSE;
     } else if (result == BROTLI_DECODER_RESULT_NEEDS_MORE_OUTPUT) {
-      if (!ProvideOutput(context)) return BROTLI_FALSE;
+      if (!WriteDecoderOutput(context, s)) return BROTLI_FALSE;
     } else if (result == BROTLI_DECODER_RESULT_SUCCESS) {
-      if (!FlushOutput(context)) return BROTLI_FALSE;
+      if (!WriteDecoderOutput(context, s)) return BROTLI_FALSE;
       BROTLI_BOOL has_more_input = (context->available_in != 0);
       int extra_char = EOF;
-      if (!has_more_input) {
+      if (!has_more_input && context->mapped_input) {
+        has_more_input = TO_BROTLI_BOOL(
+            context->total_in < context->mapped_input_size);
+      } else if (!has_more_input && context->async_io) {
+        if (!ProvideInputAsync(context)) return BROTLI_FALSE;
+        has_more_input = (context->available_in != 0);
+      } else if (!has_more_input) {
         extra_char = fgetc(context->fin);
         if (extra_char != EOF) {
           has_more_input = BROTLI_TRUE;
@@ -1280,11 +2766,10 @@ static BROTLI_BOOL DecompressFile(Context* context) {
         }
       }
       if (has_more_input) {
-        if (context->allow_concatenated) {
+        if (context->allow_concatenated || context->seekable_input) {
           if (context->verbosity > 0) {
             fprintf(stderr, "extra input\n");
           }
-          if (!ProvideOutput(context)) return BROTLI_FALSE;
           BrotliDecoderDestroyInstance(context->decoder);
           context->decoder = NULL;
           if (!InitDecoder(context)) return BROTLI_FALSE;
@@ -1298,6 +2783,7 @@ static BROTLI_BOOL DecompressFile(Context* context) {
           return BROTLI_FALSE;
         }
       } else {
+        if (!FlushOutput(context)) return BROTLI_FALSE;
         if (context->verbosity > 0) {
           context->end_time = clock();
           fprintf(stderr, "Decompressed ");
@@ -1326,67 +2812,423 @@ static BROTLI_BOOL DecompressFile(Context* context) {
       return BROTLI_FALSE;
     }
 
+    if (context->verbosity > 0) ReportProgress(context);
+    available_out = 0;
     result = BrotliDecoderDecompressStream(s, &context->available_in,
-        &context->next_in, &context->available_out, &context->next_out, 0);
+        &context->next_in, &available_out, NULL, 0);
   }
 }
 
-static BROTLI_BOOL DecompressFiles(Context* context) {
-  while (NextFile(context)) {
-    BROTLI_BOOL is_ok = BROTLI_TRUE;
-    BROTLI_BOOL rm_input = BROTLI_FALSE;
-    BROTLI_BOOL rm_output = BROTLI_TRUE;
-    if (!InitDecoder(context)) return BROTLI_FALSE;
-    is_ok = OpenFiles(context);
-    if (is_ok && !context->current_input_path &&
-        !context->force_overwrite && isatty(STDIN_FILENO)) {
-      fprintf(stderr, "Use -h help. Use -f to force input from a terminal.\n");
-      is_ok = BROTLI_FALSE;
+/* Writes decompressed bytes [skip, end) of chunk; the rest of chunk is not
+   decoded. */
+static BROTLI_BOOL DecompressChunk(Context* context, const uint8_t* data,
+    size_t size, size_t skip, size_t end) {
+  BrotliDecoderState* s;
+  BrotliDecoderResult result;
+  size_t pos = 0;
+  if (context->decoder) BrotliDecoderDestroyInstance(context->decoder);
+  context->decoder = NULL;
+  if (!InitDecoder(context)) return BROTLI_FALSE;
+  s = context->decoder;
+  for (;;) {
+    size_t available_out = 0;
+    result = BrotliDecoderDecompressStream(s, &size, &data, &available_out,
+                                           NULL, NULL);
+    while (pos < end && BrotliDecoderHasMoreOutput(s)) {
+      size_t out_size = 0;
+      const uint8_t* out = BrotliDecoderTakeOutput(s, &out_size);
+      size_t from = BROTLI_MAX(size_t, pos, skip);
+      size_t to = BROTLI_MIN(size_t, pos + out_size, end);
+      if (from < to && !WriteOutput(context, out + (from - pos), to - from)) {
+        return BROTLI_FALSE;
+      }
+      pos += out_size;
     }
-    if (is_ok) is_ok = DecompressFile(context);
-    if (context->decoder) BrotliDecoderDestroyInstance(context->decoder);
-    context->decoder = NULL;
-    rm_output = !is_ok;
-    rm_input = !rm_output && context->junk_source;
-    if (!CloseFiles(context, rm_input, rm_output)) is_ok = BROTLI_FALSE;
-    if (!is_ok) return BROTLI_FALSE;
+    if (pos >= end) return BROTLI_TRUE;
+    if (result != BROTLI_DECODER_RESULT_NEEDS_MORE_OUTPUT) break;
   }
-  return BROTLI_TRUE;
+  fprintf(stderr, "corrupt input [%s]\n",
+          PrintablePath(context->current_input_path));
+  if (context->verbosity > 0) {
+    if (result == BROTLI_DECODER_RESULT_ERROR) {
+      BrotliDecoderErrorCode error = BrotliDecoderGetErrorCode(s);
+      const char* error_str = PrettyDecoderErrorString(error);
+      fprintf(stderr, "reason: %s (%d)\n", error_str, error);
+    } else {
+      fprintf(stderr, "reason: chunk is shorter than indexed\n");
+    }
+  }
+  return BROTLI_FALSE;
 }
 
-static BROTLI_BOOL CompressFile(Context* context, BrotliEncoderState* s) {
-  BROTLI_BOOL is_eof = BROTLI_FALSE;
-  BROTLI_BOOL prologue = !!context->comment_len;
+/* Decompresses --range of seekable input; only chunks that overlap with
+   range are read and decoded. */
+static BROTLI_BOOL DecompressRange(Context* context) {
+  SeekIndex index = {NULL, 0, 0, 0, 0};
+  uint8_t* buffer = NULL;
+  size_t buffer_size = 0;
+  uint64_t position = 0;  /* Chunk offset in file. */
+  uint64_t start = 0;  /* Chunk offset in decompressed data. */
+  uint64_t range_end;
+  uint32_t i;
+  BROTLI_BOOL is_ok = BROTLI_TRUE;
   InitializeBuffers(context);
-  for (;;) {
-    if (context->available_in == 0 && !is_eof) {
-      if (!ProvideInput(context)) return BROTLI_FALSE;
-      is_eof = !HasMoreInput(context);
+  if (!context->current_input_path || !ReadSeekIndex(context->fin, &index)) {
+    fprintf(stderr, "not a seekable file [%s]\n",
+            PrintablePath(context->current_input_path));
+    free(index.data);
+    return BROTLI_FALSE;
+  }
+  if (context->range_offset > index.decompressed_size) {
+    fprintf(stderr, "range is out of file bounds [%s]\n",
+            PrintablePath(context->current_input_path));
+    free(index.data);
+    return BROTLI_FALSE;
+  }
+  range_end = index.decompressed_size;
+  if (context->range_length < range_end - context->range_offset) {
+    range_end = context->range_offset + context->range_length;
+  }
+  for (i = 0; is_ok && i < index.num_chunks && start < range_end; ++i) {
+    size_t compressed_size = LoadLE32(index.data + i * SEEK_ENTRY_SIZE);
+    size_t size = LoadLE32(index.data + i * SEEK_ENTRY_SIZE + 4);
+    if (start + size > context->range_offset) {
+      const uint8_t* data = NULL;
+      size_t skip = (context->range_offset > start) ?
+          (size_t)(context->range_offset - start) : 0;
+      size_t end = (range_end - start < size) ?
+          (size_t)(range_end - start) : size;
+      if (context->mapped_input) {
+        data = context->mapped_input + (size_t)position;
+      } else {
+        if (compressed_size > buffer_size) {
+          free(buffer);
+          buffer = (uint8_t*)malloc(compressed_size);
+          buffer_size = buffer ? compressed_size : 0;
+        }
+        if (!buffer) {
+          fprintf(stderr, "out of memory\n");
+          is_ok = BROTLI_FALSE;
+        } else if (!ReadAt(context->fin, position, buffer, compressed_size)) {
+          fprintf(stderr, "failed to read input [%s]: %s\n",
+                  PrintablePath(context->current_input_path),
+                  strerror(errno));
+          is_ok = BROTLI_FALSE;
+        }
+        data = buffer;
+      }
+      context->total_in += compressed_size;
+      if (is_ok) {
+        is_ok = DecompressChunk(context, data, compressed_size, skip, end);
+      }
     }
+    start += size;
+    position += compressed_size;
+  }
+  free(buffer);
+  free(index.data);
+  if (is_ok) is_ok = FlushOutput(context);
+  if (is_ok && context->verbosity > 0) {
+    context->end_time = clock();
+    fprintf(stderr, "Decompressed ");
+    PrintFileProcessingProgress(context);
+    fprintf(stderr, "\n");
+  }
+  return is_ok;
+}
 
-    if (prologue) {
-      prologue = BROTLI_FALSE;
-      const uint8_t* next_meta = context->comment;
-      size_t available_meta = context->comment_len;
-      if (!BrotliEncoderCompressStream(s,
-          BROTLI_OPERATION_EMIT_METADATA,
-          &available_meta, &next_meta,
-          &context->available_out, &context->next_out, NULL)) {
-        /* Should detect OOM? */
-        fprintf(stderr, "failed to emit metadata [%s]\n",
-                PrintablePath(context->current_input_path));
+/* Parallel decoding of seekable input (with -T / --threads): streams are
+   decoded by separate decoders; output is written in input order. Stream
+   boundaries are taken from the index; in general case they are known only
+   after the preceding stream is decoded. Each job holds a whole chunk of
+   input and output; at most |context->threads| chunks are kept in memory.
+   Index is not trusted with allocation: output buffer grows while stream
+   produces data, up to the indexed size. */
+typedef struct DecompressionJob {
+  Thread thread;
+  BrotliDecoderState* decoder;
+  uint8_t* buffer;  /* NULL, if input is memory-mapped. */
+  size_t buffer_capacity;
+  const uint8_t* input;
+  size_t input_size;
+  uint8_t* output;
+  size_t output_capacity;
+  size_t output_size;  /* As indexed. */
+  BrotliDecoderResult result;
+  BROTLI_BOOL is_oom;
+  BROTLI_BOOL is_ok;
+} DecompressionJob;
+
+static BROTLI_BOOL UseParallelDecoding(Context* context) {
+  /* Comment is checked only by sequential decoder. */
+  return TO_BROTLI_BOOL(context->threads > 1 && !context->in_worker &&
+      !context->range_set && !context->comment_len &&
+      context->current_input_path);
+}
+
+static void DecompressChunkJob(void* opaque) {
+  DecompressionJob* job = (DecompressionJob*)opaque;
+  const uint8_t* next_in = job->input;
+  size_t available_in = job->input_size;
+  uint8_t* next_out = job->output;
+  size_t available_out = job->output_capacity;
+  size_t used;
+  job->is_oom = BROTLI_FALSE;
+  while (BROTLI_TRUE) {
+    size_t capacity;
+    uint8_t* output;
+    job->result = BrotliDecoderDecompressStream(job->decoder, &available_in,
+        &next_in, &available_out, &next_out, NULL);
+    if (job->result != BROTLI_DECODER_RESULT_NEEDS_MORE_OUTPUT) break;
+    /* Stream is longer than indexed. */
+    if (job->output_capacity >= job->output_size) break;
+    used = (size_t)(next_out - job->output);
+    capacity = job->output_capacity < job->output_size / 2 ?
+        2 * job->output_capacity : job->output_size;
+    output = (uint8_t*)realloc(job->output, capacity);
+    if (!output) {
+      job->is_oom = BROTLI_TRUE;
+      break;
+    }
+    job->output = output;
+    job->output_capacity = capacity;
+    next_out = output + used;
+    available_out = capacity - used;
+  }
+  used = (size_t)(next_out - job->output);
+  /* Stream should exactly fill the chunk. */
+  job->is_ok = TO_BROTLI_BOOL(job->result == BROTLI_DECODER_RESULT_SUCCESS &&
+      available_in == 0 && used == job->output_size);
+}
+
+static void FinishDecompressionJob(DecompressionJob* job) {
+  JoinThread(&job->thread);
+  BrotliDecoderDestroyInstance(job->decoder);
+  job->decoder = NULL;
+}
+
+/* Reads the next chunk and starts its decoding. */
+static BROTLI_BOOL StartChunkDecompression(Context* context,
+    DecompressionJob* job, size_t compressed_size, size_t size) {
+  if (context->mapped_input) {
+    job->input = context->mapped_input + context->total_in;
+  } else {
+    if (compressed_size > job->buffer_capacity) {
+      free(job->buffer);
+      job->buffer = (uint8_t*)malloc(compressed_size);
+      job->buffer_capacity = job->buffer ? compressed_size : 0;
+      if (!job->buffer) {
+        fprintf(stderr, "out of memory\n");
         return BROTLI_FALSE;
       }
-      if (available_meta != 0) {
-        fprintf(stderr, "failed to emit metadata [%s]\n",
-                PrintablePath(context->current_input_path));
-        return BROTLI_FALSE;
+    }
+    if (fread(job->buffer, 1, compressed_size, context->fin) !=
+        compressed_size) {
+      fprintf(stderr, "failed to read input [%s]: %s\n",
+              PrintablePath(context->current_input_path), strerror(errno));
+      return BROTLI_FALSE;
+    }
+    job->input = job->buffer;
+  }
+  job->input_size = compressed_size;
+  context->total_in += compressed_size;
+  /* Buffer is grown by decoding thread, if chunk is bigger. */
+  if (!job->output) {
+    job->output_capacity = BROTLI_MAX(size_t, 1,
+        BROTLI_MIN(size_t, size, kFileBufferSize));
+    job->output = (uint8_t*)malloc(job->output_capacity);
+    if (!job->output) {
+      job->output_capacity = 0;
+      fprintf(stderr, "out of memory\n");
+      return BROTLI_FALSE;
+    }
+  }
+  job->output_size = size;
+  job->decoder = CreateDecoder(context);
+  if (!job->decoder) {
+    fprintf(stderr, "out of memory\n");
+    return BROTLI_FALSE;
+  }
+  StartThread(&job->thread, DecompressChunkJob, job);
+  return BROTLI_TRUE;
+}
+
+static BROTLI_BOOL DecompressFileThreaded(Context* context,
+                                          const SeekIndex* index) {
+  size_t num_jobs = (size_t)context->threads;
+  DecompressionJob* jobs;
+  size_t first = 0;
+  size_t num_running = 0;
+  uint32_t next_chunk = 0;
+  uint32_t i;
+  uint8_t header[4];
+  BROTLI_BOOL is_ok = BROTLI_TRUE;
+  /* Encoder does not produce bigger chunks; index is damaged, so decode
+     input as concatenated streams. */
+  for (i = 0; i < index->num_chunks; ++i) {
+    if (LoadLE32(index->data + i * SEEK_ENTRY_SIZE + 4) >
+        MAX_SEEKABLE_CHUNK_SIZE) {
+      return DecompressFile(context);
+    }
+  }
+  jobs = (DecompressionJob*)calloc(num_jobs, sizeof(DecompressionJob));
+  if (!jobs) {
+    fprintf(stderr, "out of memory\n");
+    return BROTLI_FALSE;
+  }
+  InitializeBuffers(context);
+
+  while (is_ok) {
+    DecompressionJob* job;
+    while (next_chunk < index->num_chunks && num_running < num_jobs) {
+      const uint8_t* entry = index->data + next_chunk * SEEK_ENTRY_SIZE;
+      job = &jobs[(first + num_running) % num_jobs];
+      is_ok = StartChunkDecompression(context, job, LoadLE32(entry),
+                                      LoadLE32(entry + 4));
+      if (!is_ok) break;
+      next_chunk++;
+      num_running++;
+    }
+    if (!is_ok || num_running == 0) break;
+    job = &jobs[first];
+    JoinThread(&job->thread);
+    first = (first + 1) % num_jobs;
+    num_running--;
+    if (job->is_oom) {
+      fprintf(stderr, "out of memory\n");
+      is_ok = BROTLI_FALSE;
+    } else if (!job->is_ok) {
+      fprintf(stderr, "corrupt input [%s]\n",
+              PrintablePath(context->current_input_path));
+      if (context->verbosity > 0) {
+        if (job->result == BROTLI_DECODER_RESULT_ERROR) {
+          BrotliDecoderErrorCode error =
+              BrotliDecoderGetErrorCode(job->decoder);
+          const char* error_str = PrettyDecoderErrorString(error);
+          fprintf(stderr, "reason: %s (%d)\n", error_str, error);
+        } else {
+          fprintf(stderr, "reason: chunk does not match index\n");
+        }
+      }
+      is_ok = BROTLI_FALSE;
+    }
+    BrotliDecoderDestroyInstance(job->decoder);
+    job->decoder = NULL;
+    if (!is_ok) break;
+    is_ok = WriteOutput(context, job->output, job->output_size);
+    if (context->verbosity > 0) ReportProgress(context);
+  }
+
+  /* Wait for the jobs started before the failure. */
+  while (num_running > 0) {
+    FinishDecompressionJob(&jobs[first]);
+    first = (first + 1) % num_jobs;
+    num_running--;
+  }
+  for (i = 0; i < num_jobs; ++i) {
+    free(jobs[i].buffer);
+    free(jobs[i].output);
+  }
+  free(jobs);
+
+  /* Index stream carries no data. */
+  context->total_in += SeekIndexHeader(index->size, header) + index->size + 1;
+  if (is_ok) is_ok = FlushOutput(context);
+  if (is_ok && context->verbosity > 0) {
+    context->end_time = clock();
+    fprintf(stderr, "Decompressed ");
+    PrintFileProcessingProgress(context);
+    fprintf(stderr, "\n");
+  }
+  return is_ok;
+}
+
+static BROTLI_BOOL DecompressCurrentFile(Context* context) {
+  BROTLI_BOOL is_ok = BROTLI_TRUE;
+  BROTLI_BOOL rm_input = BROTLI_FALSE;
+  BROTLI_BOOL rm_output = BROTLI_TRUE;
+  SeekIndex index = {NULL, 0, 0, 0, 0};
+  BROTLI_BOOL parallel = UseParallelDecoding(context);
+  if (!InitDecoder(context)) return BROTLI_FALSE;
+  is_ok = OpenFiles(context);
+  if (is_ok && !context->current_input_path &&
+      !context->force_overwrite && isatty(STDIN_FILENO)) {
+    fprintf(stderr, "Use -h help. Use -f to force input from a terminal.\n");
+    is_ok = BROTLI_FALSE;
+  }
+  context->seekable_input = BROTLI_FALSE;
+  if (is_ok && context->current_input_path && !context->range_set) {
+    /* Seekable files are decoded as concatenated streams. */
+    if (SeekFileEnd(context->fin) >= 0) {
+      context->seekable_input =
+          ReadSeekIndex(context->fin, parallel ? &index : NULL);
+      if (fseek(context->fin, 0, SEEK_SET) != 0) {
+        fprintf(stderr, "failed to read input [%s]: %s\n",
+                PrintablePath(context->current_input_path), strerror(errno));
+        is_ok = BROTLI_FALSE;
+      }
+    }
+  }
+  if (is_ok && context->range_set) {
+    is_ok = DecompressRange(context);
+  } else if (is_ok && parallel && context->seekable_input &&
+             index.num_chunks > 1) {
+    is_ok = DecompressFileThreaded(context, &index);
+  } else if (is_ok) {
+    is_ok = DecompressFile(context);
+  }
+  free(index.data);
+  if (context->decoder) BrotliDecoderDestroyInstance(context->decoder);
+  context->decoder = NULL;
+  rm_output = !is_ok;
+  rm_input = !rm_output && context->junk_source;
+  if (!CloseFiles(context, rm_input, rm_output)) is_ok = BROTLI_FALSE;
+  return is_ok;
+}
+
+static BROTLI_BOOL DecompressFiles(Context* context) {
+  if (UseFileWorkers(context)) {
+    return ProcessFilesInParallel(context, DecompressCurrentFile);
+  }
+  while (NextFile(context)) {
+    if (!DecompressCurrentFile(context)) return BROTLI_FALSE;
+  }
+  return BROTLI_TRUE;
+}
+
+static BROTLI_BOOL CompressFile(Context* context, BrotliEncoderState* s) {
+  BROTLI_BOOL is_eof = BROTLI_FALSE;
+  BROTLI_BOOL prologue = !!context->comment_len;
+  size_t available_out = 0;
+  InitializeBuffers(context);
+  for (;;) {
+    if (context->available_in == 0 && !is_eof) {
+      if (!ProvideInput(context)) return BROTLI_FALSE;
+      is_eof = !HasMoreInput(context);
+    }
+
+    if (prologue) {
+      const uint8_t* next_meta = context->comment;
+      size_t available_meta = context->comment_len;
+      prologue = BROTLI_FALSE;
+      /* Metadata workflow is over when neither input nor output is left. */
+      for (;;) {
+        if (!BrotliEncoderCompressStream(s,
+            BROTLI_OPERATION_EMIT_METADATA,
+            &available_meta, &next_meta, &available_out, NULL, NULL)) {
+          /* Should detect OOM? */
+          fprintf(stderr, "failed to emit metadata [%s]\n",
+                  PrintablePath(context->current_input_path));
+          return BROTLI_FALSE;
+        }
+        if (available_meta == 0 && !BrotliEncoderHasMoreOutput(s)) break;
+        if (!WriteEncoderOutput(context, s)) return BROTLI_FALSE;
       }
     } else {
       if (!BrotliEncoderCompressStream(s,
           is_eof ? BROTLI_OPERATION_FINISH : BROTLI_OPERATION_PROCESS,
           &context->available_in, &context->next_in,
-          &context->available_out, &context->next_out, NULL)) {
+          &available_out, NULL, NULL)) {
         /* Should detect OOM? */
         fprintf(stderr, "failed to compress data [%s]\n",
                 PrintablePath(context->current_input_path));
@@ -1394,9 +3236,8 @@ static BROTLI_BOOL CompressFile(Context* context, BrotliEncoderState* s) {
       }
     }
 
-    if (context->available_out == 0) {
-      if (!ProvideOutput(context)) return BROTLI_FALSE;
-    }
+    if (!WriteEncoderOutput(context, s)) return BROTLI_FALSE;
+    if (context->verbosity > 0) ReportProgress(context);
 
     if (BrotliEncoderIsFinished(s)) {
       if (!FlushOutput(context)) return BROTLI_FALSE;
@@ -1411,72 +3252,1170 @@ static BROTLI_BOOL CompressFile(Context* context, BrotliEncoderState* s) {
   }
 }
 
-static BROTLI_BOOL CompressFiles(Context* context) {
-  while (NextFile(context)) {
-    BROTLI_BOOL is_ok = BROTLI_TRUE;
-    BROTLI_BOOL rm_input = BROTLI_FALSE;
-    BROTLI_BOOL rm_output = BROTLI_TRUE;
-    BrotliEncoderState* s = BrotliEncoderCreateInstance(NULL, NULL, NULL);
+/* Returns window size used when it is not specified by user. */
+static uint32_t AutoLgwin(int64_t input_length) {
+  uint32_t lgwin = DEFAULT_LGWIN;
+  /* Use file size to limit lgwin. */
+  if (input_length >= 0) {
+    lgwin = BROTLI_MIN_WINDOW_BITS;
+    while (BROTLI_MAX_BACKWARD_LIMIT(lgwin) < (uint64_t)input_length) {
+      lgwin++;
+      if (lgwin == BROTLI_MAX_WINDOW_BITS) break;
+    }
+  }
+  return lgwin;
+}
+
+static void SetEncoderParameters(Context* context, BrotliEncoderState* s) {
+  int64_t input_length = context->input_file_length;
+  /* In seekable mode each chunk is a separate stream. */
+  if (context->seekable_chunk_size && (input_length < 0 ||
+      (uint64_t)input_length > context->seekable_chunk_size)) {
+    input_length = (int64_t)context->seekable_chunk_size;
+  }
+  BrotliEncoderSetParameter(s,
+      BROTLI_PARAM_QUALITY, (uint32_t)context->quality);
+  if (context->simd_hasher >= 0) {
+    BrotliEncoderSetParameter(s,
+        BROTLI_PARAM_SIMD_HASHER, (uint32_t)context->simd_hasher);
+  }
+  if (context->lgwin > 0) {
+    /* Specified by user. */
+    /* Do not enable "large-window" extension, if not required. */
+    if (context->lgwin > BROTLI_MAX_WINDOW_BITS) {
+      BrotliEncoderSetParameter(s, BROTLI_PARAM_LARGE_WINDOW, 1u);
+    }
+    BrotliEncoderSetParameter(s,
+        BROTLI_PARAM_LGWIN, (uint32_t)context->lgwin);
+  } else {
+    /* 0, or not specified by user; could be chosen by compressor. */
+    BrotliEncoderSetParameter(s, BROTLI_PARAM_LGWIN, AutoLgwin(input_length));
+  }
+  if (input_length > 0) {
+    uint32_t size_hint = input_length < (1 << 30) ?
+        (uint32_t)input_length : (1u << 30);
+    BrotliEncoderSetParameter(s, BROTLI_PARAM_SIZE_HINT, size_hint);
+  }
+}
+
+/* Multi-threaded compression: input is cut into chunks that are compressed
+   independently; the first chunk produces stream header, the others are
+   encoded with BROTLI_PARAM_STREAM_OFFSET. All chunks, except the last one,
+   are flushed, so that the compressed pieces could be simply concatenated.
+   In seekable mode every chunk is a separate stream. */
+typedef struct CompressionJob {
+  Thread thread;
+  BrotliEncoderState* encoder;
+  /* Comment to be embedded; only in the first chunk. */
+  const uint8_t* comment;
+  size_t comment_len;
+  uint8_t* buffer;  /* NULL, if input is memory-mapped. */
+  const uint8_t* input;
+  size_t input_size;
+  BROTLI_BOOL is_last;
+  BROTLI_BOOL finish;  /* Chunk ends the stream. */
+  uint8_t* output;
+  size_t output_capacity;
+  size_t output_size;
+  StageTimer stage_timer;  /* Used in verbose mode. */
+  BROTLI_BOOL is_ok;
+} CompressionJob;
+
+/* Chunk size does not depend on the number of threads; so does the output. */
+static size_t ChunkSize(Context* context) {
+  int lgwin;
+  if (context->seekable_chunk_size) return context->seekable_chunk_size;
+  lgwin = context->lgwin > 0 ? context->lgwin : DEFAULT_LGWIN;
+  return (size_t)1 << BROTLI_MIN(int, lgwin, MAX_CHUNK_LGSIZE);
+}
+
+static BROTLI_BOOL GrowJobOutput(CompressionJob* job) {
+  size_t capacity = job->output_capacity * 2;
+  uint8_t* output = (uint8_t*)realloc(job->output, capacity);
+  if (!output) return BROTLI_FALSE;
+  job->output = output;
+  job->output_capacity = capacity;
+  return BROTLI_TRUE;
+}
+
+static void CompressChunk(void* opaque) {
+  CompressionJob* job = (CompressionJob*)opaque;
+  BrotliEncoderState* s = job->encoder;
+  BrotliEncoderOperation op =
+      job->finish ? BROTLI_OPERATION_FINISH : BROTLI_OPERATION_FLUSH;
+  const uint8_t* next_in = job->input;
+  size_t available_in = job->input_size;
+  const uint8_t* next_meta = job->comment;
+  size_t available_meta = job->comment_len;
+  job->is_ok = BROTLI_FALSE;
+  job->output_size = 0;
+  for (;;) {
+    uint8_t* next_out;
+    size_t available_out;
+    if (job->output_size == job->output_capacity) {
+      if (!GrowJobOutput(job)) return;
+    }
+    next_out = job->output + job->output_size;
+    available_out = job->output_capacity - job->output_size;
+    if (available_meta != 0) {
+      if (!BrotliEncoderCompressStream(s, BROTLI_OPERATION_EMIT_METADATA,
+          &available_meta, &next_meta, &available_out, &next_out, NULL)) {
+        return;
+      }
+    } else if (!BrotliEncoderCompressStream(s, op,
+        &available_in, &next_in, &available_out, &next_out, NULL)) {
+      return;
+    }
+    job->output_size = (size_t)(next_out - job->output);
+    if (available_meta != 0 || BrotliEncoderHasMoreOutput(s)) continue;
+    if (job->finish ? BrotliEncoderIsFinished(s) : (available_in == 0)) {
+      break;
+    }
+  }
+  job->is_ok = BROTLI_TRUE;
+}
+
+static void FinishCompressionJob(CompressionJob* job) {
+  JoinThread(&job->thread);
+  BrotliEncoderDestroyInstance(job->encoder);
+  job->encoder = NULL;
+}
+
+static BROTLI_BOOL StartChunkCompression(Context* context,
+    CompressionJob* job, size_t stream_offset, BROTLI_BOOL use_thread) {
+  job->encoder = BrotliEncoderCreateInstance(NULL, NULL, NULL);
+  if (!job->encoder) {
+    fprintf(stderr, "out of memory\n");
+    return BROTLI_FALSE;
+  }
+  SetEncoderParameters(context, job->encoder);
+  if (context->dictionary) {
+    BrotliEncoderAttachPreparedDictionary(job->encoder,
+                                          context->prepared_dictionary);
+  }
+  if (context->verbosity > 0) {
+    ResetStageTimer(&job->stage_timer);
+    BrotliEncoderSetStageCallback(job->encoder, OnEncoderStage,
+                                  &job->stage_timer);
+  }
+  job->finish = TO_BROTLI_BOOL(job->is_last || context->seekable_chunk_size);
+  /* Comment is not allowed with --seekable; each chunk of it is a separate
+     stream. */
+  if (stream_offset == 0) {
+    job->comment = context->comment;
+    job->comment_len = context->comment_len;
+  } else {
+    job->comment = NULL;
+    job->comment_len = 0;
+  }
+  if (stream_offset != 0 && !context->seekable_chunk_size) {
+    /* Values greater than window size have the same effect. */
+    BrotliEncoderSetParameter(job->encoder, BROTLI_PARAM_STREAM_OFFSET,
+        (uint32_t)BROTLI_MIN(size_t, stream_offset, 1u << 30));
+  }
+  if (use_thread) {
+    StartThread(&job->thread, CompressChunk, job);
+  } else {
+    CompressChunk(job);
+  }
+  return BROTLI_TRUE;
+}
+
+/* Reads the next chunk and starts its compression. */
+static BROTLI_BOOL StartNextChunk(Context* context, CompressionJob* job,
+    size_t chunk_size, BROTLI_BOOL use_thread) {
+  int c;
+  size_t stream_offset = context->total_in;
+  if (context->mapped_input) {
+    job->input = context->mapped_input + stream_offset;
+    job->input_size = BROTLI_MIN(size_t, chunk_size,
+        context->mapped_input_size - stream_offset);
+    context->total_in += job->input_size;
+    job->is_last = TO_BROTLI_BOOL(
+        context->total_in == context->mapped_input_size);
+    return StartChunkCompression(context, job, stream_offset, use_thread);
+  }
+  job->input = job->buffer;
+  job->input_size = fread(job->buffer, 1, chunk_size, context->fin);
+  context->total_in += job->input_size;
+  if (ferror(context->fin)) {
+    fprintf(stderr, "failed to read input [%s]: %s\n",
+            PrintablePath(context->current_input_path), strerror(errno));
+    return BROTLI_FALSE;
+  }
+  /* Look ahead to find out if this is the last chunk. */
+  c = (job->input_size == chunk_size) ? getc(context->fin) : EOF;
+  if (c == EOF) {
+    if (ferror(context->fin)) {
+      fprintf(stderr, "failed to read input [%s]: %s\n",
+              PrintablePath(context->current_input_path), strerror(errno));
+      return BROTLI_FALSE;
+    }
+    job->is_last = BROTLI_TRUE;
+  } else {
+    ungetc(c, context->fin);
+    job->is_last = BROTLI_FALSE;
+  }
+  return StartChunkCompression(context, job, stream_offset, use_thread);
+}
+
+/* Output is written in input order; at most |context->threads| chunks are
+   kept in memory. File workers compress chunks one by one. */
+static BROTLI_BOOL CompressFileThreaded(Context* context) {
+  size_t num_jobs = context->in_worker ? 1 : (size_t)context->threads;
+  size_t chunk_size = ChunkSize(context);
+  CompressionJob* jobs =
+      (CompressionJob*)calloc(num_jobs, sizeof(CompressionJob));
+  size_t first = 0;
+  size_t num_running = 0;
+  size_t i;
+  SeekIndex index = {NULL, 0, 0, 0, 0};
+  BROTLI_BOOL is_eof = BROTLI_FALSE;
+  BROTLI_BOOL is_ok = BROTLI_TRUE;
+  InitializeBuffers(context);
+  context->parallel_stages = TO_BROTLI_BOOL(num_jobs > 1);
+  if (!jobs) {
+    fprintf(stderr, "out of memory\n");
+    return BROTLI_FALSE;
+  }
+  for (i = 0; i < num_jobs; ++i) {
+    if (!context->mapped_input) {
+      jobs[i].buffer = (uint8_t*)malloc(chunk_size);
+      if (!jobs[i].buffer) {
+        fprintf(stderr, "out of memory\n");
+        is_ok = BROTLI_FALSE;
+        break;
+      }
+    }
+    jobs[i].output_capacity = (chunk_size >> 2) + 1024;
+    jobs[i].output = (uint8_t*)malloc(jobs[i].output_capacity);
+    if (!jobs[i].output) {
+      fprintf(stderr, "out of memory\n");
+      is_ok = BROTLI_FALSE;
+      break;
+    }
+  }
+
+  while (is_ok) {
+    CompressionJob* job;
+    while (is_ok && !is_eof && num_running < num_jobs) {
+      job = &jobs[(first + num_running) % num_jobs];
+      is_ok = StartNextChunk(context, job, chunk_size, num_jobs > 1);
+      if (!is_ok) break;
+      is_eof = job->is_last;
+      num_running++;
+    }
+    if (!is_ok || num_running == 0) break;
+    job = &jobs[first];
+    FinishCompressionJob(job);
+    first = (first + 1) % num_jobs;
+    num_running--;
+    if (!job->is_ok) {
+      /* Should detect OOM? */
+      fprintf(stderr, "failed to compress data [%s]\n",
+              PrintablePath(context->current_input_path));
+      is_ok = BROTLI_FALSE;
+      break;
+    }
+    if (context->seekable_chunk_size && !AddSeekIndexEntry(&index,
+        job->output_size, job->input_size)) {
+      is_ok = BROTLI_FALSE;
+      break;
+    }
+    is_ok = WriteOutput(context, job->output, job->output_size);
+    if (context->verbosity > 0) {
+      for (i = 0; i < NUM_ENCODER_STAGES; ++i) {
+        context->stage_timer.times[i] += job->stage_timer.times[i];
+      }
+      ReportProgress(context);
+    }
+  }
+
+  /* Wait for the jobs started before the failure. */
+  while (num_running > 0) {
+    FinishCompressionJob(&jobs[first]);
+    first = (first + 1) % num_jobs;
+    num_running--;
+  }
+  for (i = 0; i < num_jobs; ++i) {
+    free(jobs[i].buffer);
+    free(jobs[i].output);
+  }
+  free(jobs);
+
+  if (is_ok && context->seekable_chunk_size) {
+    is_ok = WriteSeekIndex(context, &index);
+  }
+  free(index.data);
+  if (is_ok) is_ok = FlushOutput(context);
+  if (is_ok && context->verbosity > 0) {
+    context->end_time = clock();
+    fprintf(stderr, "Compressed ");
+    PrintFileProcessingProgress(context);
+    fprintf(stderr, "\n");
+  }
+  return is_ok;
+}
+
+static BROTLI_BOOL CompressCurrentFile(Context* context) {
+  BROTLI_BOOL is_ok = BROTLI_TRUE;
+  BROTLI_BOOL rm_input = BROTLI_FALSE;
+  BROTLI_BOOL rm_output = BROTLI_TRUE;
+  BrotliEncoderState* s = NULL;
+  /* Multi-threaded and seekable modes use an encoder instance per chunk.
+     Single chunk output is the same as the regular one. */
+  if (!context->seekable_chunk_size && (!context->split_input ||
+      (context->input_file_length >= 0 &&
+       (uint64_t)context->input_file_length <= ChunkSize(context)))) {
+    /* Encoder is reused: it keeps allocated memory between files. */
+    if (context->encoder && !BrotliEncoderReset(context->encoder)) {
+      BrotliEncoderDestroyInstance(context->encoder);
+      context->encoder = NULL;
+    }
+    if (!context->encoder) {
+      context->encoder = BrotliEncoderCreateInstance(NULL, NULL, NULL);
+    }
+    s = context->encoder;
     if (!s) {
       fprintf(stderr, "out of memory\n");
       return BROTLI_FALSE;
     }
-    BrotliEncoderSetParameter(s,
-        BROTLI_PARAM_QUALITY, (uint32_t)context->quality);
-    if (context->lgwin > 0) {
-      /* Specified by user. */
-      /* Do not enable "large-window" extension, if not required. */
-      if (context->lgwin > BROTLI_MAX_WINDOW_BITS) {
-        BrotliEncoderSetParameter(s, BROTLI_PARAM_LARGE_WINDOW, 1u);
+    SetEncoderParameters(context, s);
+    if (context->dictionary) {
+      BrotliEncoderAttachPreparedDictionary(s, context->prepared_dictionary);
+    }
+    if (context->verbosity > 0) {
+      BrotliEncoderSetStageCallback(s, OnEncoderStage, &context->stage_timer);
+    }
+  }
+  is_ok = OpenFiles(context);
+  if (is_ok && !context->current_output_path &&
+      !context->force_overwrite && isatty(STDOUT_FILENO)) {
+    fprintf(stderr, "Use -h help. Use -f to force output to a terminal.\n");
+    is_ok = BROTLI_FALSE;
+  }
+  if (is_ok) {
+    is_ok = s ? CompressFile(context, s) : CompressFileThreaded(context);
+  }
+  rm_output = !is_ok;
+  if (is_ok && context->reject_uncompressible) {
+    if (context->total_out >= context->total_in) {
+      rm_output = BROTLI_TRUE;
+      if (context->verbosity > 0) {
+        fprintf(stderr, "Output is larger than input\n");
+      }
+    }
+  }
+  rm_input = !rm_output && context->junk_source;
+  if (!CloseFiles(context, rm_input, rm_output)) is_ok = BROTLI_FALSE;
+  return is_ok;
+}
+
+static BROTLI_BOOL CompressFiles(Context* context) {
+  if (UseFileWorkers(context)) {
+    return ProcessFilesInParallel(context, CompressCurrentFile);
+  }
+  while (NextFile(context)) {
+    if (!CompressCurrentFile(context)) return BROTLI_FALSE;
+  }
+  return BROTLI_TRUE;
+}
+
+/* Dictionary is split into at most this many regions for usage reporting
+   and pruning. */
+#define MAX_DICTIONARY_REGIONS 1024
+#define MIN_DICTIONARY_REGION_SIZE 256
+
+typedef struct DictionaryUsage {
+  size_t dictionary_size;
+  size_t region_size;
+  size_t num_regions;
+  /* Number of references touching region. */
+  size_t* hits;
+  /* Number of referenced region bytes, with multiplicity. */
+  size_t* bytes;
+} DictionaryUsage;
+
+static void OnDictionaryReference(void* opaque, size_t offset, size_t length) {
+  DictionaryUsage* usage = (DictionaryUsage*)opaque;
+  size_t end = offset + length;
+  size_t region = offset / usage->region_size;
+  if (end > usage->dictionary_size) end = usage->dictionary_size;
+  while (offset < end) {
+    size_t region_end = (region + 1) * usage->region_size;
+    size_t chunk_end = BROTLI_MIN(size_t, end, region_end);
+    usage->hits[region]++;
+    usage->bytes[region] += chunk_end - offset;
+    offset = chunk_end;
+    region++;
+  }
+}
+
+/* Compresses current input file with |dictionary| (if not NULL) and stores
+   the compressed size to |*compressed_size|; output is discarded. */
+static BROTLI_BOOL MeasureCompressedSize(Context* context,
+    const BrotliEncoderPreparedDictionary* dictionary, DictionaryUsage* usage,
+    size_t* compressed_size) {
+  BROTLI_BOOL is_ok;
+  BrotliEncoderState* s = BrotliEncoderCreateInstance(NULL, NULL, NULL);
+  *compressed_size = 0;
+  if (!s) {
+    fprintf(stderr, "out of memory\n");
+    return BROTLI_FALSE;
+  }
+  SetEncoderParameters(context, s);
+  if (dictionary) {
+    BrotliEncoderAttachPreparedDictionary(s, dictionary);
+    if (usage) {
+      BrotliEncoderSetDictionaryReferenceCallback(
+          s, OnDictionaryReference, usage);
+    }
+  }
+  is_ok = OpenInputFile(context->current_input_path, &context->fin);
+  if (is_ok) is_ok = CompressFile(context, s);
+  BrotliEncoderDestroyInstance(s);
+  if (!CloseFiles(context, BROTLI_FALSE, BROTLI_TRUE)) is_ok = BROTLI_FALSE;
+  *compressed_size = context->total_out;
+  return is_ok;
+}
+
+/* Compresses all inputs with and without dictionary, reports compressed
+   sizes and dictionary region usage. If output path is specified, dictionary
+   without unused regions is written there. */
+static BROTLI_BOOL AnalyzeDictionary(Context* context) {
+  BROTLI_BOOL is_ok = BROTLI_TRUE;
+  DictionaryUsage usage;
+  size_t total_size = 0;
+  size_t total_plain = 0;
+  size_t total_with_dictionary = 0;
+  size_t total_pruned = 0;
+  size_t num_files = 0;
+  size_t pruned_size = 0;
+  uint8_t* pruned = NULL;
+  BrotliEncoderPreparedDictionary* prepared_pruned = NULL;
+  FILE* fout = NULL;
+  size_t i;
+
+  usage.dictionary_size = context->dictionary_size;
+  usage.region_size = MIN_DICTIONARY_REGION_SIZE;
+  while (usage.region_size * MAX_DICTIONARY_REGIONS < usage.dictionary_size) {
+    usage.region_size <<= 1;
+  }
+  usage.num_regions =
+      (usage.dictionary_size + usage.region_size - 1) / usage.region_size;
+  usage.hits = (size_t*)calloc(usage.num_regions + 1, sizeof(size_t));
+  usage.bytes = (size_t*)calloc(usage.num_regions + 1, sizeof(size_t));
+  if (!usage.hits || !usage.bytes) {
+    fprintf(stderr, "out of memory\n");
+    free(usage.hits);
+    free(usage.bytes);
+    return BROTLI_FALSE;
+  }
+
+  fprintf(stdout, "# size, compressed size without / with dictionary, file\n");
+  while (is_ok && NextFile(context)) {
+    size_t plain;
+    size_t with_dictionary;
+    if (!context->current_input_path) {
+      fprintf(stderr, "analysis requires input files\n");
+      is_ok = BROTLI_FALSE;
+      break;
+    }
+    is_ok = MeasureCompressedSize(context, NULL, NULL, &plain);
+    if (is_ok) {
+      is_ok = MeasureCompressedSize(context, context->prepared_dictionary,
+                                    &usage, &with_dictionary);
+    }
+    if (!is_ok) break;
+    fprintf(stdout, "%lu %lu %lu %s\n", (unsigned long)context->total_in,
+            (unsigned long)plain, (unsigned long)with_dictionary,
+            context->current_input_path);
+    total_size += context->total_in;
+    total_plain += plain;
+    total_with_dictionary += with_dictionary;
+    num_files++;
+  }
+
+  if (is_ok) {
+    fprintf(stdout, "%lu %lu %lu total (%lu files)\n",
+            (unsigned long)total_size, (unsigned long)total_plain,
+            (unsigned long)total_with_dictionary, (unsigned long)num_files);
+    fprintf(stdout, "# dictionary region offset, references, bytes used\n");
+    for (i = 0; i < usage.num_regions; ++i) {
+      fprintf(stdout, "%lu %lu %lu\n",
+              (unsigned long)(i * usage.region_size),
+              (unsigned long)usage.hits[i], (unsigned long)usage.bytes[i]);
+      if (usage.hits[i] != 0) {
+        pruned_size += BROTLI_MIN(size_t, usage.region_size,
+            usage.dictionary_size - i * usage.region_size);
       }
-      BrotliEncoderSetParameter(s,
-          BROTLI_PARAM_LGWIN, (uint32_t)context->lgwin);
+    }
+  }
+
+  if (is_ok && context->output_path) {
+    if (pruned_size == 0) {
+      fprintf(stderr, "dictionary is not used at all\n");
+      is_ok = BROTLI_FALSE;
     } else {
-      /* 0, or not specified by user; could be chosen by compressor. */
-      uint32_t lgwin = DEFAULT_LGWIN;
-      /* Use file size to limit lgwin. */
-      if (context->input_file_length >= 0) {
-        lgwin = BROTLI_MIN_WINDOW_BITS;
-        while (BROTLI_MAX_BACKWARD_LIMIT(lgwin) <
-               (uint64_t)context->input_file_length) {
-          lgwin++;
-          if (lgwin == BROTLI_MAX_WINDOW_BITS) break;
+      pruned = (uint8_t*)malloc(pruned_size);
+      if (!pruned) {
+        fprintf(stderr, "out of memory\n");
+        is_ok = BROTLI_FALSE;
+      }
+    }
+    if (is_ok) {
+      pruned_size = 0;
+      for (i = 0; i < usage.num_regions; ++i) {
+        size_t offset = i * usage.region_size;
+        size_t size = BROTLI_MIN(size_t, usage.region_size,
+            usage.dictionary_size - offset);
+        if (usage.hits[i] == 0) continue;
+        memcpy(pruned + pruned_size, context->dictionary + offset, size);
+        pruned_size += size;
+      }
+      prepared_pruned = BrotliEncoderPrepareDictionary(
+          BROTLI_SHARED_DICTIONARY_RAW, pruned_size, pruned,
+          BROTLI_MAX_QUALITY, NULL, NULL, NULL);
+      if (!prepared_pruned) {
+        fprintf(stderr, "failed to prepare pruned dictionary\n");
+        is_ok = BROTLI_FALSE;
+      }
+    }
+    /* Pruning changes distances; check how well pruned dictionary works. */
+    context->iterator = 0;
+    context->ignore = 0;
+    while (is_ok && NextFile(context)) {
+      size_t with_pruned;
+      is_ok = MeasureCompressedSize(
+          context, prepared_pruned, NULL, &with_pruned);
+      total_pruned += with_pruned;
+    }
+    if (is_ok) {
+      fprintf(stdout, "# pruned dictionary: %lu -> %lu bytes\n",
+              (unsigned long)usage.dictionary_size,
+              (unsigned long)pruned_size);
+      fprintf(stdout, "# total compressed size with pruned dictionary: %lu\n",
+              (unsigned long)total_pruned);
+      is_ok = OpenOutputFile(
+          context->output_path, &fout, context->force_overwrite);
+    }
+    if (is_ok) {
+      if (fwrite(pruned, 1, pruned_size, fout) != pruned_size) {
+        fprintf(stderr, "failed to write output [%s]: %s\n",
+                PrintablePath(context->output_path), strerror(errno));
+        is_ok = BROTLI_FALSE;
+      }
+      if (fclose(fout) != 0) {
+        if (is_ok) {
+          fprintf(stderr, "fclose failed [%s]: %s\n",
+                  PrintablePath(context->output_path), strerror(errno));
         }
+        is_ok = BROTLI_FALSE;
+      }
+      if (!is_ok) unlink(context->output_path);
+    }
+  }
+
+  BrotliEncoderDestroyPreparedDictionary(prepared_pruned);
+  free(pruned);
+  free(usage.hits);
+  free(usage.bytes);
+  return is_ok;
+}
+
+/* Training corpus is subsampled to this size to bound memory usage; the
+   dictionary generator needs about 17 bytes per byte of corpus. */
+static const uint64_t kMaxTrainingCorpusSize = (uint64_t)1 << 27;
+/* Subsampling granularity; long files are represented by evenly spaced
+   blocks. */
+static const size_t kTrainingBlockSize = 1 << 14;
+
+/* Reads |budget| bytes of input file of |file_size| bytes to |out|.
+   |*out_size| is set to the number of bytes actually read. */
+static BROTLI_BOOL ReadTrainingSample(Context* context, uint64_t file_size,
+    size_t budget, uint8_t* out, size_t* out_size) {
+  size_t num_blocks = (budget + kTrainingBlockSize - 1) / kTrainingBlockSize;
+  size_t total = 0;
+  size_t i;
+  FILE* f;
+  *out_size = 0;
+  if (!OpenInputFile(context->current_input_path, &f)) return BROTLI_FALSE;
+  for (i = 0; i < num_blocks; ++i) {
+    size_t block_size = BROTLI_MIN(size_t, kTrainingBlockSize, budget - total);
+    size_t bytes_read;
+    if ((uint64_t)budget < file_size) {
+      /* Blocks that could not be reached are not sampled. */
+      if (!SeekFile(f, (file_size / num_blocks) * i)) break;
+    }
+    bytes_read = fread(out + total, 1, block_size, f);
+    total += bytes_read;
+    if (bytes_read != block_size) break;
+  }
+  if (ferror(f)) {
+    fprintf(stderr, "failed to read input [%s]: %s\n",
+            PrintablePath(context->current_input_path), strerror(errno));
+    fclose(f);
+    return BROTLI_FALSE;
+  }
+  fclose(f);
+  *out_size = total;
+  return BROTLI_TRUE;
+}
+
+static BROTLI_BOOL TrainDictionary(Context* context) {
+  BROTLI_BOOL is_ok = BROTLI_TRUE;
+  int64_t* lengths = NULL;
+  size_t lengths_capacity = 0;
+  size_t num_files = 0;
+  size_t num_selected;
+  size_t num_samples = 0;
+  uint64_t total = 0;
+  uint64_t selected_total = 0;
+  size_t corpus_size;
+  size_t corpus_pos = 0;
+  uint8_t* corpus = NULL;
+  size_t* sample_sizes = NULL;
+  uint8_t* dictionary = NULL;
+  size_t dictionary_size = 0;
+  size_t i;
+  size_t j;
+  FILE* fout = NULL;
+
+  /* First pass: collect input sizes. */
+  while (NextFile(context)) {
+    if (!context->current_input_path) {
+      fprintf(stderr, "training requires input files\n");
+      free(lengths);
+      return BROTLI_FALSE;
+    }
+    if (context->input_file_length < 0) {
+      fprintf(stderr, "could not get size of input file [%s]\n",
+              PrintablePath(context->current_input_path));
+      free(lengths);
+      return BROTLI_FALSE;
+    }
+    if (num_files == lengths_capacity) {
+      int64_t* new_lengths;
+      lengths_capacity = lengths_capacity ? 2 * lengths_capacity : 256;
+      new_lengths = (int64_t*)realloc(
+          lengths, lengths_capacity * sizeof(int64_t));
+      if (!new_lengths) {
+        fprintf(stderr, "out of memory\n");
+        free(lengths);
+        return BROTLI_FALSE;
       }
-      BrotliEncoderSetParameter(s, BROTLI_PARAM_LGWIN, lgwin);
+      lengths = new_lengths;
     }
+    lengths[num_files++] = context->input_file_length;
     if (context->input_file_length > 0) {
-      uint32_t size_hint = context->input_file_length < (1 << 30) ?
-          (uint32_t)context->input_file_length : (1u << 30);
-      BrotliEncoderSetParameter(s, BROTLI_PARAM_SIZE_HINT, size_hint);
+      total += (uint64_t)context->input_file_length;
     }
-    if (context->dictionary) {
-      BrotliEncoderAttachPreparedDictionary(s, context->prepared_dictionary);
+  }
+
+  /* Too many files are thinned out evenly. */
+  num_selected = BROTLI_MIN(size_t, num_files, BROTLI_MAX_DICTIONARY_SAMPLES);
+  for (i = 0; i < num_files; ++i) {
+    if ((i * num_selected) / num_files ==
+        ((i + 1) * num_selected) / num_files) {
+      lengths[i] = 0;
+    }
+    if (lengths[i] > 0) selected_total += (uint64_t)lengths[i];
+  }
+  corpus_size = (size_t)(selected_total < kMaxTrainingCorpusSize ?
+      selected_total : kMaxTrainingCorpusSize);
+  if (corpus_size != 0) corpus = (uint8_t*)malloc(corpus_size);
+  if (num_selected != 0) {
+    sample_sizes = (size_t*)malloc(num_selected * sizeof(size_t));
+  }
+  if ((corpus_size != 0 && !corpus) || (num_selected != 0 && !sample_sizes)) {
+    fprintf(stderr, "out of memory\n");
+    is_ok = BROTLI_FALSE;
+  }
+
+  /* Second pass: read (subsampled) inputs. */
+  context->iterator = 0;
+  context->ignore = 0;
+  for (i = 0; is_ok && NextFile(context); ++i) {
+    size_t budget;
+    size_t sample_size;
+    if (lengths[i] <= 0) continue;
+    budget = (size_t)(((uint64_t)lengths[i] * corpus_size) / selected_total);
+    budget = BROTLI_MIN(size_t, budget, corpus_size - corpus_pos);
+    if (budget == 0) continue;
+    is_ok = ReadTrainingSample(context, (uint64_t)lengths[i], budget,
+                               corpus + corpus_pos, &sample_size);
+    if (is_ok && sample_size != 0) {
+      sample_sizes[num_samples++] = sample_size;
+      corpus_pos += sample_size;
+    }
+  }
+
+  if (is_ok && num_samples < 2) {
+    fprintf(stderr, "at least 2 non-empty input files are required\n");
+    is_ok = BROTLI_FALSE;
+  }
+  if (is_ok) {
+    if (context->verbosity > 0) {
+      fprintf(stderr, "Training on %d of %d files: ", (int)num_samples,
+              (int)num_files);
+      PrintBytes(corpus_pos);
+      fprintf(stderr, " of ");
+      PrintBytes((size_t)total);
+      fprintf(stderr, "\n");
+    }
+    if (context->shared_dictionary) {
+      dictionary = BrotliGenerateSharedDictionary(
+          context->max_dictionary_size, context->max_dictionary_size / 4,
+          DICTIONARY_SLICE_LEN, num_samples, sample_sizes, corpus,
+          &dictionary_size);
+    } else {
+      dictionary = BrotliGenerateDictionary(context->max_dictionary_size,
+          DICTIONARY_SLICE_LEN, num_samples, sample_sizes, corpus,
+          &dictionary_size);
     }
-    is_ok = OpenFiles(context);
-    if (is_ok && !context->current_output_path &&
-        !context->force_overwrite && isatty(STDOUT_FILENO)) {
-      fprintf(stderr, "Use -h help. Use -f to force output to a terminal.\n");
+    if (!dictionary) {
+      fprintf(stderr, "failed to generate dictionary\n");
       is_ok = BROTLI_FALSE;
     }
-    if (is_ok) is_ok = CompressFile(context, s);
-    BrotliEncoderDestroyInstance(s);
-    rm_output = !is_ok;
-    if (is_ok && context->reject_uncompressible) {
-      if (context->total_out >= context->total_in) {
-        rm_output = BROTLI_TRUE;
-        if (context->verbosity > 0) {
-          fprintf(stderr, "Output is larger than input\n");
-        }
+  }
+  free(lengths);
+  free(corpus);
+  free(sample_sizes);
+  if (!is_ok) return BROTLI_FALSE;
+
+  j = 0;
+  context->current_output_path = context->output_path;
+  is_ok = OpenOutputFile(context->output_path, &fout, context->force_overwrite);
+  if (is_ok && !context->output_path && !context->force_overwrite &&
+      isatty(STDOUT_FILENO)) {
+    fprintf(stderr, "Use -h help. Use -f to force output to a terminal.\n");
+    is_ok = BROTLI_FALSE;
+  }
+  if (is_ok) {
+    j = fwrite(dictionary, 1, dictionary_size, fout);
+    if (j != dictionary_size) {
+      fprintf(stderr, "failed to write output [%s]: %s\n",
+              PrintablePath(context->output_path), strerror(errno));
+      is_ok = BROTLI_FALSE;
+    }
+  }
+  if (fout && fclose(fout) != 0) {
+    if (is_ok) {
+      fprintf(stderr, "fclose failed [%s]: %s\n",
+              PrintablePath(context->output_path), strerror(errno));
+    }
+    is_ok = BROTLI_FALSE;
+  }
+  if (!is_ok && context->output_path) unlink(context->output_path);
+  if (is_ok && context->verbosity > 0) {
+    fprintf(stderr, "Trained dictionary: ");
+    PrintBytes(dictionary_size);
+    fprintf(stderr, "\n");
+  }
+  free(dictionary);
+  return is_ok;
+}
+
+/* Benchmark mode: inputs are loaded into memory and each of them is
+   compressed / decompressed with a fresh encoder / decoder; each measurement
+   is repeated until it takes at least |kBenchMinTime| seconds and the fastest
+   round is reported. */
+static const double kBenchMinTime = 1.0;
+
+typedef struct BenchMemory {
+  size_t allocated;
+  size_t peak;
+} BenchMemory;
+
+/* Allocation size is stored in front of the block; header size preserves
+   malloc alignment. */
+#define BENCH_ALLOC_HEADER 16
+
+static void* BenchAlloc(void* opaque, size_t size) {
+  BenchMemory* memory = (BenchMemory*)opaque;
+  uint8_t* p = (uint8_t*)malloc(size + BENCH_ALLOC_HEADER);
+  if (!p) return NULL;
+  memcpy(p, &size, sizeof(size_t));
+  memory->allocated += size;
+  if (memory->allocated > memory->peak) memory->peak = memory->allocated;
+  return p + BENCH_ALLOC_HEADER;
+}
+
+static void BenchFree(void* opaque, void* address) {
+  BenchMemory* memory = (BenchMemory*)opaque;
+  uint8_t* p = (uint8_t*)address;
+  size_t size;
+  if (!p) return;
+  p -= BENCH_ALLOC_HEADER;
+  memcpy(&size, p, sizeof(size_t));
+  memory->allocated -= size;
+  free(p);
+}
+
+/* Peak resident set size of the process in bytes; 0, if unknown. */
+static uint64_t PeakRss(void) {
+#if HAVE_GETRUSAGE
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0 || usage.ru_maxrss < 0) return 0;
+#if defined(__APPLE__)
+  return (uint64_t)usage.ru_maxrss;
+#else
+  return (uint64_t)usage.ru_maxrss << 10;
+#endif
+#else
+  return 0;
+#endif
+}
+
+typedef struct BenchCorpus {
+  size_t num_files;
+  size_t files_capacity;
+  size_t* sizes;
+  /* Concatenated inputs. */
+  uint8_t* data;
+  size_t data_size;
+  size_t data_capacity;
+  /* Compressed inputs, one buffer per file. */
+  uint8_t** compressed;
+  size_t* compressed_sizes;
+  size_t* compressed_capacities;
+  uint8_t* decompressed;
+} BenchCorpus;
+
+typedef struct BenchResult {
+  double time;
+  uint64_t cycles;
+  BenchMemory memory;
+} BenchResult;
+
+/* Appends current input file to |corpus|. */
+static BROTLI_BOOL ReadBenchInput(Context* context, BenchCorpus* corpus) {
+  size_t start = corpus->data_size;
+  FILE* f;
+  if (corpus->num_files == corpus->files_capacity) {
+    size_t capacity = corpus->files_capacity ?
+        2 * corpus->files_capacity : 256;
+    size_t* sizes = (size_t*)realloc(corpus->sizes, capacity * sizeof(size_t));
+    if (!sizes) {
+      fprintf(stderr, "out of memory\n");
+      return BROTLI_FALSE;
+    }
+    corpus->sizes = sizes;
+    corpus->files_capacity = capacity;
+  }
+  if (!OpenInputFile(context->current_input_path, &f)) return BROTLI_FALSE;
+  for (;;) {
+    size_t bytes_read;
+    if (corpus->data_size == corpus->data_capacity) {
+      size_t capacity = corpus->data_capacity ?
+          2 * corpus->data_capacity : kFileBufferSize;
+      uint8_t* data;
+      /* Known file size lets EOF be detected without reallocation. */
+      if (context->input_file_length >= 0 &&
+          (uint64_t)context->input_file_length < (((size_t)-1) >> 2) &&
+          start + (size_t)context->input_file_length >= capacity) {
+        capacity = start + (size_t)context->input_file_length + 1;
       }
+      data = (capacity > corpus->data_capacity) ?
+          (uint8_t*)realloc(corpus->data, capacity) : NULL;
+      if (!data) {
+        fprintf(stderr, "out of memory\n");
+        fclose(f);
+        return BROTLI_FALSE;
+      }
+      corpus->data = data;
+      corpus->data_capacity = capacity;
     }
-    rm_input = !rm_output && context->junk_source;
-    if (!CloseFiles(context, rm_input, rm_output)) is_ok = BROTLI_FALSE;
-    if (!is_ok) return BROTLI_FALSE;
+    bytes_read = fread(corpus->data + corpus->data_size, 1,
+                       corpus->data_capacity - corpus->data_size, f);
+    corpus->data_size += bytes_read;
+    if (bytes_read == 0) break;
+  }
+  if (ferror(f)) {
+    fprintf(stderr, "failed to read input [%s]: %s\n",
+            PrintablePath(context->current_input_path), strerror(errno));
+    fclose(f);
+    return BROTLI_FALSE;
+  }
+  fclose(f);
+  corpus->sizes[corpus->num_files++] = corpus->data_size - start;
+  return BROTLI_TRUE;
+}
+
+static BROTLI_BOOL LoadBenchCorpus(Context* context, BenchCorpus* corpus) {
+  size_t i;
+  while (NextFile(context)) {
+    if (!context->current_input_path) {
+      fprintf(stderr, "benchmark requires input files\n");
+      return BROTLI_FALSE;
+    }
+    if (!ReadBenchInput(context, corpus)) return BROTLI_FALSE;
+  }
+  if (corpus->num_files == 0) return BROTLI_TRUE;
+  corpus->compressed = (uint8_t**)calloc(corpus->num_files, sizeof(uint8_t*));
+  corpus->compressed_sizes =
+      (size_t*)calloc(corpus->num_files, sizeof(size_t));
+  corpus->compressed_capacities =
+      (size_t*)calloc(corpus->num_files, sizeof(size_t));
+  corpus->decompressed = (uint8_t*)malloc(corpus->data_size + 1);
+  if (!corpus->compressed || !corpus->compressed_sizes ||
+      !corpus->compressed_capacities || !corpus->decompressed) {
+    fprintf(stderr, "out of memory\n");
+    return BROTLI_FALSE;
+  }
+  for (i = 0; i < corpus->num_files; ++i) {
+    size_t capacity = BrotliEncoderMaxCompressedSize(corpus->sizes[i]);
+    if (capacity == 0) capacity = corpus->sizes[i];
+    corpus->compressed[i] = (uint8_t*)malloc(capacity);
+    corpus->compressed_capacities[i] = capacity;
+    if (!corpus->compressed[i]) {
+      fprintf(stderr, "out of memory\n");
+      return BROTLI_FALSE;
+    }
+  }
+  return BROTLI_TRUE;
+}
+
+static void DestroyBenchCorpus(BenchCorpus* corpus) {
+  size_t i;
+  if (corpus->compressed) {
+    for (i = 0; i < corpus->num_files; ++i) free(corpus->compressed[i]);
+  }
+  free(corpus->compressed);
+  free(corpus->compressed_sizes);
+  free(corpus->compressed_capacities);
+  free(corpus->decompressed);
+  free(corpus->data);
+  free(corpus->sizes);
+}
+
+/* Compresses |input| to |corpus| buffer of file |index|; buffer is grown, if
+   compressed data does not fit. */
+static BROTLI_BOOL BenchCompress(Context* context, BenchCorpus* corpus,
+    size_t index, const uint8_t* input, BenchMemory* memory) {
+  BrotliEncoderState* s =
+      BrotliEncoderCreateInstance(BenchAlloc, BenchFree, memory);
+  size_t available_in = corpus->sizes[index];
+  const uint8_t* next_in = input;
+  size_t available_out = corpus->compressed_capacities[index];
+  uint8_t* next_out = corpus->compressed[index];
+  BROTLI_BOOL is_ok = BROTLI_TRUE;
+  if (!s) {
+    fprintf(stderr, "out of memory\n");
+    return BROTLI_FALSE;
+  }
+  /* Window and size hint are chosen the same way as for regular files. */
+  context->input_file_length = (int64_t)corpus->sizes[index];
+  SetEncoderParameters(context, s);
+  if (context->dictionary) {
+    BrotliEncoderAttachPreparedDictionary(s, context->prepared_dictionary);
+  }
+  while (is_ok && !BrotliEncoderIsFinished(s)) {
+    if (available_out == 0) {
+      size_t used = corpus->compressed_capacities[index];
+      size_t capacity = 2 * used;
+      uint8_t* output = (uint8_t*)realloc(corpus->compressed[index], capacity);
+      if (!output) {
+        fprintf(stderr, "out of memory\n");
+        is_ok = BROTLI_FALSE;
+        break;
+      }
+      corpus->compressed[index] = output;
+      corpus->compressed_capacities[index] = capacity;
+      next_out = output + used;
+      available_out = capacity - used;
+    }
+    if (!BrotliEncoderCompressStream(s, BROTLI_OPERATION_FINISH,
+        &available_in, &next_in, &available_out, &next_out, NULL)) {
+      fprintf(stderr, "failed to compress data\n");
+      is_ok = BROTLI_FALSE;
+    }
+  }
+  corpus->compressed_sizes[index] =
+      (size_t)(next_out - corpus->compressed[index]);
+  BrotliEncoderDestroyInstance(s);
+  return is_ok;
+}
+
+static BROTLI_BOOL BenchDecompress(Context* context, BenchCorpus* corpus,
+    size_t index, uint8_t* output, BenchMemory* memory) {
+  BrotliDecoderState* s =
+      BrotliDecoderCreateInstance(BenchAlloc, BenchFree, memory);
+  size_t available_in = corpus->compressed_sizes[index];
+  const uint8_t* next_in = corpus->compressed[index];
+  size_t available_out = corpus->sizes[index];
+  uint8_t* next_out = output;
+  BrotliDecoderResult result;
+  if (!s) {
+    fprintf(stderr, "out of memory\n");
+    return BROTLI_FALSE;
+  }
+  BrotliDecoderSetParameter(s, BROTLI_DECODER_PARAM_LARGE_WINDOW, 1u);
+  if (context->dictionary) {
+    BrotliDecoderAttachDictionary(s, context->dictionary_type,
+        context->dictionary_size, context->dictionary);
+  }
+  result = BrotliDecoderDecompressStream(
+      s, &available_in, &next_in, &available_out, &next_out, NULL);
+  BrotliDecoderDestroyInstance(s);
+  if (result != BROTLI_DECODER_RESULT_SUCCESS || available_in != 0 ||
+      available_out != 0) {
+    fprintf(stderr, "failed to decompress data\n");
+    return BROTLI_FALSE;
   }
   return BROTLI_TRUE;
 }
 
+static BROTLI_BOOL BenchMeasure(Context* context, BenchCorpus* corpus,
+    BROTLI_BOOL decompress, BenchResult* result) {
+  double total_time = 0.0;
+  result->time = -1.0;
+  result->cycles = 0;
+  result->memory.allocated = 0;
+  result->memory.peak = 0;
+  do {
+    double start_time = WallTime();
+    uint64_t start_cycles = READ_CYCLE_COUNTER();
+    size_t offset = 0;
+    size_t i;
+    double time;
+    for (i = 0; i < corpus->num_files; ++i) {
+      BROTLI_BOOL is_ok = decompress ?
+          BenchDecompress(context, corpus, i, corpus->decompressed + offset,
+                          &result->memory) :
+          BenchCompress(context, corpus, i, corpus->data + offset,
+                        &result->memory);
+      if (!is_ok) return BROTLI_FALSE;
+      offset += corpus->sizes[i];
+    }
+    time = WallTime() - start_time;
+    if (result->time < 0.0 || time < result->time) {
+      result->time = time;
+      result->cycles = READ_CYCLE_COUNTER() - start_cycles;
+    }
+    total_time += time;
+  } while (total_time < kBenchMinTime);
+  return BROTLI_TRUE;
+}
+
+/* Prints JSON number, or null, if value is unknown. */
+static void PrintJsonValue(const char* key, double value, BROTLI_BOOL known) {
+  if (known) {
+    fprintf(stdout, ", \"%s\": %.3f", key, value);
+  } else {
+    fprintf(stdout, ", \"%s\": null", key);
+  }
+}
+
+/* Prints JSON unsigned integer; "%lu" would truncate it where long is 32-bit
+   wide. */
+static void PrintJsonUint(const char* key, uint64_t value) {
+  char digits[24];
+  size_t pos = sizeof(digits) - 1;
+  digits[pos] = 0;
+  do {
+    digits[--pos] = (char)('0' + (int)(value % 10));
+    value /= 10;
+  } while (value != 0);
+  fprintf(stdout, ", \"%s\": %s", key, &digits[pos]);
+}
+
+static void PrintBenchResult(Context* context, BenchCorpus* corpus,
+    BenchResult* compression, BenchResult* decompression) {
+  double size = (double)corpus->data_size;
+  uint64_t compressed_size = 0;
+  uint64_t peak_rss = PeakRss();
+  int lgwin = context->lgwin;
+  size_t i;
+  for (i = 0; i < corpus->num_files; ++i) {
+    compressed_size += corpus->compressed_sizes[i];
+  }
+  /* Automatically chosen window depends on file size; the largest one used
+     is reported. */
+  if (lgwin <= 0) {
+    lgwin = BROTLI_MIN_WINDOW_BITS;
+    for (i = 0; i < corpus->num_files; ++i) {
+      int file_lgwin = (int)AutoLgwin((int64_t)corpus->sizes[i]);
+      if (file_lgwin > lgwin) lgwin = file_lgwin;
+    }
+  }
+  fprintf(stdout, "  {\"quality\": %d, \"lgwin\": %d",
+          context->quality, lgwin);
+  PrintJsonUint("files", corpus->num_files);
+  PrintJsonUint("size", corpus->data_size);
+  PrintJsonUint("compressed_size", compressed_size);
+  PrintJsonValue("ratio", size / (double)compressed_size, BROTLI_TRUE);
+  PrintJsonValue("compress_mb_per_sec", size / compression->time * 1e-6,
+                 compression->time > 0.0);
+  PrintJsonValue("decompress_mb_per_sec", size / decompression->time * 1e-6,
+                 decompression->time > 0.0);
+  PrintJsonValue("compress_cycles_per_byte",
+                 (double)compression->cycles / size,
+                 HAVE_CYCLE_COUNTER && size > 0.0);
+  PrintJsonValue("decompress_cycles_per_byte",
+                 (double)decompression->cycles / size,
+                 HAVE_CYCLE_COUNTER && size > 0.0);
+  PrintJsonUint("compress_memory", compression->memory.peak);
+  PrintJsonUint("decompress_memory", decompression->memory.peak);
+  /* Process-wide peak; it includes loaded inputs and previous rounds. */
+  if (peak_rss != 0) {
+    PrintJsonUint("peak_rss", peak_rss);
+    fprintf(stdout, "}");
+  } else {
+    fprintf(stdout, ", \"peak_rss\": null}");
+  }
+}
+
+/* Compresses and decompresses all inputs with each quality and window size
+   of the ranges and reports results as JSON array. */
+static BROTLI_BOOL Benchmark(Context* context) {
+  BROTLI_BOOL is_ok = BROTLI_TRUE;
+  BenchCorpus corpus;
+  BROTLI_BOOL is_first = BROTLI_TRUE;
+  int lgwin_min = context->lgwin;
+  int lgwin_max = BROTLI_MAX(int, context->lgwin, context->bench_lgwin_max);
+  int quality;
+  int lgwin;
+  memset(&corpus, 0, sizeof(corpus));
+  is_ok = LoadBenchCorpus(context, &corpus);
+  if (is_ok && corpus.num_files == 0) {
+    fprintf(stderr, "benchmark requires input files\n");
+    is_ok = BROTLI_FALSE;
+  }
+  if (is_ok && context->verbosity > 0) {
+    fprintf(stderr, "Benchmarking %d files: ", (int)corpus.num_files);
+    PrintBytes(corpus.data_size);
+    fprintf(stderr, "\n");
+  }
+  if (is_ok) fprintf(stdout, "[\n");
+  for (quality = context->bench_quality_min;
+       is_ok && quality <= context->bench_quality_max; ++quality) {
+    for (lgwin = lgwin_min; is_ok && lgwin <= lgwin_max; ++lgwin) {
+      BenchResult compression;
+      BenchResult decompression;
+      context->quality = quality;
+      context->lgwin = lgwin;
+      is_ok = BenchMeasure(context, &corpus, BROTLI_FALSE, &compression);
+      if (is_ok) {
+        is_ok = BenchMeasure(context, &corpus, BROTLI_TRUE, &decompression);
+      }
+      if (is_ok && corpus.data_size != 0 &&
+          memcmp(corpus.data, corpus.decompressed, corpus.data_size) != 0) {
+        fprintf(stderr, "decompressed data does not match input\n");
+        is_ok = BROTLI_FALSE;
+      }
+      if (!is_ok) break;
+      if (!is_first) fprintf(stdout, ",\n");
+      is_first = BROTLI_FALSE;
+      PrintBenchResult(context, &corpus, &compression, &decompression);
+      fflush(stdout);
+    }
+  }
+  if (is_ok) fprintf(stdout, "\n]\n");
+  DestroyBenchCorpus(&corpus);
+  return is_ok;
+}
+
 int main(int argc, char** argv) {
   Command command;
   Context context;
@@ -1485,6 +4424,15 @@ int main(int argc, char** argv) {
 
   context.quality = 11;
   context.lgwin = -1;
+  context.simd_hasher = -1;
+  context.threads = 1;
+  context.split_input = BROTLI_FALSE;
+  context.in_worker = BROTLI_FALSE;
+  context.max_dictionary_size = DEFAULT_MAX_DICTIONARY_SIZE;
+  context.shared_dictionary = BROTLI_FALSE;
+  context.bench_quality_min = 11;
+  context.bench_quality_max = 11;
+  context.bench_lgwin_max = -1;
   context.verbosity = 0;
   context.comment_len = 0;
   context.force_overwrite = BROTLI_FALSE;
@@ -1494,8 +4442,15 @@ int main(int argc, char** argv) {
   context.test_integrity = BROTLI_FALSE;
   context.write_to_stdout = BROTLI_FALSE;
   context.decompress = BROTLI_FALSE;
+  context.decode = BROTLI_FALSE;
   context.large_window = BROTLI_FALSE;
   context.allow_concatenated = BROTLI_FALSE;
+  context.recursive = BROTLI_FALSE;
+  context.seekable_chunk_size = 0;
+  context.range_set = BROTLI_FALSE;
+  context.range_offset = 0;
+  context.range_length = 0;
+  context.seekable_input = BROTLI_FALSE;
   context.output_path = NULL;
   context.dictionary_path = NULL;
   context.suffix = DEFAULT_SUFFIX;
@@ -1508,33 +4463,60 @@ int main(int argc, char** argv) {
   context.dictionary = NULL;
   context.dictionary_size = 0;
   context.decoder = NULL;
+  context.dictionary_type = BROTLI_SHARED_DICTIONARY_RAW;
   context.prepared_dictionary = NULL;
+  context.encoder = NULL;
   context.modified_path = NULL;
   context.iterator = 0;
   context.ignore = 0;
   context.iterator_error = BROTLI_FALSE;
+  context.file_list = NULL;
+  context.file_list_size = 0;
   context.buffer = NULL;
   context.current_input_path = NULL;
   context.current_output_path = NULL;
   context.fin = NULL;
   context.fout = NULL;
+  context.mapped_input = NULL;
+  context.mapped_input_size = 0;
+  context.mapped_input_eof = BROTLI_FALSE;
+  context.async_io = NULL;
+  context.sparse_output = BROTLI_FALSE;
 
   command = ParseParams(&context);
 
   if (command == COMMAND_COMPRESS || command == COMMAND_DECOMPRESS ||
-      command == COMMAND_TEST_INTEGRITY) {
-    if (!ReadDictionary(&context, command)) is_ok = BROTLI_FALSE;
+      command == COMMAND_TEST_INTEGRITY || command == COMMAND_TRAIN ||
+      command == COMMAND_ANALYZE || command == COMMAND_BENCH) {
+    if (context.recursive && context.input_count > 0) {
+      is_ok = ExpandInputs(&context, command);
+      /* Same restriction as for command line inputs. */
+      if (is_ok && context.input_count > 1 &&
+          (command == COMMAND_COMPRESS || command == COMMAND_DECOMPRESS) &&
+          (context.output_path || context.write_to_stdout)) {
+        fprintf(stderr, "output file could be set only for 1 input file\n");
+        is_ok = BROTLI_FALSE;
+      }
+    }
+    if (is_ok && !ReadDictionary(&context, command)) is_ok = BROTLI_FALSE;
     if (is_ok) {
       size_t modified_path_len =
           context.longest_path_len + strlen(context.suffix) + 1;
       context.modified_path = (char*)malloc(modified_path_len);
-      context.buffer = (uint8_t*)malloc(kFileBufferSize * 2);
+      context.buffer = (uint8_t*)malloc(kFileBufferSize);
       if (!context.modified_path || !context.buffer) {
         fprintf(stderr, "out of memory\n");
         is_ok = BROTLI_FALSE;
       } else {
         context.input = context.buffer;
-        context.output = context.buffer + kFileBufferSize;
+      }
+      /* Single stream is processed in one thread; others do I/O. */
+      if (context.threads > 1 && !UseFileWorkers(&context)) {
+        context.async_io = CreateAsyncIo();
+        if (!context.async_io) {
+          fprintf(stderr, "out of memory\n");
+          is_ok = BROTLI_FALSE;
+        }
       }
     }
   }
@@ -1558,6 +4540,18 @@ int main(int argc, char** argv) {
       is_ok = DecompressFiles(&context);
       break;
 
+    case COMMAND_TRAIN:
+      is_ok = TrainDictionary(&context);
+      break;
+
+    case COMMAND_ANALYZE:
+      is_ok = AnalyzeDictionary(&context);
+      break;
+
+    case COMMAND_BENCH:
+      is_ok = Benchmark(&context);
+      break;
+
     case COMMAND_HELP:
     case COMMAND_INVALID:
     default:
@@ -1568,10 +4562,15 @@ int main(int argc, char** argv) {
 
   if (context.iterator_error) is_ok = BROTLI_FALSE;
 
+  BrotliEncoderDestroyInstance(context.encoder);
   BrotliEncoderDestroyPreparedDictionary(context.prepared_dictionary);
   free(context.dictionary);
   free(context.modified_path);
   free(context.buffer);
+  free(context.async_io);
+  if (context.file_list) {
+    FreeNames(context.file_list, context.file_list_size);
+  }
 
   if (!is_ok) exit(1);
   return 0;
@@ -0,0 +1,823 @@
+/* Copyright 2025 Google Inc. All Rights Reserved.
+
+   Distributed under MIT license.
+   See file LICENSE for detail or copy at https://opensource.org/licenses/MIT
+*/
+
+/* C port of research/sieve.cc; see dictionary_generator.h. */
+
+#include "dictionary_generator.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Pointer to position in (combined corpus) text. */
+typedef uint32_t TextIdx;
+
+/* Index of sample / generation. */
+typedef uint16_t SampleIdx;
+
+typedef struct Slot {
+  TextIdx next;
+  TextIdx offset;
+  SampleIdx presence;
+  SampleIdx mark;
+} Slot;
+
+static const TextIdx kNowhere = (TextIdx)-1;
+
+typedef struct Sieve {
+  const uint8_t* data;
+  TextIdx slice_len;
+  Slot* map;
+  /* For each position: index of slot for slice starting there. */
+  TextIdx* shortcut;
+  TextIdx end;
+  /* Incremented for every pass over slots. */
+  SampleIdx iteration;
+} Sieve;
+
+/* Slices before |middle| are taken if they are present in at least
+   |min_presence| samples, the rest should be present in one more sample.
+   If |output| is not NULL, selected text is copied there.
+   Returns the length of selected text. */
+static TextIdx Select(Sieve* sieve, TextIdx middle, SampleIdx min_presence,
+                      uint8_t* output) {
+  TextIdx from = kNowhere;
+  TextIdx to = kNowhere;
+  TextIdx result = 0;
+  SampleIdx target_presence = min_presence;
+  SampleIdx iteration = ++sieve->iteration;
+  TextIdx i;
+  for (i = 0; i < sieve->end; ++i) {
+    Slot* item = &sieve->map[sieve->shortcut[i]];
+    if (i == middle) target_presence++;
+    if (item->mark == iteration) continue;
+    item->mark = iteration;
+    if (item->presence < target_presence) continue;
+    if ((to == kNowhere) || (to < i)) {
+      if (from != kNowhere) {
+        if (output) memcpy(output + result, sieve->data + from, to - from);
+        result += to - from;
+      }
+      from = i;
+    }
+    to = i + sieve->slice_len;
+  }
+  if (from != kNowhere) {
+    if (output) memcpy(output + result, sieve->data + from, to - from);
+    result += to - from;
+  }
+  return result;
+}
+
+/* Builds the coverage map: distinct slices and their sample presence. */
+static BROTLI_BOOL BuildMap(Sieve* sieve, const TextIdx* offsets) {
+  const uint8_t* data = sieve->data;
+  TextIdx slice_len = sieve->slice_len;
+  TextIdx end = sieve->end;
+  TextIdx hash_len = 11;
+  TextIdx hash_mask;
+  TextIdx* hash_head;
+  TextIdx num_slots = 1;
+  SampleIdx piece = 0;
+  TextIdx hash = 0;
+  TextIdx l_shift = 3;
+  TextIdx r_shift;
+  TextIdx l_shift_x;
+  TextIdx r_shift_x;
+  TextIdx i;
+
+  while (hash_len < 29 && ((1u << hash_len) < end)) hash_len += 3;
+  hash_len -= 3;
+  hash_mask = (1u << hash_len) - 1u;
+  r_shift = hash_len - l_shift;
+  hash_head = (TextIdx*)calloc((size_t)1 << hash_len, sizeof(TextIdx));
+  /* There are at most |end| distinct slices; slot 0 is "null". */
+  sieve->map = (Slot*)malloc(((size_t)end + 1) * sizeof(Slot));
+  sieve->shortcut = (TextIdx*)malloc((size_t)end * sizeof(TextIdx) + 1);
+  if (!hash_head || !sieve->map || !sieve->shortcut) {
+    free(hash_head);
+    return BROTLI_FALSE;
+  }
+  memset(&sieve->map[0], 0, sizeof(Slot));
+
+  for (i = 0; i < slice_len - 1; ++i) {
+    TextIdx v = data[i];
+    hash = (((hash << l_shift) | (hash >> r_shift)) & hash_mask) ^ v;
+  }
+  l_shift_x = (l_shift * (slice_len - 1)) % hash_len;
+  r_shift_x = hash_len - l_shift_x;
+  for (i = 0; i < end; ++i) {
+    TextIdx v = data[i + slice_len - 1];
+    TextIdx slot;
+    hash = (((hash << l_shift) | (hash >> r_shift)) & hash_mask) ^ v;
+
+    if (offsets[piece] == i) piece++;
+    slot = hash_head[hash];
+    while (slot != 0) {
+      Slot* item = &sieve->map[slot];
+      if (memcmp(data + i, data + item->offset, slice_len) == 0) {
+        if (item->mark != piece) {
+          item->mark = piece;
+          item->presence++;
+        }
+        break;
+      }
+      slot = item->next;
+    }
+    if (slot == 0) {
+      Slot* item = &sieve->map[num_slots];
+      item->next = hash_head[hash];
+      item->offset = i;
+      item->presence = 1;
+      item->mark = piece;
+      hash_head[hash] = num_slots;
+      slot = num_slots++;
+    }
+    sieve->shortcut[i] = slot;
+    v = data[i];
+    hash ^= ((v << l_shift_x) | (v >> r_shift_x)) & hash_mask;
+  }
+  sieve->iteration = piece;
+  free(hash_head);
+  return BROTLI_TRUE;
+}
+
+/* Finds selection parameters that produce output closest to |target_size|. */
+static void ChooseSelection(Sieve* sieve, TextIdx target_size,
+    SampleIdx num_samples, TextIdx* middle, SampleIdx* min_presence) {
+  TextIdx end = sieve->end;
+  SampleIdx a = 1;
+  SampleIdx b = num_samples;
+  TextIdx size = Select(sieve, end, a, NULL);
+  TextIdx c = 0;
+  TextIdx d = end;
+  *middle = end;
+  *min_presence = a;
+  /* Maximal output is smaller than target. */
+  if (size <= target_size) return;
+
+  size = Select(sieve, end, b, NULL);
+  *min_presence = b;
+  if (size == target_size) return;
+  if (size < target_size) {
+    /* size(a) > target_size > size(b) && a < m < b */
+    while (a + 1 < b) {
+      SampleIdx m = (SampleIdx)((a + b) / 2);
+      size = Select(sieve, end, m, NULL);
+      if (size < target_size) {
+        b = m;
+      } else if (size > target_size) {
+        a = m;
+      } else {
+        *min_presence = m;
+        return;
+      }
+    }
+  } else {
+    a = b;
+  }
+  /* size(min_presence) > target_size > size(min_presence + 1) */
+  *min_presence = a;
+  /* size(c) < target_size < size(d) && c < m < d */
+  while (c + 1 < d) {
+    TextIdx m = (c + d) / 2;
+    size = Select(sieve, m, a, NULL);
+    if (size < target_size) {
+      c = m;
+    } else if (size > target_size) {
+      d = m;
+    } else {
+      *middle = m;
+      return;
+    }
+  }
+  *middle = c;
+  /* Slices that are present in a single sample are useless; unlike
+     research/sieve.cc, don't do this for |a| == 2, as it would exceed the
+     target size. */
+  if (a == 1) {
+    *min_presence = 2;
+    *middle = end;
+  }
+}
+
+uint8_t* BrotliGenerateDictionary(size_t dictionary_size_limit,
+    size_t slice_len, size_t num_samples, const size_t* sample_sizes,
+    const uint8_t* sample_data, size_t* dictionary_size) {
+  Sieve sieve;
+  TextIdx target_size = (TextIdx)dictionary_size_limit;
+  TextIdx total = 0;
+  TextIdx* offsets;
+  TextIdx middle;
+  SampleIdx min_presence;
+  uint8_t* result = NULL;
+  size_t i;
+
+  *dictionary_size = 0;
+  if (target_size != dictionary_size_limit || target_size == kNowhere) {
+    fprintf(stderr, "dictionary size limit is too large\n");
+    return NULL;
+  }
+  if (slice_len < 4 || slice_len > 256) {
+    fprintf(stderr, "slice length should be in range 4..256\n");
+    return NULL;
+  }
+  if (num_samples == 0 || num_samples > BROTLI_MAX_DICTIONARY_SAMPLES) {
+    fprintf(stderr, "number of samples should be in range 1..%d\n",
+            BROTLI_MAX_DICTIONARY_SAMPLES);
+    return NULL;
+  }
+  offsets = (TextIdx*)malloc(num_samples * sizeof(TextIdx));
+  if (!offsets) return NULL;
+  for (i = 0; i < num_samples; ++i) {
+    TextIdx delta = (TextIdx)sample_sizes[i];
+    if (delta != sample_sizes[i] || total + delta < total ||
+        ((total + delta) * 2u < total + delta)) {
+      fprintf(stderr, "corpus is too large\n");
+      free(offsets);
+      return NULL;
+    }
+    if (delta == 0) {
+      fprintf(stderr, "empty samples are prohibited\n");
+      free(offsets);
+      return NULL;
+    }
+    total += delta;
+    offsets[i] = total;
+  }
+  if (total <= slice_len) {
+    fprintf(stderr, "slice length is larger than corpus size\n");
+    free(offsets);
+    return NULL;
+  }
+
+  sieve.data = sample_data;
+  sieve.slice_len = (TextIdx)slice_len;
+  sieve.map = NULL;
+  sieve.shortcut = NULL;
+  sieve.end = total - sieve.slice_len;
+  sieve.iteration = 0;
+  if (BuildMap(&sieve, offsets)) {
+    ChooseSelection(&sieve, target_size, (SampleIdx)num_samples,
+                    &middle, &min_presence);
+    *dictionary_size = Select(&sieve, middle, min_presence, NULL);
+    result = (uint8_t*)malloc(*dictionary_size + 1);
+    if (result) {
+      Select(&sieve, middle, min_presence, result);
+    } else {
+      *dictionary_size = 0;
+    }
+  }
+  free(sieve.map);
+  free(sieve.shortcut);
+  free(offsets);
+  return result;
+}
+
+/* Custom words are case-normalized; case is restored with transforms. */
+#define WORD_CASE_AS_IS 0
+#define WORD_CASE_UPPER_FIRST 1
+#define WORD_CASE_UPPER_ALL 2
+#define NUM_WORD_CASES 3
+
+#define MIN_WORD_LENGTH 4
+#define MAX_WORD_LENGTH 31
+/* Size bits are limited to 15 by format. */
+#define MAX_WORDS_PER_LENGTH (1u << 15)
+#define MAX_CUSTOM_TRANSFORMS 64
+#define MIN_TRANSFORM_USE 4
+/* Index of "no affix" in transform statistics. */
+#define NO_AFFIX 256
+
+/* Copied from transform.h; it is not a part of public API. */
+#define TRANSFORM_IDENTITY 0
+#define TRANSFORM_UPPERCASE_FIRST 10
+#define TRANSFORM_UPPERCASE_ALL 11
+
+typedef struct WordStat {
+  /* Position of the first occurrence; 0-length marks empty slot. */
+  uint32_t offset;
+  uint8_t length;
+  uint8_t word_case;
+  uint8_t selected;
+  /* Last sample the word was seen in. */
+  uint32_t last_sample;
+  uint32_t count;
+  uint32_t num_samples;
+} WordStat;
+
+typedef struct WordTable {
+  const uint8_t* data;
+  WordStat* slots;
+  size_t capacity;  /* power of 2 */
+  size_t size;
+} WordTable;
+
+typedef struct Candidate {
+  uint64_t score;
+  size_t slot;
+} Candidate;
+
+typedef struct TransformCandidate {
+  uint32_t count;
+  uint16_t prefix;  /* byte or NO_AFFIX */
+  uint16_t suffix;  /* byte or NO_AFFIX */
+  uint8_t word_case;
+} TransformCandidate;
+
+static BROTLI_BOOL IsWordByte(uint8_t c) {
+  return TO_BROTLI_BOOL((c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') ||
+                        (c >= 'A' && c <= 'Z') || c >= 0x80);
+}
+
+static BROTLI_BOOL IsUpper(uint8_t c) {
+  return TO_BROTLI_BOOL(c >= 'A' && c <= 'Z');
+}
+
+/* Uppercase transforms also alter non-ASCII characters; only ASCII words
+   are considered for case normalization. */
+static uint8_t GetWordCase(const uint8_t* word, size_t length) {
+  size_t num_upper = 0;
+  size_t num_lower = 0;
+  size_t i;
+  if (!IsUpper(word[0])) return WORD_CASE_AS_IS;
+  for (i = 1; i < length; ++i) {
+    if (word[i] >= 0x80) return WORD_CASE_AS_IS;
+    if (IsUpper(word[i])) num_upper++;
+    if (word[i] >= 'a' && word[i] <= 'z') num_lower++;
+  }
+  if (num_lower == 0 && num_upper != 0) return WORD_CASE_UPPER_ALL;
+  return WORD_CASE_UPPER_FIRST;
+}
+
+static uint8_t NormalizedByte(
+    const uint8_t* word, size_t i, uint8_t word_case) {
+  uint8_t c = word[i];
+  if (word_case == WORD_CASE_UPPER_ALL ||
+      (word_case == WORD_CASE_UPPER_FIRST && i == 0)) {
+    if (IsUpper(c)) c = (uint8_t)(c | 0x20);
+  }
+  return c;
+}
+
+static uint32_t HashWord(const uint8_t* word, size_t length,
+                         uint8_t word_case) {
+  uint32_t h = 0x811C9DC5u;
+  size_t i;
+  for (i = 0; i < length; ++i) {
+    h = (h ^ NormalizedByte(word, i, word_case)) * 0x01000193u;
+  }
+  return h;
+}
+
+static BROTLI_BOOL SameWord(const WordTable* table, const WordStat* stat,
+    const uint8_t* word, size_t length, uint8_t word_case) {
+  const uint8_t* other = table->data + stat->offset;
+  size_t i;
+  if (stat->length != length) return BROTLI_FALSE;
+  for (i = 0; i < length; ++i) {
+    if (NormalizedByte(other, i, stat->word_case) !=
+        NormalizedByte(word, i, word_case)) {
+      return BROTLI_FALSE;
+    }
+  }
+  return BROTLI_TRUE;
+}
+
+/* Returns slot of (normalized) word, or |table->capacity| if not found. */
+static size_t FindWord(const WordTable* table, const uint8_t* word,
+                       size_t length, uint8_t word_case) {
+  size_t mask = table->capacity - 1;
+  size_t slot = HashWord(word, length, word_case) & mask;
+  while (table->slots[slot].length != 0) {
+    if (SameWord(table, &table->slots[slot], word, length, word_case)) {
+      return slot;
+    }
+    slot = (slot + 1) & mask;
+  }
+  return table->capacity;
+}
+
+static BROTLI_BOOL GrowWordTable(WordTable* table) {
+  size_t new_capacity = table->capacity * 2;
+  WordStat* new_slots = (WordStat*)calloc(new_capacity, sizeof(WordStat));
+  size_t i;
+  if (!new_slots) return BROTLI_FALSE;
+  for (i = 0; i < table->capacity; ++i) {
+    const WordStat* stat = &table->slots[i];
+    size_t slot;
+    if (stat->length == 0) continue;
+    slot = HashWord(table->data + stat->offset, stat->length,
+                    stat->word_case) & (new_capacity - 1);
+    while (new_slots[slot].length != 0) {
+      slot = (slot + 1) & (new_capacity - 1);
+    }
+    new_slots[slot] = *stat;
+  }
+  free(table->slots);
+  table->slots = new_slots;
+  table->capacity = new_capacity;
+  return BROTLI_TRUE;
+}
+
+static BROTLI_BOOL AddWord(WordTable* table, uint32_t offset, size_t length,
+                           uint32_t sample) {
+  const uint8_t* word = table->data + offset;
+  uint8_t word_case = GetWordCase(word, length);
+  size_t slot = FindWord(table, word, length, word_case);
+  WordStat* stat;
+  if (slot == table->capacity) {
+    if (2 * (table->size + 1) > table->capacity) {
+      if (!GrowWordTable(table)) return BROTLI_FALSE;
+    }
+    slot = HashWord(word, length, word_case) & (table->capacity - 1);
+    while (table->slots[slot].length != 0) {
+      slot = (slot + 1) & (table->capacity - 1);
+    }
+    stat = &table->slots[slot];
+    stat->offset = offset;
+    stat->length = (uint8_t)length;
+    stat->word_case = word_case;
+    table->size++;
+  }
+  stat = &table->slots[slot];
+  stat->count++;
+  if (stat->num_samples == 0 || stat->last_sample != sample) {
+    stat->num_samples++;
+    stat->last_sample = sample;
+  }
+  return BROTLI_TRUE;
+}
+
+static int CompareCandidates(const void* a, const void* b) {
+  const Candidate* x = (const Candidate*)a;
+  const Candidate* y = (const Candidate*)b;
+  if (x->score != y->score) return (x->score > y->score) ? -1 : 1;
+  return (x->slot < y->slot) ? -1 : 1;
+}
+
+static int CompareTransforms(const void* a, const void* b) {
+  const TransformCandidate* x = (const TransformCandidate*)a;
+  const TransformCandidate* y = (const TransformCandidate*)b;
+  if (x->count != y->count) return (x->count > y->count) ? -1 : 1;
+  if (x->word_case != y->word_case) return x->word_case - y->word_case;
+  if (x->prefix != y->prefix) return x->prefix - y->prefix;
+  return x->suffix - y->suffix;
+}
+
+/* Selects up to |size_limit| bytes of most valuable words. Number of words
+   of each length is a power of 2 (or 0). */
+static BROTLI_BOOL SelectWords(WordTable* table, size_t size_limit,
+    uint32_t min_samples, size_t* num_words_by_length) {
+  Candidate* candidates;
+  size_t taken[MAX_WORD_LENGTH + 1];
+  size_t num_candidates = 0;
+  size_t total = 0;
+  size_t i;
+  size_t l;
+  candidates = (Candidate*)malloc((table->size + 1) * sizeof(Candidate));
+  if (!candidates) return BROTLI_FALSE;
+  for (i = 0; i < table->capacity; ++i) {
+    const WordStat* stat = &table->slots[i];
+    if (stat->length == 0) continue;
+    if (stat->count < 2 || stat->num_samples < min_samples) continue;
+    /* Rough estimation of saved bytes; dictionary reference costs ~3. */
+    candidates[num_candidates].score =
+        (uint64_t)stat->count * (uint64_t)(stat->length - 3);
+    candidates[num_candidates].slot = i;
+    num_candidates++;
+  }
+  qsort(candidates, num_candidates, sizeof(Candidate), CompareCandidates);
+  memset(taken, 0, sizeof(taken));
+  for (i = 0; i < num_candidates; ++i) {
+    const WordStat* stat = &table->slots[candidates[i].slot];
+    if (total + stat->length > size_limit) continue;
+    if (taken[stat->length] == MAX_WORDS_PER_LENGTH) continue;
+    taken[stat->length]++;
+    total += stat->length;
+  }
+  /* Round counts down to powers of 2; least valuable words are dropped. */
+  for (l = 0; l <= MAX_WORD_LENGTH; ++l) {
+    size_t keep = 1;
+    while (keep * 2 <= taken[l]) keep *= 2;
+    num_words_by_length[l] = (keep < 2) ? 0 : keep;
+    taken[l] = 0;
+  }
+  for (i = 0; i < num_candidates; ++i) {
+    WordStat* stat = &table->slots[candidates[i].slot];
+    if (taken[stat->length] == num_words_by_length[stat->length]) continue;
+    stat->selected = 1;
+    /* From now on |last_sample| is the index of word in the list. */
+    stat->last_sample = (uint32_t)taken[stat->length]++;
+  }
+  free(candidates);
+  return BROTLI_TRUE;
+}
+
+/* Calls |AddWord| or collects transform statistics for each word of each
+   sample. */
+static BROTLI_BOOL ScanWords(WordTable* table, size_t num_samples,
+    const size_t* sample_sizes, uint32_t* transform_stats) {
+  const uint8_t* data = table->data;
+  size_t sample_start = 0;
+  size_t s;
+  for (s = 0; s < num_samples; ++s) {
+    size_t sample_end = sample_start + sample_sizes[s];
+    size_t pos = sample_start;
+    while (pos < sample_end) {
+      size_t start;
+      size_t length;
+      if (!IsWordByte(data[pos])) {
+        pos++;
+        continue;
+      }
+      start = pos;
+      while (pos < sample_end && IsWordByte(data[pos])) pos++;
+      length = pos - start;
+      if (length < MIN_WORD_LENGTH || length > MAX_WORD_LENGTH) continue;
+      if (!transform_stats) {
+        if (!AddWord(table, (uint32_t)start, length, (uint32_t)s)) {
+          return BROTLI_FALSE;
+        }
+      } else {
+        uint8_t word_case = GetWordCase(data + start, length);
+        size_t slot = FindWord(table, data + start, length, word_case);
+        size_t prefix = (start > sample_start) ? data[start - 1] : NO_AFFIX;
+        size_t suffix = (pos < sample_end) ? data[pos] : NO_AFFIX;
+        if (slot == table->capacity || !table->slots[slot].selected) continue;
+        transform_stats[(prefix * NUM_WORD_CASES + word_case) *
+                        (NO_AFFIX + 1) + suffix]++;
+      }
+    }
+    sample_start = sample_end;
+  }
+  return BROTLI_TRUE;
+}
+
+/* Chooses transforms by the number of selected word occurrences they would
+   reproduce with surrounding characters. */
+static size_t SelectTransforms(const uint32_t* transform_stats,
+    TransformCandidate* transforms) {
+  TransformCandidate* candidates;
+  size_t num_candidates = 0;
+  size_t num_transforms = 1;
+  size_t p;
+  size_t c;
+  size_t n;
+  size_t i;
+  /* Each candidate is (prefix or none, case, suffix or none). */
+  candidates = (TransformCandidate*)calloc(
+      (NO_AFFIX + 1) * NUM_WORD_CASES * (NO_AFFIX + 1),
+      sizeof(TransformCandidate));
+  if (!candidates) return 0;
+  for (p = 0; p <= NO_AFFIX; ++p) {
+    for (c = 0; c < NUM_WORD_CASES; ++c) {
+      for (n = 0; n <= NO_AFFIX; ++n) {
+        TransformCandidate* t = &candidates[
+            (p * NUM_WORD_CASES + c) * (NO_AFFIX + 1) + n];
+        t->prefix = (uint16_t)p;
+        t->word_case = (uint8_t)c;
+        t->suffix = (uint16_t)n;
+      }
+    }
+  }
+  /* Transform with empty prefix (suffix) also matches occurrences with
+     any prefix (suffix). */
+  for (p = 0; p <= NO_AFFIX; ++p) {
+    for (c = 0; c < NUM_WORD_CASES; ++c) {
+      for (n = 0; n <= NO_AFFIX; ++n) {
+        uint32_t count = transform_stats[
+            (p * NUM_WORD_CASES + c) * (NO_AFFIX + 1) + n];
+        if (count == 0) continue;
+        candidates[(p * NUM_WORD_CASES + c) * (NO_AFFIX + 1) + n].count +=
+            (p != NO_AFFIX && n != NO_AFFIX) ? count : 0;
+        if (p != NO_AFFIX) {
+          candidates[(p * NUM_WORD_CASES + c) * (NO_AFFIX + 1) + NO_AFFIX]
+              .count += count;
+        }
+        if (n != NO_AFFIX) {
+          candidates[(NO_AFFIX * NUM_WORD_CASES + c) * (NO_AFFIX + 1) + n]
+              .count += count;
+        }
+        candidates[(NO_AFFIX * NUM_WORD_CASES + c) * (NO_AFFIX + 1) +
+                   NO_AFFIX].count += count;
+      }
+    }
+  }
+  num_candidates = (NO_AFFIX + 1) * NUM_WORD_CASES * (NO_AFFIX + 1);
+  qsort(candidates, num_candidates, sizeof(TransformCandidate),
+        CompareTransforms);
+  /* Identity goes first; encoder expects it there. */
+  transforms[0].prefix = NO_AFFIX;
+  transforms[0].word_case = WORD_CASE_AS_IS;
+  transforms[0].suffix = NO_AFFIX;
+  for (i = 0; i < num_candidates; ++i) {
+    const TransformCandidate* t = &candidates[i];
+    if (num_transforms == MAX_CUSTOM_TRANSFORMS) break;
+    if (t->count < MIN_TRANSFORM_USE) break;
+    if (t->prefix == NO_AFFIX && t->suffix == NO_AFFIX &&
+        t->word_case == WORD_CASE_AS_IS) {
+      continue;
+    }
+    transforms[num_transforms++] = *t;
+  }
+  free(candidates);
+  return num_transforms;
+}
+
+static size_t WriteVarint(uint8_t* out, size_t value) {
+  size_t pos = 0;
+  while (value >= 128) {
+    if (out) out[pos] = (uint8_t)((value & 127) | 128);
+    pos++;
+    value >>= 7;
+  }
+  if (out) out[pos] = (uint8_t)value;
+  return pos + 1;
+}
+
+/* Serializes shared dictionary; if |out| is NULL, only computes size. */
+static size_t SerializeSharedDictionary(const uint8_t* prefix,
+    size_t prefix_size, const WordTable* table,
+    const size_t* num_words_by_length, const TransformCandidate* transforms,
+    size_t num_transforms, uint8_t* out) {
+  /* Index of stringlet for each affix byte; 0 means not used. */
+  size_t stringlet_index[NO_AFFIX + 1];
+  size_t num_stringlets = 0;
+  size_t offsets[MAX_WORD_LENGTH + 1];
+  size_t pos = 0;
+  size_t words_size = 0;
+  size_t affixes_size = 1;
+  size_t i;
+  size_t l;
+
+  /* Magic. */
+  if (out) {
+    out[0] = 0x91;
+    out[1] = 0;
+  }
+  pos += 2;
+  pos += WriteVarint(out ? out + pos : NULL, prefix_size);
+  if (out && prefix_size) memcpy(out + pos, prefix, prefix_size);
+  pos += prefix_size;
+
+  /* Single word list. */
+  if (out) out[pos] = 1;
+  pos++;
+  for (l = MIN_WORD_LENGTH; l <= MAX_WORD_LENGTH; ++l) {
+    uint8_t bits = 0;
+    while (((size_t)1 << bits) < num_words_by_length[l]) bits++;
+    if (out) out[pos] = bits;
+    pos++;
+    offsets[l] = words_size;
+    words_size += l * num_words_by_length[l];
+  }
+  if (out) {
+    for (i = 0; i < table->capacity; ++i) {
+      const WordStat* stat = &table->slots[i];
+      uint8_t* dst;
+      if (stat->length == 0 || !stat->selected) continue;
+      dst = out + pos + offsets[stat->length] +
+          stat->length * stat->last_sample;
+      for (l = 0; l < stat->length; ++l) {
+        dst[l] = NormalizedByte(table->data + stat->offset, l,
+                                stat->word_case);
+      }
+    }
+  }
+  pos += words_size;
+
+  /* Single transform list; stringlets are single bytes, the terminating
+     empty stringlet serves as an empty affix. */
+  memset(stringlet_index, 0, sizeof(stringlet_index));
+  for (i = 0; i < num_transforms; ++i) {
+    size_t affix[2];
+    size_t k;
+    affix[0] = transforms[i].prefix;
+    affix[1] = transforms[i].suffix;
+    for (k = 0; k < 2; ++k) {
+      if (affix[k] == NO_AFFIX || stringlet_index[affix[k]] != 0) continue;
+      stringlet_index[affix[k]] = ++num_stringlets;
+      affixes_size += 2;
+    }
+  }
+  if (out) out[pos] = 1;
+  pos++;
+  if (out) {
+    out[pos] = (uint8_t)(affixes_size & 0xFF);
+    out[pos + 1] = (uint8_t)(affixes_size >> 8);
+    for (i = 0; i < NO_AFFIX; ++i) {
+      size_t index = stringlet_index[i];
+      if (index == 0) continue;
+      out[pos + 2 + 2 * (index - 1)] = 1;
+      out[pos + 2 + 2 * (index - 1) + 1] = (uint8_t)i;
+    }
+    out[pos + 2 + affixes_size - 1] = 0;
+  }
+  pos += 2 + affixes_size;
+  if (out) out[pos] = (uint8_t)num_transforms;
+  pos++;
+  for (i = 0; i < num_transforms; ++i) {
+    if (out) {
+      const TransformCandidate* t = &transforms[i];
+      static const uint8_t kCaseTransform[NUM_WORD_CASES] = {
+        TRANSFORM_IDENTITY, TRANSFORM_UPPERCASE_FIRST, TRANSFORM_UPPERCASE_ALL
+      };
+      out[pos] = (uint8_t)((t->prefix == NO_AFFIX) ?
+          num_stringlets : stringlet_index[t->prefix] - 1);
+      out[pos + 1] = kCaseTransform[t->word_case];
+      out[pos + 2] = (uint8_t)((t->suffix == NO_AFFIX) ?
+          num_stringlets : stringlet_index[t->suffix] - 1);
+    }
+    pos += 3;
+  }
+
+  /* Single dictionary, no context map. */
+  if (out) {
+    out[pos] = 1;
+    out[pos + 1] = 0;
+    out[pos + 2] = 0;
+    out[pos + 3] = 0;
+  }
+  pos += 4;
+  return pos;
+}
+
+uint8_t* BrotliGenerateSharedDictionary(size_t dictionary_size_limit,
+    size_t words_size_limit, size_t slice_len, size_t num_samples,
+    const size_t* sample_sizes, const uint8_t* sample_data,
+    size_t* dictionary_size) {
+  uint8_t* prefix = NULL;
+  size_t prefix_size = 0;
+  size_t overhead = 0;
+  WordTable table;
+  size_t num_words_by_length[MAX_WORD_LENGTH + 1];
+  TransformCandidate transforms[MAX_CUSTOM_TRANSFORMS];
+  size_t num_transforms = 0;
+  uint32_t* transform_stats = NULL;
+  uint8_t* result = NULL;
+  BROTLI_BOOL is_ok = BROTLI_TRUE;
+
+  *dictionary_size = 0;
+  if (num_samples == 0 || num_samples > BROTLI_MAX_DICTIONARY_SAMPLES) {
+    fprintf(stderr, "number of samples should be in range 1..%d\n",
+            BROTLI_MAX_DICTIONARY_SAMPLES);
+    return NULL;
+  }
+  if (words_size_limit > dictionary_size_limit) {
+    words_size_limit = dictionary_size_limit;
+  }
+
+  table.data = sample_data;
+  table.capacity = 1 << 16;
+  table.size = 0;
+  table.slots = (WordStat*)calloc(table.capacity, sizeof(WordStat));
+  transform_stats = (uint32_t*)calloc(
+      (NO_AFFIX + 1) * NUM_WORD_CASES * (NO_AFFIX + 1), sizeof(uint32_t));
+  is_ok = TO_BROTLI_BOOL(table.slots && transform_stats);
+  if (is_ok) is_ok = ScanWords(&table, num_samples, sample_sizes, NULL);
+  if (is_ok) {
+    is_ok = SelectWords(&table, words_size_limit,
+        (num_samples > 1) ? 2 : 1, num_words_by_length);
+  }
+  if (is_ok) {
+    is_ok = ScanWords(&table, num_samples, sample_sizes, transform_stats);
+  }
+  if (is_ok) {
+    num_transforms = SelectTransforms(transform_stats, transforms);
+    is_ok = TO_BROTLI_BOOL(num_transforms != 0);
+  }
+  if (is_ok) {
+    /* Prefix length varint takes up to 4 more bytes. */
+    overhead = SerializeSharedDictionary(NULL, 0, &table,
+        num_words_by_length, transforms, num_transforms, NULL) + 4;
+    if (overhead > dictionary_size_limit) {
+      fprintf(stderr, "dictionary size limit is too small\n");
+      is_ok = BROTLI_FALSE;
+    }
+  }
+  /* The rest of the budget is spent on LZ77 prefix. */
+  if (is_ok && dictionary_size_limit - overhead >= slice_len) {
+    prefix = BrotliGenerateDictionary(dictionary_size_limit - overhead,
+        slice_len, num_samples, sample_sizes, sample_data, &prefix_size);
+    is_ok = TO_BROTLI_BOOL(prefix != NULL);
+  }
+  if (is_ok) {
+    *dictionary_size = SerializeSharedDictionary(prefix, prefix_size, &table,
+        num_words_by_length, transforms, num_transforms, NULL);
+    result = (uint8_t*)malloc(*dictionary_size);
+    if (result) {
+      SerializeSharedDictionary(prefix, prefix_size, &table,
+          num_words_by_length, transforms, num_transforms, result);
+    } else {
+      *dictionary_size = 0;
+    }
+  }
+  free(transform_stats);
+  free(table.slots);
+  free(prefix);
+  return result;
+}
@@ -0,0 +1,60 @@
+/* Copyright 2025 Google Inc. All Rights Reserved.
+
+   Distributed under MIT license.
+   See file LICENSE for detail or copy at https://opensource.org/licenses/MIT
+*/
+
+/* Dictionary generators used by "brotli --train". */
+
+#ifndef BROTLI_TOOLS_DICTIONARY_GENERATOR_H_
+#define BROTLI_TOOLS_DICTIONARY_GENERATOR_H_
+
+#include <stddef.h>
+
+#include <brotli/types.h>
+
+#if defined(__cplusplus) || defined(c_plusplus)
+extern "C" {
+#endif
+
+/* Maximal number of samples; each sample should be a separate document. */
+#define BROTLI_MAX_DICTIONARY_SAMPLES 32767
+
+/* Generates a dictionary of at most |dictionary_size_limit| bytes for the
+   given samples with the "sieve" engine (see research/sieve.cc): slices of
+   |slice_len| bytes are ranked by the number of samples they occur in, and
+   the most popular ones are glued together.
+
+   Memory usage is about 17 bytes per byte of |sample_data|.
+
+   Returns NULL if input is invalid (the reason is reported to stderr) or
+   memory is exhausted. Otherwise result is allocated with malloc and its
+   length is stored to |*dictionary_size|. */
+uint8_t* BrotliGenerateDictionary(size_t dictionary_size_limit,
+    size_t slice_len, size_t num_samples, const size_t* sample_sizes,
+    const uint8_t* sample_data, size_t* dictionary_size);
+
+/* Generates a serialized shared dictionary of at most |dictionary_size_limit|
+   bytes for the given samples. It contains a custom word list of at most
+   |words_size_limit| bytes with a transform list tuned for it; the rest of
+   the budget is spent on a raw (LZ77 prefix) part generated with
+   BrotliGenerateDictionary.
+
+   Words are the most frequent runs of 4..31 alphanumeric (or non-ASCII)
+   characters seen in at least 2 samples; capitalized words are stored in
+   lower case and restored with "uppercase" transforms. Transforms add the
+   most frequent single-character prefixes / suffixes of the chosen words.
+
+   Result could be used only with library built with BROTLI_EXPERIMENTAL.
+   Memory ownership and error reporting are the same as for
+   BrotliGenerateDictionary. */
+uint8_t* BrotliGenerateSharedDictionary(size_t dictionary_size_limit,
+    size_t words_size_limit, size_t slice_len, size_t num_samples,
+    const size_t* sample_sizes, const uint8_t* sample_data,
+    size_t* dictionary_size);
+
+#if defined(__cplusplus) || defined(c_plusplus)
+}  /* extern "C" */
+#endif
+
+#endif  /* BROTLI_TOOLS_DICTIONARY_GENERATOR_H_ */
@@ -0,0 +1,175 @@
+/* Copyright 2025 Google Inc. All Rights Reserved.
+
+   Distributed under MIT license.
+   See file LICENSE for detail or copy at https://opensource.org/licenses/MIT
+*/
+
+/* Checks that encoder instance reused with BrotliEncoderReset gives the same
+   output as a new instance, when quality, window and large window mode change
+   from stream to stream, and when previous stream is not finished.
+
+   Usage: encoder_reset_test FILE */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <brotli/encode.h>
+#include <brotli/types.h>
+
+typedef struct Configuration {
+  /* Negative value leaves parameters of a reset instance as they are. */
+  int quality;
+  int lgwin;
+  BROTLI_BOOL large_window;
+} Configuration;
+
+/* Window, quality and mode go up and down; the first one checks that reset
+   instance has default parameters. */
+static const Configuration kConfigurations[] = {
+  {-1, 0, BROTLI_FALSE},
+  {1, 10, BROTLI_FALSE},
+  {9, 25, BROTLI_TRUE},
+  {11, 18, BROTLI_FALSE},
+  {0, 24, BROTLI_FALSE},
+  {5, 26, BROTLI_TRUE},
+  {10, 20, BROTLI_TRUE},
+  {4, 16, BROTLI_FALSE},
+  {11, 22, BROTLI_FALSE}
+};
+
+#define NUM_CONFIGURATIONS \
+  (sizeof(kConfigurations) / sizeof(kConfigurations[0]))
+
+static int failures = 0;
+
+static void Check(BROTLI_BOOL condition, const char* what, size_t index) {
+  if (!condition) {
+    fprintf(stderr, "FAILED: %s (configuration %d)\n", what, (int)index);
+    failures++;
+  }
+}
+
+static uint8_t* ReadFile(const char* path, size_t* size) {
+  FILE* f = fopen(path, "rb");
+  uint8_t* data;
+  long length;
+  if (!f) return NULL;
+  if (fseek(f, 0, SEEK_END) != 0 || (length = ftell(f)) < 0 ||
+      fseek(f, 0, SEEK_SET) != 0) {
+    fclose(f);
+    return NULL;
+  }
+  data = (uint8_t*)malloc((size_t)length + 1);
+  if (data && fread(data, 1, (size_t)length, f) != (size_t)length) {
+    free(data);
+    data = NULL;
+  }
+  fclose(f);
+  *size = (size_t)length;
+  return data;
+}
+
+static void Configure(BrotliEncoderState* s, const Configuration* config) {
+  if (config->quality < 0) return;
+  BrotliEncoderSetParameter(s, BROTLI_PARAM_QUALITY,
+      (uint32_t)config->quality);
+  BrotliEncoderSetParameter(s, BROTLI_PARAM_LGWIN, (uint32_t)config->lgwin);
+  BrotliEncoderSetParameter(s, BROTLI_PARAM_LARGE_WINDOW,
+      (uint32_t)config->large_window);
+}
+
+/* Returns compressed size, or 0 on failure. */
+static size_t Compress(BrotliEncoderState* s, const uint8_t* input,
+    size_t input_size, uint8_t* output, size_t output_capacity) {
+  const uint8_t* next_in = input;
+  size_t available_in = input_size;
+  uint8_t* next_out = output;
+  size_t available_out = output_capacity;
+  if (!BrotliEncoderCompressStream(s, BROTLI_OPERATION_FINISH, &available_in,
+          &next_in, &available_out, &next_out, NULL) ||
+      !BrotliEncoderIsFinished(s)) {
+    return 0;
+  }
+  return output_capacity - available_out;
+}
+
+/* Feeds half of input without finishing the stream. */
+static BROTLI_BOOL StartCompression(BrotliEncoderState* s,
+    const uint8_t* input, size_t input_size, uint8_t* output,
+    size_t output_capacity) {
+  const uint8_t* next_in = input;
+  size_t available_in = input_size / 2;
+  uint8_t* next_out = output;
+  size_t available_out = output_capacity;
+  return BrotliEncoderCompressStream(s, BROTLI_OPERATION_FLUSH,
+      &available_in, &next_in, &available_out, &next_out, NULL);
+}
+
+int main(int argc, char** argv) {
+  size_t input_size = 0;
+  uint8_t* input;
+  size_t capacity;
+  uint8_t* expected;
+  uint8_t* actual;
+  BrotliEncoderState* reused;
+  int pass;
+  size_t i;
+
+  if (argc != 2) {
+    fprintf(stderr, "usage: %s FILE\n", argv[0]);
+    return 2;
+  }
+  input = ReadFile(argv[1], &input_size);
+  if (!input) {
+    fprintf(stderr, "failed to read input\n");
+    return 2;
+  }
+  capacity = BrotliEncoderMaxCompressedSize(input_size);
+  expected = (uint8_t*)malloc(capacity);
+  actual = (uint8_t*)malloc(capacity);
+  reused = BrotliEncoderCreateInstance(NULL, NULL, NULL);
+  if (!capacity || !expected || !actual || !reused) {
+    fprintf(stderr, "out of memory\n");
+    return 2;
+  }
+
+  /* In the second pass stream of the next configuration is left unfinished
+     before reset. */
+  for (pass = 0; pass < 2; ++pass) {
+    for (i = 0; i < NUM_CONFIGURATIONS; ++i) {
+      const Configuration* config = &kConfigurations[i];
+      BrotliEncoderState* fresh =
+          BrotliEncoderCreateInstance(NULL, NULL, NULL);
+      size_t expected_size = 0;
+      size_t actual_size = 0;
+      if (fresh) {
+        Configure(fresh, config);
+        expected_size = Compress(fresh, input, input_size, expected, capacity);
+        BrotliEncoderDestroyInstance(fresh);
+      }
+      Check(expected_size != 0, "compression with new instance", i);
+      if (pass == 1) {
+        Check(BrotliEncoderReset(reused), "reset", i);
+        Configure(reused, &kConfigurations[(i + 1) % NUM_CONFIGURATIONS]);
+        Check(StartCompression(reused, input, input_size, actual, capacity),
+              "start of unfinished stream", i);
+      }
+      Check(BrotliEncoderReset(reused), "reset", i);
+      Configure(reused, config);
+      actual_size = Compress(reused, input, input_size, actual, capacity);
+      Check(actual_size == expected_size &&
+            memcmp(actual, expected, expected_size) == 0,
+            pass ? "reused instance after unfinished stream" :
+                   "reused instance", i);
+    }
+  }
+
+  BrotliEncoderDestroyInstance(reused);
+  free(expected);
+  free(actual);
+  free(input);
+  if (failures) return 1;
+  printf("OK\n");
+  return 0;
+}
@@ -0,0 +1,735 @@
+/* Copyright 2025 Google Inc. All Rights Reserved.
+
+   Distributed under MIT license.
+   See file LICENSE for detail or copy at https://opensource.org/licenses/MIT
+*/
+
+/* Checks serialization of prepared dictionaries: serialized dictionary is
+   loaded in place and gives the same output as the original one; truncated
+   and corrupted blobs are rejected. Cache of shared dictionary survives
+   save -> load -> save -> load (if library supports serialized dictionaries);
+   cache with damaged trie of words is rejected.
+   Dictionary parsed once is shared by several decoders; second custom static
+   dictionary is not accepted by decoder.
+   Serialized dictionary with chained index (produced by other generators)
+   is accepted and gives decodable output; broken chains are rejected.
+   Dictionary selection makes encoder search only one of attached dictionaries.
+
+   Usage: prepared_dictionary_test FILE
+   The first part of FILE is used as dictionary, the rest is compressed. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <brotli/decode.h>
+#include <brotli/encode.h>
+#include <brotli/shared_dictionary.h>
+#include <brotli/types.h>
+
+#include "../c/enc/encoder_dict.h"
+#include "../c/tools/dictionary_generator.h"
+
+#define DICTIONARY_SIZE 100000
+/* Serialized raw dictionary starts with 6 uint32_t header fields. */
+#define HEADER_NUM_ITEMS 1
+#define HEADER_SOURCE_SIZE 2
+#define HEADER_HASH_BITS 3
+#define HEADER_BUCKET_BITS 4
+#define HEADER_SLOT_BITS 5
+#define HEADER_SIZE 24
+/* Shared dictionary is trained on the dictionary part of input. */
+#define NUM_SAMPLES 10
+#define SHARED_DICTIONARY_SIZE 16384
+/* Chained index: 128 slots of 256 buckets each; chain is at most 16 items. */
+#define CHAINED_SLOT_BITS 7
+#define CHAINED_BUCKET_BITS 15
+#define CHAINED_HASH_BITS 40
+#define CHAINED_MAX_CHAIN 16
+/* Number of decoders that share the same parsed dictionary. */
+#define NUM_DECODERS 3
+
+static int failures = 0;
+
+static void Check(BROTLI_BOOL condition, const char* what) {
+  if (!condition) {
+    fprintf(stderr, "FAILED: %s\n", what);
+    failures++;
+  }
+}
+
+static uint8_t* ReadFile(const char* path, size_t* size) {
+  FILE* f = fopen(path, "rb");
+  uint8_t* data;
+  long length;
+  if (!f) return NULL;
+  if (fseek(f, 0, SEEK_END) != 0 || (length = ftell(f)) < 0 ||
+      fseek(f, 0, SEEK_SET) != 0) {
+    fclose(f);
+    return NULL;
+  }
+  data = (uint8_t*)malloc((size_t)length + 1);
+  if (data && fread(data, 1, (size_t)length, f) != (size_t)length) {
+    free(data);
+    data = NULL;
+  }
+  fclose(f);
+  *size = (size_t)length;
+  return data;
+}
+
+/* Compresses |input| and destroys |s|. Returns compressed size, or 0 on
+   failure. */
+static size_t CompressAndDestroy(BrotliEncoderState* s, const uint8_t* input,
+    size_t input_size, uint8_t* output, size_t output_capacity) {
+  const uint8_t* next_in = input;
+  size_t available_in = input_size;
+  uint8_t* next_out = output;
+  size_t available_out = output_capacity;
+  BROTLI_BOOL ok = TO_BROTLI_BOOL(
+      BrotliEncoderCompressStream(s, BROTLI_OPERATION_FINISH, &available_in,
+          &next_in, &available_out, &next_out, NULL) &&
+      BrotliEncoderIsFinished(s));
+  BrotliEncoderDestroyInstance(s);
+  return ok ? output_capacity - available_out : 0;
+}
+
+/* Returns compressed size, or 0 on failure. */
+static size_t Compress(const BrotliEncoderPreparedDictionary* dictionary,
+    int quality, const uint8_t* input, size_t input_size, uint8_t* output,
+    size_t output_capacity) {
+  BrotliEncoderState* s = BrotliEncoderCreateInstance(NULL, NULL, NULL);
+  if (!s) return 0;
+  BrotliEncoderSetParameter(s, BROTLI_PARAM_QUALITY, (uint32_t)quality);
+  if (!BrotliEncoderAttachPreparedDictionary(s, dictionary)) {
+    BrotliEncoderDestroyInstance(s);
+    return 0;
+  }
+  return CompressAndDestroy(s, input, input_size, output, output_capacity);
+}
+
+static BROTLI_BOOL Decompresses(BrotliSharedDictionaryType type,
+    size_t num_dictionaries, const size_t* dictionary_sizes,
+    const uint8_t* const* dictionaries,
+    const uint8_t* compressed, size_t compressed_size,
+    const uint8_t* expected, size_t expected_size) {
+  BrotliDecoderState* s = BrotliDecoderCreateInstance(NULL, NULL, NULL);
+  uint8_t* output = (uint8_t*)malloc(expected_size + 1);
+  const uint8_t* next_in = compressed;
+  size_t available_in = compressed_size;
+  uint8_t* next_out = output;
+  size_t available_out = expected_size + 1;
+  BROTLI_BOOL ok = TO_BROTLI_BOOL(s && output);
+  size_t i;
+  for (i = 0; ok && i < num_dictionaries; ++i) {
+    ok = BrotliDecoderAttachDictionary(
+        s, type, dictionary_sizes[i], dictionaries[i]);
+  }
+  if (ok) {
+    ok = TO_BROTLI_BOOL(BrotliDecoderDecompressStream(s, &available_in,
+            &next_in, &available_out, &next_out, NULL) ==
+        BROTLI_DECODER_RESULT_SUCCESS &&
+        expected_size + 1 - available_out == expected_size &&
+        memcmp(output, expected, expected_size) == 0);
+  }
+  if (s) BrotliDecoderDestroyInstance(s);
+  free(output);
+  return ok;
+}
+
+/* All decoders refer to |dictionary| and are alive at the same time; each one
+   decompresses |compressed|. */
+static BROTLI_BOOL DecompressesWithShared(
+    const BrotliSharedDictionary* dictionary,
+    const uint8_t* compressed, size_t compressed_size,
+    const uint8_t* expected, size_t expected_size) {
+  BrotliDecoderState* s[NUM_DECODERS];
+  uint8_t* output = (uint8_t*)malloc(expected_size + 1);
+  BROTLI_BOOL ok = TO_BROTLI_BOOL(output != NULL);
+  size_t i;
+  for (i = 0; i < NUM_DECODERS; ++i) {
+    s[i] = BrotliDecoderCreateInstance(NULL, NULL, NULL);
+    ok = TO_BROTLI_BOOL(ok && s[i] &&
+        BrotliDecoderAttachSharedDictionary(s[i], dictionary));
+  }
+  for (i = 0; ok && i < NUM_DECODERS; ++i) {
+    const uint8_t* next_in = compressed;
+    size_t available_in = compressed_size;
+    uint8_t* next_out = output;
+    size_t available_out = expected_size + 1;
+    ok = TO_BROTLI_BOOL(BrotliDecoderDecompressStream(s[i], &available_in,
+            &next_in, &available_out, &next_out, NULL) ==
+        BROTLI_DECODER_RESULT_SUCCESS &&
+        expected_size + 1 - available_out == expected_size &&
+        memcmp(output, expected, expected_size) == 0);
+  }
+  for (i = 0; i < NUM_DECODERS; ++i) {
+    if (s[i]) BrotliDecoderDestroyInstance(s[i]);
+  }
+  free(output);
+  return ok;
+}
+
+static void StoreField(uint8_t* blob, size_t field, uint32_t value) {
+  memcpy(blob + field * sizeof(uint32_t), &value, sizeof(value));
+}
+
+static uint32_t LoadField(const uint8_t* blob, size_t field) {
+  uint32_t value;
+  memcpy(&value, blob + field * sizeof(uint32_t), sizeof(value));
+  return value;
+}
+
+/* Checks that blob with |field| set to |value| is rejected. */
+static void CheckCorrupted(const uint8_t* blob, size_t size, uint8_t* copy,
+                           size_t field, uint32_t value, const char* what) {
+  memcpy(copy, blob, size);
+  StoreField(copy, field, value);
+  Check(!BrotliEncoderLoadPreparedDictionaryFromMemory(size, copy), what);
+}
+
+/* Result is allocated with malloc; NULL if dictionary is not serializable. */
+static uint8_t* Serialize(const BrotliEncoderPreparedDictionary* dictionary,
+                          size_t* size) {
+  uint8_t* result;
+  *size = 0;
+  BrotliEncoderSerializePreparedDictionary(dictionary, size, NULL);
+  if (*size == 0) return NULL;
+  /* malloc result is aligned well enough. */
+  result = (uint8_t*)malloc(*size);
+  if (result &&
+      !BrotliEncoderSerializePreparedDictionary(dictionary, size, result)) {
+    free(result);
+    result = NULL;
+  }
+  return result;
+}
+
+/* Cache is made from a dictionary that itself was loaded from cache. */
+/* |parsed| is a parsed form of serialized |shared| dictionary with custom
+   words; decoder can use only one custom static dictionary. */
+static void CheckSecondStaticDictionary(const BrotliSharedDictionary* parsed,
+    const uint8_t* shared, size_t shared_size) {
+  BrotliDecoderState* s = BrotliDecoderCreateInstance(NULL, NULL, NULL);
+  Check(s && BrotliDecoderAttachSharedDictionary(s, parsed) &&
+        !BrotliDecoderAttachSharedDictionary(s, parsed),
+        "second shared static dictionary is rejected");
+  if (s) BrotliDecoderDestroyInstance(s);
+  s = BrotliDecoderCreateInstance(NULL, NULL, NULL);
+  Check(s && BrotliDecoderAttachDictionary(s,
+            BROTLI_SHARED_DICTIONARY_SERIALIZED, shared_size, shared) &&
+        !BrotliDecoderAttachSharedDictionary(s, parsed),
+        "shared static dictionary after serialized one is rejected");
+  if (s) BrotliDecoderDestroyInstance(s);
+}
+
+/* Trie of words with custom transforms is the last part of the cache; the
+   last node with a word is damaged in different ways. */
+static void CheckCorruptedTrie(const uint8_t* shared, size_t shared_size,
+    const uint8_t* cache, size_t cache_size) {
+  static const char* kDamages[3] = {"word index out of range",
+      "word does not match trie path", "word length does not match path"};
+  uint8_t* copy = (uint8_t*)malloc(cache_size);
+  BrotliTrieNode node;
+  size_t pos = cache_size;
+  size_t i;
+  memset(&node, 0, sizeof(node));
+  while (pos >= sizeof(node) && !node.len_) {
+    pos -= sizeof(node);
+    memcpy(&node, cache + pos, sizeof(node));
+  }
+  if (!copy || !node.len_) {
+    Check(BROTLI_FALSE, "word in cached trie");
+    free(copy);
+    return;
+  }
+  for (i = 0; i < 3; ++i) {
+    BrotliTrieNode damaged = node;
+    BrotliEncoderPreparedDictionary* loaded;
+    if (i == 0) damaged.idx_ = 0xFFFFFFFFu;
+    if (i == 1) damaged.idx_ ^= 1u;
+    if (i == 2) damaged.len_ = (uint8_t)(node.len_ < 24 ? node.len_ + 1 : 4);
+    memcpy(copy, cache, cache_size);
+    memcpy(copy + pos, &damaged, sizeof(damaged));
+    loaded = BrotliEncoderPrepareDictionaryWithCache(
+        BROTLI_SHARED_DICTIONARY_SERIALIZED, shared_size, shared, cache_size,
+        copy, BROTLI_MAX_QUALITY, NULL, NULL, NULL);
+    Check(loaded == NULL, kDamages[i]);
+    BrotliEncoderDestroyPreparedDictionary(loaded);
+  }
+  free(copy);
+}
+
+static void CheckSharedDictionaryCache(const uint8_t* file,
+    const uint8_t* input, size_t input_size, uint8_t* expected,
+    uint8_t* actual, size_t capacity) {
+  size_t sample_sizes[NUM_SAMPLES];
+  size_t shared_size = 0;
+  uint8_t* shared;
+  BrotliEncoderPreparedDictionary* prepared;
+  BrotliEncoderPreparedDictionary* loaded = NULL;
+  BrotliEncoderPreparedDictionary* reloaded = NULL;
+  BrotliSharedDictionary* parsed = NULL;
+  uint8_t* cache;
+  uint8_t* recache = NULL;
+  size_t cache_size;
+  size_t recache_size = 0;
+  size_t i;
+
+  for (i = 0; i < NUM_SAMPLES; ++i) {
+    sample_sizes[i] = DICTIONARY_SIZE / NUM_SAMPLES;
+  }
+  shared = BrotliGenerateSharedDictionary(SHARED_DICTIONARY_SIZE,
+      SHARED_DICTIONARY_SIZE / 4, 16, NUM_SAMPLES, sample_sizes, file,
+      &shared_size);
+  if (!shared) {
+    Check(BROTLI_FALSE, "shared dictionary generation");
+    return;
+  }
+  prepared = BrotliEncoderPrepareDictionary(
+      BROTLI_SHARED_DICTIONARY_SERIALIZED, shared_size, shared,
+      BROTLI_MAX_QUALITY, NULL, NULL, NULL);
+  if (!prepared) {
+    printf("serialized dictionaries are not supported; "
+           "cache round trip is skipped\n");
+    Check(!BrotliEncoderPrepareDictionaryWithCache(
+              BROTLI_SHARED_DICTIONARY_SERIALIZED, shared_size, shared,
+              shared_size, shared, BROTLI_MAX_QUALITY, NULL, NULL, NULL),
+          "preparation with cache fails if unsupported");
+    free(shared);
+    return;
+  }
+
+  cache = Serialize(prepared, &cache_size);
+  Check(cache != NULL, "cache serialization");
+  if (cache) {
+    loaded = BrotliEncoderPrepareDictionaryWithCache(
+        BROTLI_SHARED_DICTIONARY_SERIALIZED, shared_size, shared, cache_size,
+        cache, BROTLI_MAX_QUALITY, NULL, NULL, NULL);
+    Check(loaded != NULL, "loading from cache");
+    CheckCorruptedTrie(shared, shared_size, cache, cache_size);
+  }
+  if (loaded) {
+    recache = Serialize(loaded, &recache_size);
+    Check(recache != NULL && recache_size == cache_size &&
+          memcmp(recache, cache, cache_size) == 0,
+          "cache of loaded dictionary is the same");
+  }
+  if (recache) {
+    reloaded = BrotliEncoderPrepareDictionaryWithCache(
+        BROTLI_SHARED_DICTIONARY_SERIALIZED, shared_size, shared,
+        recache_size, recache, BROTLI_MAX_QUALITY, NULL, NULL, NULL);
+    Check(reloaded != NULL, "loading from cache of loaded dictionary");
+  }
+  if (reloaded) {
+    const uint8_t* dictionaries[1];
+    size_t expected_size = Compress(
+        prepared, BROTLI_MAX_QUALITY, input, input_size, expected, capacity);
+    size_t actual_size = Compress(
+        reloaded, BROTLI_MAX_QUALITY, input, input_size, actual, capacity);
+    Check(expected_size != 0 && expected_size == actual_size &&
+          memcmp(expected, actual, actual_size) == 0,
+          "reloaded dictionary gives the same output");
+    dictionaries[0] = shared;
+    Check(Decompresses(BROTLI_SHARED_DICTIONARY_SERIALIZED, 1, &shared_size,
+                       dictionaries, actual, actual_size, input, input_size),
+          "output is decodable with shared dictionary");
+    parsed = BrotliSharedDictionaryCreateInstance(NULL, NULL, NULL);
+    Check(parsed && BrotliSharedDictionaryAttach(parsed,
+              BROTLI_SHARED_DICTIONARY_SERIALIZED, shared_size, shared),
+          "parsing of shared dictionary");
+    if (parsed) {
+      Check(DecompressesWithShared(
+                parsed, actual, actual_size, input, input_size),
+            "output is decodable by decoders sharing parsed dictionary");
+      CheckSecondStaticDictionary(parsed, shared, shared_size);
+    }
+  }
+
+  if (parsed) BrotliSharedDictionaryDestroyInstance(parsed);
+
+  BrotliEncoderDestroyPreparedDictionary(reloaded);
+  BrotliEncoderDestroyPreparedDictionary(loaded);
+  BrotliEncoderDestroyPreparedDictionary(prepared);
+  free(recache);
+  free(cache);
+  free(shared);
+}
+
+/* Counts references to each half of the compound dictionary. */
+typedef struct ReferenceCounts {
+  size_t split;
+  size_t first;
+  size_t second;
+} ReferenceCounts;
+
+static void CountReference(void* opaque, size_t offset, size_t length) {
+  ReferenceCounts* counts = (ReferenceCounts*)opaque;
+  (void)length;
+  if (offset < counts->split) {
+    counts->first++;
+  } else {
+    counts->second++;
+  }
+}
+
+/* Raw dictionary is parsed once and shared by several decoders. */
+static void CheckDecoderSharedDictionary(
+    const BrotliEncoderPreparedDictionary* prepared, const uint8_t* file,
+    const uint8_t* input, size_t input_size, uint8_t* output,
+    size_t capacity) {
+  size_t output_size =
+      Compress(prepared, 5, input, input_size, output, capacity);
+  BrotliSharedDictionary* parsed =
+      BrotliSharedDictionaryCreateInstance(NULL, NULL, NULL);
+  Check(output_size != 0, "compression with raw dictionary");
+  Check(parsed && BrotliSharedDictionaryAttach(parsed,
+            BROTLI_SHARED_DICTIONARY_RAW, DICTIONARY_SIZE, file),
+        "parsing of raw dictionary");
+  if (parsed) {
+    Check(DecompressesWithShared(
+              parsed, output, output_size, input, input_size),
+          "output is decodable by decoders sharing raw dictionary");
+    BrotliSharedDictionaryDestroyInstance(parsed);
+  }
+}
+
+/* Builds serialized "fat" dictionary with chained index: items of buckets
+   that belong to the same slot are stored together; chains are ended with
+   an item with the highest bit set. Returns NULL if out of memory. */
+static uint8_t* CreateChainedDictionary(const uint8_t* source,
+    size_t source_size, size_t* size) {
+  const size_t num_slots = (size_t)1 << CHAINED_SLOT_BITS;
+  const size_t num_buckets = (size_t)1 << CHAINED_BUCKET_BITS;
+  const uint64_t hash_mask =
+      (~((uint64_t)0U)) >> (64 - CHAINED_HASH_BITS);
+  uint8_t* lengths = (uint8_t*)calloc(num_buckets, 1);
+  uint8_t* filled = (uint8_t*)calloc(num_buckets, 1);
+  uint32_t* starts = (uint32_t*)malloc(num_buckets * sizeof(uint32_t));
+  uint8_t* blob = NULL;
+  PreparedDictionary header;
+  uint32_t* slot_offsets;
+  uint16_t* heads;
+  uint32_t* items;
+  uint32_t num_items = 0;
+  size_t pass;
+  size_t i;
+  size_t j;
+  if (!lengths || !filled || !starts) goto done;
+  for (pass = 0; pass < 2; ++pass) {
+    /* The most recent positions go first. */
+    for (i = (source_size >= 8) ? source_size - 7 : 0; i > 0; --i) {
+      const size_t pos = i - 1;
+      const uint64_t h = (BROTLI_UNALIGNED_LOAD64LE(&source[pos]) &
+          hash_mask) * kPreparedDictionaryHashMul64Long;
+      const size_t key = (size_t)(h >> (64 - CHAINED_BUCKET_BITS));
+      if (pass == 0) {
+        if (lengths[key] < CHAINED_MAX_CHAIN) lengths[key]++;
+      } else if (filled[key] < lengths[key]) {
+        items[starts[key] + filled[key]] = (uint32_t)pos;
+        filled[key]++;
+      }
+    }
+    if (pass != 0) break;
+    for (i = 0; i < num_buckets; ++i) num_items += lengths[i];
+    *size = sizeof(PreparedDictionary) + num_slots * sizeof(uint32_t) +
+        num_buckets * sizeof(uint16_t) + num_items * sizeof(uint32_t) +
+        source_size;
+    blob = (uint8_t*)malloc(*size);
+    if (!blob) goto done;
+    header.magic = kPreparedDictionaryMagic;
+    header.num_items = num_items;
+    header.source_size = (uint32_t)source_size;
+    header.hash_bits = CHAINED_HASH_BITS;
+    header.bucket_bits = CHAINED_BUCKET_BITS;
+    header.slot_bits = CHAINED_SLOT_BITS;
+    memcpy(blob, &header, sizeof(header));
+    slot_offsets = (uint32_t*)(blob + sizeof(PreparedDictionary));
+    heads = (uint16_t*)(&slot_offsets[num_slots]);
+    items = (uint32_t*)(&heads[num_buckets]);
+    memcpy(&items[num_items], source, source_size);
+    num_items = 0;
+    for (i = 0; i < num_slots; ++i) {
+      slot_offsets[i] = num_items;
+      for (j = i; j < num_buckets; j += num_slots) {
+        heads[j] = (uint16_t)(lengths[j] ? num_items - slot_offsets[i] :
+                                           0xFFFF);
+        starts[j] = num_items;
+        num_items += lengths[j];
+      }
+    }
+  }
+  for (i = 0; i < num_buckets; ++i) {
+    if (lengths[i]) items[starts[i] + lengths[i] - 1] |= 0x80000000u;
+  }
+
+done:
+  free(lengths);
+  free(filled);
+  free(starts);
+  return blob;
+}
+
+/* Checks that chained dictionary with |offset|-th uint32_t set to |value|
+   is rejected. */
+static void CheckCorruptedChained(const uint8_t* blob, size_t size,
+    uint8_t* copy, size_t offset, uint32_t value, const char* what) {
+  memcpy(copy, blob, size);
+  memcpy(copy + offset * sizeof(uint32_t), &value, sizeof(value));
+  Check(!BrotliEncoderLoadPreparedDictionaryFromMemory(size, copy), what);
+}
+
+static void CheckChainedDictionary(const uint8_t* file,
+    const uint8_t* input, size_t input_size, uint8_t* output,
+    size_t capacity) {
+  const size_t num_slots = (size_t)1 << CHAINED_SLOT_BITS;
+  const size_t num_buckets = (size_t)1 << CHAINED_BUCKET_BITS;
+  size_t dictionary_size = DICTIONARY_SIZE;
+  size_t size = 0;
+  uint8_t* blob = CreateChainedDictionary(file, DICTIONARY_SIZE, &size);
+  uint8_t* copy = (uint8_t*)malloc(size);
+  const BrotliEncoderPreparedDictionary* loaded;
+  /* Offsets (in uint32_t) of index parts. */
+  const size_t slots = HEADER_SIZE / sizeof(uint32_t);
+  const size_t heads = slots + num_slots;
+  const size_t items = heads + num_buckets / 2;
+  uint32_t num_items;
+  uint32_t last_item;
+  size_t plain_size = capacity;
+  int quality;
+  if (!blob || !copy) {
+    Check(BROTLI_FALSE, "creation of chained dictionary");
+    free(blob);
+    free(copy);
+    return;
+  }
+  num_items = LoadField(blob, HEADER_NUM_ITEMS);
+  last_item = LoadField(blob, items + num_items - 1);
+
+  loaded = BrotliEncoderLoadPreparedDictionaryFromMemory(size, blob);
+  Check(loaded != NULL, "loading of chained dictionary");
+  Check(BrotliEncoderCompress(5, BROTLI_DEFAULT_WINDOW, BROTLI_MODE_GENERIC,
+            input_size, input, &plain_size, output),
+        "compression without dictionary");
+  for (quality = 5; loaded && quality <= 11; quality += 6) {
+    size_t output_size =
+        Compress(loaded, quality, input, input_size, output, capacity);
+    Check(output_size != 0 && output_size < plain_size,
+          "chained dictionary is used");
+    Check(Decompresses(BROTLI_SHARED_DICTIONARY_RAW, 1, &dictionary_size,
+                       &file, output, output_size, input, input_size),
+          "output of chained dictionary is decodable with raw dictionary");
+  }
+
+  Check(!BrotliEncoderLoadPreparedDictionaryFromMemory(size - 1, blob),
+        "chained: last byte is missing");
+  CheckCorruptedChained(blob, size, copy, HEADER_SLOT_BITS, 0,
+      "chained: slot_bits 0");
+  CheckCorruptedChained(blob, size, copy, HEADER_SLOT_BITS,
+      CHAINED_BUCKET_BITS + 1, "chained: slot_bits above bucket_bits");
+  CheckCorruptedChained(blob, size, copy, HEADER_BUCKET_BITS,
+      CHAINED_SLOT_BITS + 16, "chained: too many buckets per slot");
+  CheckCorruptedChained(blob, size, copy, slots, num_items + 1,
+      "chained: slot offset out of range");
+  /* Last slot has less than 0xFFFE items, so the chain of its last bucket
+     would start after the last item. */
+  {
+    const uint16_t head = 0xFFFE;
+    memcpy(copy, blob, size);
+    memcpy(copy + heads * sizeof(uint32_t) +
+           (num_buckets - 1) * sizeof(uint16_t), &head, sizeof(head));
+    Check(!BrotliEncoderLoadPreparedDictionaryFromMemory(size, copy),
+          "chained: chain head out of range");
+  }
+  /* Last slot has non-empty buckets; no items are left for them. */
+  CheckCorruptedChained(blob, size, copy, heads - 1, num_items,
+      "chained: chain head beyond items");
+  CheckCorruptedChained(blob, size, copy, items + num_items - 1,
+      last_item & 0x7FFFFFFFu, "chained: last chain is not ended");
+  CheckCorruptedChained(blob, size, copy, items,
+      (LoadField(blob, items) & 0x80000000u) | DICTIONARY_SIZE,
+      "chained: item offset out of range");
+
+  free(copy);
+  free(blob);
+}
+
+/* Both halves of dictionary part of file are attached as separate
+   dictionaries; both are useful for input, but with selection only one is
+   searched. */
+static void CheckDictionarySelection(const uint8_t* file,
+    const uint8_t* input, size_t input_size, uint8_t* output,
+    size_t capacity) {
+  const uint8_t* dictionaries[2];
+  size_t dictionary_sizes[2];
+  BrotliEncoderPreparedDictionary* prepared[2];
+  int selection;
+  size_t i;
+  dictionaries[0] = file;
+  dictionaries[1] = file + DICTIONARY_SIZE / 2;
+  for (i = 0; i < 2; ++i) {
+    dictionary_sizes[i] = DICTIONARY_SIZE / 2;
+    prepared[i] = BrotliEncoderPrepareDictionary(BROTLI_SHARED_DICTIONARY_RAW,
+        dictionary_sizes[i], dictionaries[i], BROTLI_MAX_QUALITY,
+        NULL, NULL, NULL);
+  }
+  if (!prepared[0] || !prepared[1]) {
+    Check(BROTLI_FALSE, "preparation of dictionaries");
+    BrotliEncoderDestroyPreparedDictionary(prepared[0]);
+    BrotliEncoderDestroyPreparedDictionary(prepared[1]);
+    return;
+  }
+  for (selection = 0; selection <= 1; ++selection) {
+    BrotliEncoderState* s = BrotliEncoderCreateInstance(NULL, NULL, NULL);
+    ReferenceCounts counts = {DICTIONARY_SIZE / 2, 0, 0};
+    size_t output_size = 0;
+    if (s) {
+      BrotliEncoderSetParameter(s, BROTLI_PARAM_QUALITY, 9);
+      BrotliEncoderSetParameter(
+          s, BROTLI_PARAM_DICTIONARY_SELECTION, (uint32_t)selection);
+      BrotliEncoderSetDictionaryReferenceCallback(s, CountReference, &counts);
+      if (BrotliEncoderAttachPreparedDictionary(s, prepared[0]) &&
+          BrotliEncoderAttachPreparedDictionary(s, prepared[1])) {
+        output_size = CompressAndDestroy(
+            s, input, input_size, output, capacity);
+      } else {
+        BrotliEncoderDestroyInstance(s);
+      }
+    }
+    Check(output_size != 0, "compression with two dictionaries");
+    Check(Decompresses(BROTLI_SHARED_DICTIONARY_RAW, 2, dictionary_sizes,
+                       dictionaries, output, output_size, input, input_size),
+          "output is decodable with both dictionaries");
+    if (selection) {
+      Check((counts.first == 0) != (counts.second == 0),
+            "only one dictionary is searched with selection");
+    } else {
+      Check(counts.first != 0 && counts.second != 0,
+            "both dictionaries are searched without selection");
+    }
+  }
+  BrotliEncoderDestroyPreparedDictionary(prepared[0]);
+  BrotliEncoderDestroyPreparedDictionary(prepared[1]);
+}
+
+int main(int argc, char** argv) {
+  size_t file_size = 0;
+  uint8_t* file;
+  const uint8_t* input;
+  size_t input_size;
+  BrotliEncoderPreparedDictionary* prepared;
+  const BrotliEncoderPreparedDictionary* loaded;
+  uint8_t* blob;
+  uint8_t* copy;
+  size_t blob_size = 0;
+  uint8_t* expected;
+  uint8_t* actual;
+  size_t capacity;
+  int quality;
+  const uint8_t* dictionary;
+  size_t dictionary_size = DICTIONARY_SIZE;
+
+  if (argc != 2) {
+    fprintf(stderr, "usage: %s FILE\n", argv[0]);
+    return 2;
+  }
+  file = ReadFile(argv[1], &file_size);
+  if (!file || file_size <= DICTIONARY_SIZE) {
+    fprintf(stderr, "failed to read input, or it is too short\n");
+    return 2;
+  }
+  dictionary = file;
+  input = file + DICTIONARY_SIZE;
+  input_size = file_size - DICTIONARY_SIZE;
+  capacity = BrotliEncoderMaxCompressedSize(input_size);
+
+  prepared = BrotliEncoderPrepareDictionary(BROTLI_SHARED_DICTIONARY_RAW,
+      DICTIONARY_SIZE, file, BROTLI_MAX_QUALITY, NULL, NULL, NULL);
+  if (!prepared) {
+    fprintf(stderr, "failed to prepare dictionary\n");
+    return 2;
+  }
+  Check(!BrotliEncoderSerializePreparedDictionary(prepared, &blob_size, NULL),
+        "serialization into empty buffer");
+  Check(blob_size > DICTIONARY_SIZE, "serialized size is reported");
+  /* malloc result is aligned well enough. */
+  blob = (uint8_t*)malloc(blob_size);
+  copy = (uint8_t*)malloc(blob_size);
+  expected = (uint8_t*)malloc(capacity);
+  actual = (uint8_t*)malloc(capacity);
+  if (!blob || !copy || !expected || !actual) {
+    fprintf(stderr, "out of memory\n");
+    return 2;
+  }
+  Check(BrotliEncoderSerializePreparedDictionary(prepared, &blob_size, blob),
+        "serialization");
+
+  loaded = BrotliEncoderLoadPreparedDictionaryFromMemory(blob_size, blob);
+  Check(loaded != NULL, "loading of serialized dictionary");
+  if (loaded) {
+    for (quality = 5; quality <= 11; quality += 6) {
+      size_t expected_size =
+          Compress(prepared, quality, input, input_size, expected, capacity);
+      size_t actual_size =
+          Compress(loaded, quality, input, input_size, actual, capacity);
+      Check(expected_size != 0 && expected_size == actual_size &&
+            memcmp(expected, actual, actual_size) == 0,
+            "loaded dictionary gives the same output");
+      Check(Decompresses(BROTLI_SHARED_DICTIONARY_RAW, 1, &dictionary_size,
+                         &dictionary, actual, actual_size, input, input_size),
+            "output is decodable with raw dictionary");
+    }
+  }
+
+  /* Truncated blobs. */
+  Check(!BrotliEncoderLoadPreparedDictionaryFromMemory(blob_size - 1, blob),
+        "last byte is missing");
+  Check(!BrotliEncoderLoadPreparedDictionaryFromMemory(
+            blob_size - DICTIONARY_SIZE, blob), "source is missing");
+  Check(!BrotliEncoderLoadPreparedDictionaryFromMemory(HEADER_SIZE - 1, blob),
+        "header is truncated");
+  Check(!BrotliEncoderLoadPreparedDictionaryFromMemory(0, blob), "empty blob");
+
+  /* Corrupted headers. */
+  CheckCorrupted(blob, blob_size, copy, 0, 0x12345678, "bad magic");
+  CheckCorrupted(blob, blob_size, copy, HEADER_SOURCE_SIZE,
+      LoadField(blob, HEADER_SOURCE_SIZE) + 1, "source size");
+  CheckCorrupted(blob, blob_size, copy, HEADER_HASH_BITS, 0, "hash_bits 0");
+  CheckCorrupted(blob, blob_size, copy, HEADER_HASH_BITS, 65, "hash_bits 65");
+  CheckCorrupted(blob, blob_size, copy, HEADER_SLOT_BITS, 0, "slot_bits 0");
+  CheckCorrupted(blob, blob_size, copy, HEADER_BUCKET_BITS,
+      LoadField(blob, HEADER_BUCKET_BITS) + 1, "bucket_bits");
+  /* Zero bucket bits; blob is otherwise consistent: one bucket of unused
+     items is followed by the source. */
+  {
+    uint32_t num_items = 1u << LoadField(blob, HEADER_SLOT_BITS);
+    size_t size = HEADER_SIZE + num_items * sizeof(uint32_t) + DICTIONARY_SIZE;
+    memcpy(copy, blob, HEADER_SIZE);
+    memset(copy + HEADER_SIZE, 0x80, num_items * sizeof(uint32_t));
+    memcpy(copy + size - DICTIONARY_SIZE, file, DICTIONARY_SIZE);
+    StoreField(copy, HEADER_NUM_ITEMS, num_items);
+    StoreField(copy, HEADER_BUCKET_BITS, 0);
+    Check(!BrotliEncoderLoadPreparedDictionaryFromMemory(size, copy),
+          "bucket_bits 0");
+  }
+  /* Index item points outside of the source. */
+  CheckCorrupted(blob, blob_size, copy, HEADER_SIZE / sizeof(uint32_t),
+      0x7FFFFFFFu, "index item");
+
+  CheckSharedDictionaryCache(
+      file, input, input_size, expected, actual, capacity);
+  CheckDictionarySelection(file, input, input_size, actual, capacity);
+  CheckDecoderSharedDictionary(
+      prepared, file, input, input_size, actual, capacity);
+  CheckChainedDictionary(file, input, input_size, actual, capacity);
+
+  BrotliEncoderDestroyPreparedDictionary(prepared);
+  free(blob);
+  free(copy);
+  free(expected);
+  free(actual);
+  free(file);
+  if (failures) return 1;
+  printf("OK\n");
+  return 0;
+}
@@ -0,0 +1,73 @@
+set(ENV{QEMU_LD_PREFIX} "${BROTLI_WRAPPER_LD_PREFIX}")
+
+string(REPLACE "|" ";" INPUTS "${INPUTS}")
+
+execute_process(
+  WORKING_DIRECTORY "${CMAKE_CURRENT_SOURCE_DIR}"
+  COMMAND ${BROTLI_WRAPPER} ${BROTLI_CLI} --bench=0-1 ${INPUTS}
+  RESULT_VARIABLE result
+  OUTPUT_VARIABLE report
+  ERROR_VARIABLE result_stderr)
+if(result)
+  message(FATAL_ERROR "Benchmark failed: ${result_stderr}")
+endif()
+
+if(CMAKE_VERSION VERSION_LESS 3.19)
+  if(NOT report MATCHES "\"quality\": 0.*\"quality\": 1")
+    message(FATAL_ERROR "Unexpected benchmark report: ${report}")
+  endif()
+  return()
+endif()
+
+string(JSON num_results LENGTH "${report}")
+if(NOT num_results EQUAL 2)
+  message(FATAL_ERROR "Unexpected benchmark report: ${report}")
+endif()
+foreach(quality 0 1)
+  string(JSON reported_quality GET "${report}" ${quality} quality)
+  string(JSON size GET "${report}" ${quality} size)
+  string(JSON compressed_size GET "${report}" ${quality} compressed_size)
+  string(JSON speed GET "${report}" ${quality} decompress_mb_per_sec)
+  if(NOT reported_quality EQUAL quality OR
+     NOT compressed_size LESS size OR NOT speed GREATER 0)
+    message(FATAL_ERROR "Unexpected benchmark result: ${report}")
+  endif()
+endforeach()
+
+# Window chosen by compressor is reported as the one in use.
+string(JSON reported_lgwin GET "${report}" 0 lgwin)
+if(NOT reported_lgwin GREATER_EQUAL 10)
+  message(FATAL_ERROR "Unexpected benchmark window: ${report}")
+endif()
+
+execute_process(
+  WORKING_DIRECTORY "${CMAKE_CURRENT_SOURCE_DIR}"
+  COMMAND ${BROTLI_WRAPPER} ${BROTLI_CLI} --bench=1 -w 10-11 ${INPUTS}
+  RESULT_VARIABLE result
+  OUTPUT_VARIABLE report
+  ERROR_VARIABLE result_stderr)
+if(result)
+  message(FATAL_ERROR "Window range benchmark failed: ${result_stderr}")
+endif()
+string(JSON num_results LENGTH "${report}")
+if(NOT num_results EQUAL 2)
+  message(FATAL_ERROR "Unexpected benchmark report: ${report}")
+endif()
+foreach(index 0 1)
+  math(EXPR lgwin "10 + ${index}")
+  string(JSON reported_lgwin GET "${report}" ${index} lgwin)
+  string(JSON reported_quality GET "${report}" ${index} quality)
+  if(NOT reported_lgwin EQUAL lgwin OR NOT reported_quality EQUAL 1)
+    message(FATAL_ERROR "Unexpected benchmark result: ${report}")
+  endif()
+endforeach()
+
+# Window range is meaningful only for benchmark.
+execute_process(
+  WORKING_DIRECTORY "${CMAKE_CURRENT_SOURCE_DIR}"
+  COMMAND ${BROTLI_WRAPPER} ${BROTLI_CLI} -t -w 10-11 ${INPUTS}
+  RESULT_VARIABLE result
+  OUTPUT_QUIET ERROR_QUIET)
+if(NOT result)
+  message(FATAL_ERROR "Window range is accepted outside of benchmark")
+endif()
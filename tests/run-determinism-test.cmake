@@ -0,0 +1,57 @@
+# Checks that encoder configurations that are supposed to affect only speed
+# (e.g. SIMD hasher selection, number of threads) produce byte-identical
+# output. Configurations of each group are compared with the first one of the
+# group; "|" separates arguments of a configuration.
+
+set(ENV{QEMU_LD_PREFIX} "${BROTLI_WRAPPER_LD_PREFIX}")
+
+set(SIMD_CONFIGURATIONS
+  "--simd_hasher=2"
+  "--simd_hasher=1")
+
+# With -T input is cut into chunks (even with a single thread); small window
+# makes chunks small enough to split test inputs.
+set(THREAD_CONFIGURATIONS
+  "--threads=1|--lgwin=16"
+  "--threads=2|--lgwin=16"
+  "--threads=4|--lgwin=16"
+  "--threads=3|--lgwin=16|--simd_hasher=1")
+
+function(test_file_equality f1 f2)
+  if(NOT CMAKE_VERSION VERSION_LESS 2.8.7)
+    file(SHA512 "${f1}" f1_cs)
+    file(SHA512 "${f2}" f2_cs)
+    if(NOT "${f1_cs}" STREQUAL "${f2_cs}")
+      message(FATAL_ERROR "Output of [${ARGN}] differs from reference")
+    endif()
+  else()
+    file(READ "${f1}" f1_contents)
+    file(READ "${f2}" f2_contents)
+    if(NOT "${f1_contents}" STREQUAL "${f2_contents}")
+      message(FATAL_ERROR "Output of [${ARGN}] differs from reference")
+    endif()
+  endif()
+endfunction()
+
+function(test_configurations group)
+  set(index 0)
+  foreach(config ${ARGN})
+    string(REPLACE "|" ";" args "${config}")
+    execute_process(
+      WORKING_DIRECTORY "${CMAKE_CURRENT_SOURCE_DIR}"
+      COMMAND ${BROTLI_WRAPPER} ${BROTLI_CLI} --force --quality=${QUALITY} ${args} ${INPUT} --output=${OUTPUT}.${group}.${index}.br
+      RESULT_VARIABLE result
+      ERROR_VARIABLE result_stderr)
+    if(result)
+      message(FATAL_ERROR "Compression with [${config}] failed: ${result_stderr}")
+    endif()
+    if(index GREATER 0)
+      test_file_equality("${OUTPUT}.${group}.0.br"
+                         "${OUTPUT}.${group}.${index}.br" ${config})
+    endif()
+    math(EXPR index "${index} + 1")
+  endforeach()
+endfunction()
+
+test_configurations(simd ${SIMD_CONFIGURATIONS})
+test_configurations(threads ${THREAD_CONFIGURATIONS})
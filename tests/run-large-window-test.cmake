@@ -0,0 +1,62 @@
+# Checks that q10 and q11 find repeats that are further than the binary tree
+# forest covers (16 MiB) in large-window mode, and that output roundtrips.
+# Input is INPUT, 17 MiB of zeros, and INPUT again; the second copy is cheap
+# only if it is matched to the first one.
+
+set(ENV{QEMU_LD_PREFIX} "${BROTLI_WRAPPER_LD_PREFIX}")
+
+function(test_file_equality f1 f2)
+  file(SHA512 "${f1}" f1_cs)
+  file(SHA512 "${f2}" f2_cs)
+  if(NOT "${f1_cs}" STREQUAL "${f2_cs}")
+    message(FATAL_ERROR "Files ${f1} and ${f2} do not match")
+  endif()
+endfunction()
+
+function(run_brotli)
+  execute_process(
+    COMMAND ${BROTLI_WRAPPER} ${BROTLI_CLI} ${ARGN}
+    RESULT_VARIABLE result
+    ERROR_VARIABLE result_stderr)
+  if(result)
+    message(FATAL_ERROR "brotli ${ARGN} failed: ${result_stderr}")
+  endif()
+endfunction()
+
+if(CMAKE_VERSION VERSION_LESS 3.18)
+  message(STATUS "Skipping large window test: cmake -E cat is not available")
+  return()
+endif()
+
+get_filename_component(TESTDATA "${INPUT}" DIRECTORY)
+set(ZEROS "${TESTDATA}/zeros")
+# 68 x 256 KiB = 17 MiB.
+set(PARTS "${INPUT}")
+foreach(i RANGE 1 68)
+  list(APPEND PARTS "${ZEROS}")
+endforeach()
+list(APPEND PARTS "${INPUT}")
+execute_process(
+  COMMAND ${CMAKE_COMMAND} -E cat ${PARTS}
+  OUTPUT_FILE "${OUTPUT}"
+  RESULT_VARIABLE result)
+if(result)
+  message(FATAL_ERROR "Failed to prepare large window input")
+endif()
+
+foreach(quality 10 11)
+  run_brotli(--force --quality=${quality} ${INPUT}
+             --output=${OUTPUT}.${quality}.single.br)
+  run_brotli(--force --quality=${quality} --large_window=26 ${OUTPUT}
+             --output=${OUTPUT}.${quality}.br)
+  run_brotli(--force --decompress --large_window=26 ${OUTPUT}.${quality}.br
+             --output=${OUTPUT}.${quality}.unbr)
+  test_file_equality("${OUTPUT}" "${OUTPUT}.${quality}.unbr")
+  file(SIZE "${OUTPUT}.${quality}.single.br" single_size)
+  file(SIZE "${OUTPUT}.${quality}.br" size)
+  math(EXPR limit "${single_size} * 3 / 2")
+  if(NOT size LESS limit)
+    message(FATAL_ERROR "Far repeat is not found at q${quality}: "
+                        "${size} bytes, single copy is ${single_size} bytes")
+  endif()
+endforeach()
@@ -0,0 +1,61 @@
+# Checks that several files compressed / decompressed in parallel roundtrip
+# and that output matches the one produced sequentially.
+
+set(ENV{QEMU_LD_PREFIX} "${BROTLI_WRAPPER_LD_PREFIX}")
+
+string(REPLACE "|" ";" INPUTS "${INPUTS}")
+
+function(test_file_equality f1 f2)
+  file(SHA512 "${f1}" f1_cs)
+  file(SHA512 "${f2}" f2_cs)
+  if(NOT "${f1_cs}" STREQUAL "${f2_cs}")
+    message(FATAL_ERROR "Files ${f1} and ${f2} do not match")
+  endif()
+endfunction()
+
+file(REMOVE_RECURSE "${OUTPUT}")
+file(MAKE_DIRECTORY "${OUTPUT}")
+set(FILES)
+foreach(INPUT ${INPUTS})
+  get_filename_component(NAME "${INPUT}" NAME)
+  configure_file("${INPUT}" "${OUTPUT}/${NAME}" COPYONLY)
+  list(APPEND FILES "${OUTPUT}/${NAME}")
+endforeach()
+
+# Reference output.
+foreach(FILE ${FILES})
+  execute_process(
+    COMMAND ${BROTLI_WRAPPER} ${BROTLI_CLI} --force --quality=6 ${FILE} --output=${FILE}.ref
+    RESULT_VARIABLE result
+    ERROR_VARIABLE result_stderr)
+  if(result)
+    message(FATAL_ERROR "Compression failed: ${result_stderr}")
+  endif()
+endforeach()
+
+execute_process(
+  COMMAND ${BROTLI_WRAPPER} ${BROTLI_CLI} --force --quality=6 --threads=3 ${FILES}
+  RESULT_VARIABLE result
+  ERROR_VARIABLE result_stderr)
+if(result)
+  message(FATAL_ERROR "Parallel compression failed: ${result_stderr}")
+endif()
+
+set(COMPRESSED_FILES)
+foreach(FILE ${FILES})
+  test_file_equality("${FILE}.ref" "${FILE}.br")
+  file(RENAME "${FILE}" "${FILE}.orig")
+  list(APPEND COMPRESSED_FILES "${FILE}.br")
+endforeach()
+
+execute_process(
+  COMMAND ${BROTLI_WRAPPER} ${BROTLI_CLI} --decompress --threads=2 ${COMPRESSED_FILES}
+  RESULT_VARIABLE result
+  ERROR_VARIABLE result_stderr)
+if(result)
+  message(FATAL_ERROR "Parallel decompression failed: ${result_stderr}")
+endif()
+
+foreach(FILE ${FILES})
+  test_file_equality("${FILE}.orig" "${FILE}")
+endforeach()
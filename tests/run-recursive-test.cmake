@@ -0,0 +1,82 @@
+# Checks that files found in directory tree are compressed / decompressed
+# with -r and that output of reused encoder matches the one produced for each
+# file separately.
+
+set(ENV{QEMU_LD_PREFIX} "${BROTLI_WRAPPER_LD_PREFIX}")
+
+string(REPLACE "|" ";" INPUTS "${INPUTS}")
+
+function(test_file_equality f1 f2)
+  file(SHA512 "${f1}" f1_cs)
+  file(SHA512 "${f2}" f2_cs)
+  if(NOT "${f1_cs}" STREQUAL "${f2_cs}")
+    message(FATAL_ERROR "Files ${f1} and ${f2} do not match")
+  endif()
+endfunction()
+
+file(REMOVE_RECURSE "${OUTPUT}")
+file(MAKE_DIRECTORY "${OUTPUT}/tree/sub/deeper")
+# Files of different size are interleaved, so that encoder memory is reused
+# for both smaller and bigger inputs.
+set(FILES)
+set(index 0)
+foreach(INPUT ${INPUTS})
+  get_filename_component(NAME "${INPUT}" NAME)
+  foreach(DIR "tree" "tree/sub" "tree/sub/deeper")
+    configure_file("${INPUT}" "${OUTPUT}/${DIR}/${index}.${NAME}" COPYONLY)
+    list(APPEND FILES "${OUTPUT}/${DIR}/${index}.${NAME}")
+    math(EXPR index "${index} + 1")
+  endforeach()
+endforeach()
+# Already compressed files are skipped.
+file(WRITE "${OUTPUT}/tree/skipped.br" "not a brotli stream")
+
+foreach(quality 0 5 9)
+  foreach(FILE ${FILES})
+    execute_process(
+      COMMAND ${BROTLI_WRAPPER} ${BROTLI_CLI} --force --quality=${quality} ${FILE} --output=${FILE}.ref
+      RESULT_VARIABLE result
+      ERROR_VARIABLE result_stderr)
+    if(result)
+      message(FATAL_ERROR "Compression failed: ${result_stderr}")
+    endif()
+  endforeach()
+
+  execute_process(
+    COMMAND ${BROTLI_WRAPPER} ${BROTLI_CLI} --force --quality=${quality} --recursive ${OUTPUT}/tree
+    RESULT_VARIABLE result
+    ERROR_VARIABLE result_stderr)
+  if(result)
+    message(FATAL_ERROR "Recursive compression failed: ${result_stderr}")
+  endif()
+
+  foreach(FILE ${FILES})
+    test_file_equality("${FILE}.ref" "${FILE}.br")
+    file(REMOVE "${FILE}.ref")
+  endforeach()
+endforeach()
+
+foreach(FILE ${FILES})
+  file(RENAME "${FILE}" "${FILE}.orig")
+endforeach()
+execute_process(
+  COMMAND ${BROTLI_WRAPPER} ${BROTLI_CLI} --decompress -r ${OUTPUT}/tree
+  RESULT_VARIABLE result
+  ERROR_VARIABLE result_stderr)
+# Invalid "skipped.br" is found as well.
+if(NOT result)
+  message(FATAL_ERROR "Decompression of invalid stream did not fail")
+endif()
+
+file(REMOVE "${OUTPUT}/tree/skipped.br")
+execute_process(
+  COMMAND ${BROTLI_WRAPPER} ${BROTLI_CLI} --decompress --force -r ${OUTPUT}/tree
+  RESULT_VARIABLE result
+  ERROR_VARIABLE result_stderr)
+if(result)
+  message(FATAL_ERROR "Recursive decompression failed: ${result_stderr}")
+endif()
+
+foreach(FILE ${FILES})
+  test_file_equality("${FILE}.orig" "${FILE}")
+endforeach()
@@ -0,0 +1,150 @@
+# Checks that seekable output is decompressed as a whole (with or without -K,
+# in parallel with -T) and that --range produces exactly the requested span,
+# including spans that cross chunk boundaries or exceed the end of data.
+# Damaged chunks are reported and damaged index makes decoder fall back to
+# sequential decoding.
+
+set(ENV{QEMU_LD_PREFIX} "${BROTLI_WRAPPER_LD_PREFIX}")
+
+function(test_file_equality f1 f2)
+  file(SHA512 "${f1}" f1_cs)
+  file(SHA512 "${f2}" f2_cs)
+  if(NOT "${f1_cs}" STREQUAL "${f2_cs}")
+    message(FATAL_ERROR "Files ${f1} and ${f2} do not match")
+  endif()
+endfunction()
+
+function(run_brotli)
+  execute_process(
+    COMMAND ${BROTLI_WRAPPER} ${BROTLI_CLI} ${ARGN}
+    RESULT_VARIABLE result
+    ERROR_VARIABLE result_stderr)
+  if(result)
+    message(FATAL_ERROR "brotli ${ARGN} failed: ${result_stderr}")
+  endif()
+endfunction()
+
+run_brotli(--force --quality=5 --seekable=16K ${INPUT} --output=${OUTPUT}.br)
+# Output does not depend on the number of threads.
+run_brotli(--force --quality=5 --seekable=16K --threads=2 ${INPUT}
+           --output=${OUTPUT}.2.br)
+test_file_equality("${OUTPUT}.br" "${OUTPUT}.2.br")
+
+run_brotli(--force --decompress ${OUTPUT}.br --output=${OUTPUT}.unbr)
+test_file_equality("${INPUT}" "${OUTPUT}.unbr")
+run_brotli(--force --decompress --concatenated ${OUTPUT}.br
+           --output=${OUTPUT}.K.unbr)
+test_file_equality("${INPUT}" "${OUTPUT}.K.unbr")
+# Streams are decoded in parallel.
+run_brotli(--force --decompress --threads=3 ${OUTPUT}.br
+           --output=${OUTPUT}.T.unbr)
+test_file_equality("${INPUT}" "${OUTPUT}.T.unbr")
+
+file(SIZE "${INPUT}" input_size)
+math(EXPR tail_offset "${input_size} - 10")
+foreach(range "0:100" "16380:10" "50000:40000" "${tail_offset}:100"
+        "${input_size}:1")
+  string(REPLACE ":" ";" parts "${range}")
+  list(GET parts 0 offset)
+  list(GET parts 1 length)
+  run_brotli(--force --decompress --range=${range} ${OUTPUT}.br
+             --output=${OUTPUT}.range)
+  file(READ "${INPUT}" expected OFFSET ${offset} LIMIT ${length} HEX)
+  file(READ "${OUTPUT}.range" actual HEX)
+  if(NOT "${expected}" STREQUAL "${actual}")
+    message(FATAL_ERROR "Range ${range} does not match")
+  endif()
+endforeach()
+
+execute_process(
+  COMMAND ${BROTLI_WRAPPER} ${BROTLI_CLI} --force --decompress
+          --range=0:1 ${OUTPUT}.unbr --output=${OUTPUT}.range
+  RESULT_VARIABLE result
+  ERROR_QUIET)
+if(NOT result)
+  message(FATAL_ERROR "--range should fail for non-seekable input")
+endif()
+
+# Damaged seekable files; patches are written with "dd".
+find_program(DD dd)
+if(NOT DD)
+  message(STATUS "Skipping damaged input checks: dd not found")
+  return()
+endif()
+
+function(patch_file path offset patch)
+  file(WRITE "${OUTPUT}.patch" "${patch}")
+  execute_process(
+    COMMAND ${DD} if=${OUTPUT}.patch of=${path} bs=1 seek=${offset}
+            conv=notrunc
+    RESULT_VARIABLE result
+    OUTPUT_QUIET ERROR_QUIET)
+  if(result)
+    message(FATAL_ERROR "Failed to patch ${path}")
+  endif()
+endfunction()
+
+# Offsets of index entries; index is followed by footer and 1 byte.
+file(SIZE "${OUTPUT}.br" compressed_size)
+math(EXPR num_chunks "(${input_size} + 16383) / 16384")
+math(EXPR last_chunk "${num_chunks} - 1")
+math(EXPR index_offset "${compressed_size} - 9 - ${num_chunks} * 8")
+
+# Corrupted chunk is reported by parallel decoder, as by sequential one.
+configure_file("${OUTPUT}.br" "${OUTPUT}.bad.br" COPYONLY)
+patch_file("${OUTPUT}.bad.br" 20000 "corrupted chunk")
+foreach(threads 1 3)
+  execute_process(
+    COMMAND ${BROTLI_WRAPPER} ${BROTLI_CLI} --force --decompress
+            --threads=${threads} ${OUTPUT}.bad.br --output=${OUTPUT}.bad
+    RESULT_VARIABLE result
+    ERROR_QUIET)
+  if(NOT result)
+    message(FATAL_ERROR "Corrupted chunk is not detected with -T ${threads}")
+  endif()
+endforeach()
+
+# Chunk sizes that encoder does not produce ("ALIC" is above 1GiB): index is
+# ignored and input is decompressed sequentially.
+configure_file("${OUTPUT}.br" "${OUTPUT}.bad.br" COPYONLY)
+foreach(chunk RANGE ${last_chunk})
+  math(EXPR offset "${index_offset} + ${chunk} * 8 + 4")
+  patch_file("${OUTPUT}.bad.br" ${offset} "ALIC")
+endforeach()
+run_brotli(--force --decompress --threads=3 ${OUTPUT}.bad.br
+           --output=${OUTPUT}.bad)
+test_file_equality("${INPUT}" "${OUTPUT}.bad")
+
+# Plausible, but wrong chunk sizes (4 spaces are 514MiB) are not trusted with
+# memory allocation; mismatch is reported.
+configure_file("${OUTPUT}.br" "${OUTPUT}.bad.br" COPYONLY)
+foreach(chunk RANGE ${last_chunk})
+  math(EXPR offset "${index_offset} + ${chunk} * 8 + 4")
+  patch_file("${OUTPUT}.bad.br" ${offset} "    ")
+endforeach()
+execute_process(
+  COMMAND ${BROTLI_WRAPPER} ${BROTLI_CLI} --force --decompress --threads=256
+          ${OUTPUT}.bad.br --output=${OUTPUT}.bad
+  RESULT_VARIABLE result
+  ERROR_VARIABLE result_stderr)
+if(NOT result OR NOT result_stderr MATCHES "corrupt input")
+  message(FATAL_ERROR "Wrong chunk size is not detected: ${result_stderr}")
+endif()
+
+# Index does not describe the whole file, if seekable files are concatenated;
+# such input is decompressed sequentially with -K.
+if(CMAKE_VERSION VERSION_LESS 3.18)
+  message(STATUS "Skipping concatenated input check: no cmake -E cat")
+  return()
+endif()
+execute_process(
+  COMMAND ${CMAKE_COMMAND} -E cat "${OUTPUT}.br" "${OUTPUT}.br"
+  OUTPUT_FILE "${OUTPUT}.bad.br"
+  RESULT_VARIABLE result)
+execute_process(
+  COMMAND ${CMAKE_COMMAND} -E cat "${INPUT}" "${INPUT}"
+  OUTPUT_FILE "${OUTPUT}.twice"
+  RESULT_VARIABLE result)
+run_brotli(--force --decompress --concatenated --threads=3 ${OUTPUT}.bad.br
+           --output=${OUTPUT}.bad)
+test_file_equality("${OUTPUT}.twice" "${OUTPUT}.bad")
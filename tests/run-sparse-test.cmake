@@ -0,0 +1,91 @@
+# Checks that decompressed output with leading, interior (not block-aligned)
+# and trailing zero runs is written exactly, and that zero blocks are not
+# allocated, if file system supports holes.
+
+set(ENV{QEMU_LD_PREFIX} "${BROTLI_WRAPPER_LD_PREFIX}")
+
+function(test_file_equality f1 f2)
+  file(SHA512 "${f1}" f1_cs)
+  file(SHA512 "${f2}" f2_cs)
+  if(NOT "${f1_cs}" STREQUAL "${f2_cs}")
+    message(FATAL_ERROR "Files ${f1} and ${f2} do not match")
+  endif()
+endfunction()
+
+function(run_brotli)
+  execute_process(
+    COMMAND ${BROTLI_WRAPPER} ${BROTLI_CLI} ${ARGN}
+    RESULT_VARIABLE result
+    ERROR_VARIABLE result_stderr)
+  if(result)
+    message(FATAL_ERROR "brotli ${ARGN} failed: ${result_stderr}")
+  endif()
+endfunction()
+
+# Allocated size in KiB, or empty, if it could not be measured.
+function(allocated_size path out)
+  set(${out} "" PARENT_SCOPE)
+  if(NOT DU)
+    return()
+  endif()
+  execute_process(
+    COMMAND ${DU} -k "${path}"
+    RESULT_VARIABLE result
+    OUTPUT_VARIABLE du_output
+    ERROR_QUIET)
+  if(NOT result AND du_output MATCHES "^([0-9]+)")
+    set(${out} "${CMAKE_MATCH_1}" PARENT_SCOPE)
+  endif()
+endfunction()
+
+if(CMAKE_VERSION VERSION_LESS 3.18)
+  message(STATUS "Skipping sparse output test: cmake -E cat is not available")
+  return()
+endif()
+
+get_filename_component(TESTDATA "${INPUT}" DIRECTORY)
+set(ZEROS "${TESTDATA}/zeros")
+execute_process(
+  COMMAND ${CMAKE_COMMAND} -E cat "${ZEROS}" "${INPUT}" "${ZEROS}" "${INPUT}"
+          "${ZEROS}"
+  OUTPUT_FILE "${OUTPUT}"
+  RESULT_VARIABLE result)
+if(result)
+  message(FATAL_ERROR "Failed to prepare sparse input")
+endif()
+
+run_brotli(--force --quality=1 ${OUTPUT} --output=${OUTPUT}.br)
+run_brotli(--force --decompress ${OUTPUT}.br --output=${OUTPUT}.unbr)
+test_file_equality("${OUTPUT}" "${OUTPUT}.unbr")
+# Output is written in background.
+run_brotli(--force --decompress --threads=2 ${OUTPUT}.br
+           --output=${OUTPUT}.T.unbr)
+test_file_equality("${OUTPUT}" "${OUTPUT}.T.unbr")
+
+# Holes are checked only if a file made with "truncate" is not allocated.
+find_program(DU du)
+find_program(TRUNCATE truncate)
+if(NOT DU OR NOT TRUNCATE)
+  message(STATUS "Skipping allocated size check: du or truncate not found")
+  return()
+endif()
+file(REMOVE "${OUTPUT}.probe")
+execute_process(
+  COMMAND ${TRUNCATE} -s 1M "${OUTPUT}.probe"
+  RESULT_VARIABLE result)
+allocated_size("${OUTPUT}.probe" probe_size)
+file(REMOVE "${OUTPUT}.probe")
+if(result OR "${probe_size}" STREQUAL "" OR NOT probe_size LESS 1024)
+  message(STATUS "Skipping allocated size check: holes are not supported")
+  return()
+endif()
+
+file(SIZE "${OUTPUT}" size)
+math(EXPR size_kib "${size} / 1024")
+foreach(unbr "${OUTPUT}.unbr" "${OUTPUT}.T.unbr")
+  allocated_size("${unbr}" unbr_size)
+  if("${unbr_size}" STREQUAL "" OR NOT unbr_size LESS size_kib)
+    message(FATAL_ERROR
+            "${unbr} allocates ${unbr_size} KiB of ${size_kib} KiB")
+  endif()
+endforeach()
@@ -0,0 +1,46 @@
+# Checks that multi-threaded compression roundtrips and that its output does
+# not depend on the number of threads (-T 1 compresses the same chunks one by
+# one); decompression uses background I/O.
+# Small window makes chunks small enough to split test inputs.
+
+set(ENV{QEMU_LD_PREFIX} "${BROTLI_WRAPPER_LD_PREFIX}")
+
+function(test_file_equality f1 f2)
+  if(NOT CMAKE_VERSION VERSION_LESS 2.8.7)
+    file(SHA512 "${f1}" f1_cs)
+    file(SHA512 "${f2}" f2_cs)
+    if(NOT "${f1_cs}" STREQUAL "${f2_cs}")
+      message(FATAL_ERROR "Files ${f1} and ${f2} do not match")
+    endif()
+  else()
+    file(READ "${f1}" f1_contents)
+    file(READ "${f2}" f2_contents)
+    if(NOT "${f1_contents}" STREQUAL "${f2_contents}")
+      message(FATAL_ERROR "Files ${f1} and ${f2} do not match")
+    endif()
+  endif()
+endfunction()
+
+foreach(threads 1 2 4)
+  execute_process(
+    WORKING_DIRECTORY "${CMAKE_CURRENT_SOURCE_DIR}"
+    COMMAND ${BROTLI_WRAPPER} ${BROTLI_CLI} --force --quality=${QUALITY} --lgwin=16 --threads=${threads} ${INPUT} --output=${OUTPUT}.${threads}.br
+    RESULT_VARIABLE result
+    ERROR_VARIABLE result_stderr)
+  if(result)
+    message(FATAL_ERROR "Compression in ${threads} threads failed: ${result_stderr}")
+  endif()
+endforeach()
+
+test_file_equality("${OUTPUT}.1.br" "${OUTPUT}.2.br")
+test_file_equality("${OUTPUT}.1.br" "${OUTPUT}.4.br")
+
+execute_process(
+  WORKING_DIRECTORY "${CMAKE_CURRENT_SOURCE_DIR}"
+  COMMAND ${BROTLI_WRAPPER} ${BROTLI_CLI} --force --decompress --threads=2 ${OUTPUT}.2.br --output=${OUTPUT}.unbr
+  RESULT_VARIABLE result)
+if(result)
+  message(FATAL_ERROR "Decompression failed")
+endif()
+
+test_file_equality("${INPUT}" "${OUTPUT}.unbr")
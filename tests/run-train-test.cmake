@@ -0,0 +1,178 @@
+set(ENV{QEMU_LD_PREFIX} "${BROTLI_WRAPPER_LD_PREFIX}")
+
+string(REPLACE "|" ";" INPUTS "${INPUTS}")
+list(GET INPUTS 0 INPUT)
+
+execute_process(
+  WORKING_DIRECTORY "${CMAKE_CURRENT_SOURCE_DIR}"
+  COMMAND ${BROTLI_WRAPPER} ${BROTLI_CLI} --force --train --maxdict=8k ${INPUTS} --output=${OUTPUT}.dict
+  RESULT_VARIABLE result
+  ERROR_VARIABLE result_stderr)
+if(result)
+  message(FATAL_ERROR "Training failed: ${result_stderr}")
+endif()
+
+file(SIZE "${OUTPUT}.dict" dict_size)
+if(dict_size EQUAL 0 OR dict_size GREATER 8192)
+  message(FATAL_ERROR "Unexpected dictionary size: ${dict_size}")
+endif()
+
+# Dictionary regions not referenced by any input are removed.
+execute_process(
+  WORKING_DIRECTORY "${CMAKE_CURRENT_SOURCE_DIR}"
+  COMMAND ${BROTLI_WRAPPER} ${BROTLI_CLI} --force --analyze --quality=9 --dictionary=${OUTPUT}.dict ${INPUTS} --output=${OUTPUT}.pruned
+  RESULT_VARIABLE result
+  OUTPUT_QUIET
+  ERROR_VARIABLE result_stderr)
+if(result)
+  message(FATAL_ERROR "Analysis failed: ${result_stderr}")
+endif()
+
+file(SIZE "${OUTPUT}.pruned" pruned_size)
+if(pruned_size EQUAL 0 OR pruned_size GREATER dict_size)
+  message(FATAL_ERROR "Unexpected pruned dictionary size: ${pruned_size}")
+endif()
+
+execute_process(
+  WORKING_DIRECTORY "${CMAKE_CURRENT_SOURCE_DIR}"
+  COMMAND ${BROTLI_WRAPPER} ${BROTLI_CLI} --force --quality=9 --dictionary=${OUTPUT}.pruned ${INPUT} --output=${OUTPUT}.br
+  RESULT_VARIABLE result
+  ERROR_VARIABLE result_stderr)
+if(result)
+  message(FATAL_ERROR "Compression failed: ${result_stderr}")
+endif()
+
+execute_process(
+  WORKING_DIRECTORY "${CMAKE_CURRENT_SOURCE_DIR}"
+  COMMAND ${BROTLI_WRAPPER} ${BROTLI_CLI} --force --decompress --dictionary=${OUTPUT}.pruned ${OUTPUT}.br --output=${OUTPUT}.unbr
+  RESULT_VARIABLE result)
+if(result)
+  message(FATAL_ERROR "Decompression failed")
+endif()
+
+file(SHA512 "${INPUT}" input_cs)
+file(SHA512 "${OUTPUT}.unbr" output_cs)
+if(NOT "${input_cs}" STREQUAL "${output_cs}")
+  message(FATAL_ERROR "Files do not match")
+endif()
+
+# Region that no input refers to is pruned; references made through distance
+# cache are accounted, so compression with pruned dictionary is not worse.
+if(CMAKE_VERSION VERSION_LESS 3.18)
+  message(STATUS "Skipping pruning ratio check: cmake -E cat is not available")
+else()
+  get_filename_component(TESTDATA "${INPUT}" DIRECTORY)
+  execute_process(
+    COMMAND ${CMAKE_COMMAND} -E cat ${TESTDATA}/random_org_10k.bin ${OUTPUT}.dict
+    OUTPUT_FILE ${OUTPUT}.mixed
+    RESULT_VARIABLE result)
+  if(result)
+    message(FATAL_ERROR "Could not make mixed dictionary")
+  endif()
+
+  execute_process(
+    WORKING_DIRECTORY "${CMAKE_CURRENT_SOURCE_DIR}"
+    COMMAND ${BROTLI_WRAPPER} ${BROTLI_CLI} --force --analyze --quality=11 --dictionary=${OUTPUT}.mixed ${INPUTS} --output=${OUTPUT}.mixed.pruned
+    RESULT_VARIABLE result
+    OUTPUT_VARIABLE analysis
+    ERROR_VARIABLE result_stderr)
+  if(result)
+    message(FATAL_ERROR "Analysis of mixed dictionary failed: ${result_stderr}")
+  endif()
+
+  file(SIZE "${OUTPUT}.mixed" mixed_size)
+  file(SIZE "${OUTPUT}.mixed.pruned" mixed_pruned_size)
+  # A few regions of random data could be referenced by chance.
+  math(EXPR max_pruned_size "${dict_size} + 1024")
+  if(mixed_pruned_size GREATER max_pruned_size)
+    message(FATAL_ERROR "Unused region is not pruned: ${mixed_size} -> ${mixed_pruned_size}")
+  endif()
+
+  string(REGEX MATCH "\n[0-9]+ [0-9]+ ([0-9]+) total" total_line "${analysis}")
+  set(total_with_dictionary "${CMAKE_MATCH_1}")
+  string(REGEX MATCH "with pruned dictionary: ([0-9]+)" pruned_line "${analysis}")
+  set(total_with_pruned "${CMAKE_MATCH_1}")
+  if(NOT total_with_dictionary OR NOT total_with_pruned OR
+     total_with_pruned GREATER total_with_dictionary)
+    message(FATAL_ERROR "Pruning lost ratio: ${total_with_dictionary} -> ${total_with_pruned}")
+  endif()
+
+  execute_process(
+    WORKING_DIRECTORY "${CMAKE_CURRENT_SOURCE_DIR}"
+    COMMAND ${BROTLI_WRAPPER} ${BROTLI_CLI} --force --quality=11 --dictionary=${OUTPUT}.mixed.pruned ${INPUT} --output=${OUTPUT}.mixed.br
+    RESULT_VARIABLE result
+    ERROR_VARIABLE result_stderr)
+  if(result)
+    message(FATAL_ERROR "Compression with pruned dictionary failed: ${result_stderr}")
+  endif()
+
+  execute_process(
+    WORKING_DIRECTORY "${CMAKE_CURRENT_SOURCE_DIR}"
+    COMMAND ${BROTLI_WRAPPER} ${BROTLI_CLI} --force --decompress --dictionary=${OUTPUT}.mixed.pruned ${OUTPUT}.mixed.br --output=${OUTPUT}.mixed.unbr
+    RESULT_VARIABLE result)
+  if(result)
+    message(FATAL_ERROR "Decompression with pruned dictionary failed")
+  endif()
+
+  file(SHA512 "${OUTPUT}.mixed.unbr" output_cs)
+  if(NOT "${input_cs}" STREQUAL "${output_cs}")
+    message(FATAL_ERROR "Files do not match")
+  endif()
+endif()
+
+# Serialized shared dictionary. Library built without BROTLI_EXPERIMENTAL
+# uses it as a raw dictionary; then only that fallback is checked.
+execute_process(
+  WORKING_DIRECTORY "${CMAKE_CURRENT_SOURCE_DIR}"
+  COMMAND ${BROTLI_WRAPPER} ${BROTLI_CLI} --force --train --shared --maxdict=8k ${INPUTS} --output=${OUTPUT}.shared
+  RESULT_VARIABLE result
+  ERROR_VARIABLE result_stderr)
+if(result)
+  message(FATAL_ERROR "Shared dictionary training failed: ${result_stderr}")
+endif()
+
+file(SIZE "${OUTPUT}.shared" shared_size)
+if(shared_size EQUAL 0 OR shared_size GREATER 8192)
+  message(FATAL_ERROR "Unexpected shared dictionary size: ${shared_size}")
+endif()
+
+# Only raw dictionaries could be analyzed.
+execute_process(
+  WORKING_DIRECTORY "${CMAKE_CURRENT_SOURCE_DIR}"
+  COMMAND ${BROTLI_WRAPPER} ${BROTLI_CLI} --analyze --dictionary=${OUTPUT}.shared ${INPUT}
+  RESULT_VARIABLE result
+  OUTPUT_QUIET
+  ERROR_QUIET)
+if(BROTLI_EXPERIMENTAL)
+  if(NOT result)
+    message(FATAL_ERROR "Shared dictionary is not recognized")
+  endif()
+else()
+  if(result)
+    message(FATAL_ERROR "Shared dictionary is not used as raw dictionary")
+  endif()
+  message(STATUS "Library is built without BROTLI_EXPERIMENTAL; "
+                 "only raw dictionary fallback is checked")
+endif()
+
+execute_process(
+  WORKING_DIRECTORY "${CMAKE_CURRENT_SOURCE_DIR}"
+  COMMAND ${BROTLI_WRAPPER} ${BROTLI_CLI} --force --quality=11 --dictionary=${OUTPUT}.shared ${INPUT} --output=${OUTPUT}.shared.br
+  RESULT_VARIABLE result
+  ERROR_VARIABLE result_stderr)
+if(result)
+  message(FATAL_ERROR "Compression with shared dictionary failed: ${result_stderr}")
+endif()
+
+execute_process(
+  WORKING_DIRECTORY "${CMAKE_CURRENT_SOURCE_DIR}"
+  COMMAND ${BROTLI_WRAPPER} ${BROTLI_CLI} --force --decompress --dictionary=${OUTPUT}.shared ${OUTPUT}.shared.br --output=${OUTPUT}.shared.unbr
+  RESULT_VARIABLE result)
+if(result)
+  message(FATAL_ERROR "Decompression with shared dictionary failed")
+endif()
+
+file(SHA512 "${OUTPUT}.shared.unbr" output_cs)
+if(NOT "${input_cs}" STREQUAL "${output_cs}")
+  message(FATAL_ERROR "Files do not match")
+endif()
@@ -0,0 +1,36 @@
+# Checks that verbose mode reports time spent in encoder stages: per stage
+# and "I/O and other" for a single stream, summed over threads for chunks
+# compressed in parallel; decompression reports no stages.
+
+set(ENV{QEMU_LD_PREFIX} "${BROTLI_WRAPPER_LD_PREFIX}")
+
+set(SECONDS "[0-9]+\\.[0-9][0-9] sec")
+set(STAGES "; matching ${SECONDS}, block splitting ${SECONDS}, entropy coding ${SECONDS}")
+
+function(run_verbose output_var)
+  execute_process(
+    COMMAND ${BROTLI_WRAPPER} ${BROTLI_CLI} --force --verbose ${ARGN}
+    RESULT_VARIABLE result
+    ERROR_VARIABLE result_stderr)
+  if(result)
+    message(FATAL_ERROR "brotli ${ARGN} failed: ${result_stderr}")
+  endif()
+  set(${output_var} "${result_stderr}" PARENT_SCOPE)
+endfunction()
+
+run_verbose(single --quality=5 ${INPUT} --output=${OUTPUT}.br)
+if(NOT single MATCHES "Compressed \\[[^]]*\\]: .* in ${SECONDS}${STAGES}, I/O and other ${SECONDS}\n")
+  message(FATAL_ERROR "No stage times in verbose output: ${single}")
+endif()
+
+run_verbose(threads --quality=5 --lgwin=16 --threads=2 ${INPUT}
+            --output=${OUTPUT}.T.br)
+if(NOT threads MATCHES "Compressed \\[[^]]*\\]: .* in ${SECONDS}${STAGES} \\(summed over threads\\)\n")
+  message(FATAL_ERROR "No summed stage times in verbose output: ${threads}")
+endif()
+
+run_verbose(decompressed --decompress ${OUTPUT}.br --output=${OUTPUT}.unbr)
+if(NOT decompressed MATCHES "Decompressed \\[[^]]*\\]: .* in ${SECONDS}\n" OR
+   decompressed MATCHES "matching")
+  message(FATAL_ERROR "Unexpected verbose decompression output: ${decompressed}")
+endif()